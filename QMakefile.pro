@@ -26,6 +26,9 @@ COMPONENTS =
 # enable high voltage control, it requires CAENHVWrapper library
 #COMPONENTS += HV_CONTROL
 
+# compress DST files with zlib
+COMPONENTS += ZLIB_COMPRESSION
+
 # use standard evio libraries instead of self-defined function to read
 # evio data files
 COMPONENTS += STANDARD_EVIO
@@ -63,7 +66,14 @@ HEADERS += include/PRadEventViewer.h \
            include/PRadDAQUnit.h \
            include/PRadTDCGroup.h \
            include/PRadEvioParser.h \
+           include/PRadEventPipeline.h \
+           include/PRadEvioIndex.h \
            include/PRadDSTParser.h \
+           include/PRadDSTReader.h \
+           include/PRadEventStore.h \
+           include/PRadEventPool.h \
+           include/PRadLookupTable.h \
+           include/PRadThreadPool.h \
            include/PRadDataHandler.h \
            include/PRadEventStruct.h \
            include/PRadLogBox.h \
@@ -75,11 +85,14 @@ HEADERS += include/PRadEventViewer.h \
            include/PRadHyCalCluster.h \
            include/PRadSquareCluster.h \
            include/PRadIslandCluster.h \
+           include/PRadIslandKernel.h \
+           include/PRadModuleGrid.h \
            include/PRadGEMSystem.h \
            include/PRadGEMDetector.h \
            include/PRadGEMPlane.h \
            include/PRadGEMFEC.h \
            include/PRadGEMAPV.h \
+           include/PRadAPVKernel.h \
            include/PRadEventFilter.h \
            include/PRadDetCoor.h \
            include/PRadDetMatch.h
@@ -95,7 +108,13 @@ SOURCES += src/main.cpp \
            src/PRadDAQUnit.cpp \
            src/PRadTDCGroup.cpp \
            src/PRadEvioParser.cpp \
+           src/PRadEventPipeline.cpp \
+           src/PRadEvioIndex.cpp \
            src/PRadDSTParser.cpp \
+           src/PRadDSTReader.cpp \
+           src/PRadEventStore.cpp \
+           src/PRadEventPool.cpp \
+           src/PRadThreadPool.cpp \
            src/PRadDataHandler.cpp \
            src/PRadLogBox.cpp \
            src/PRadException.cpp \
@@ -106,11 +125,14 @@ SOURCES += src/main.cpp \
            src/PRadHyCalCluster.cpp \
            src/PRadSquareCluster.cpp \
            src/PRadIslandCluster.cpp \
+           src/PRadIslandKernel.cpp \
+           src/PRadModuleGrid.cpp \
            src/PRadGEMSystem.cpp \
            src/PRadGEMDetector.cpp \
            src/PRadGEMPlane.cpp \
            src/PRadGEMFEC.cpp \
            src/PRadGEMAPV.cpp \
+           src/PRadAPVKernel.cpp \
            src/PRadEventFilter.cpp \
            src/PRadDetCoor.cpp \
            src/PRadDetMatch.cpp
@@ -172,6 +194,11 @@ contains(COMPONENTS, STANDARD_EVIO) {
     LIBS += -L$$(THIRD_LIB) -levio -levioxx
 }
 
+contains(COMPONENTS, ZLIB_COMPRESSION) {
+    DEFINES += USE_ZLIB
+    LIBS += -lz
+}
+
 contains(COMPONENTS, RECON_DISPLAY) {
     DEFINES += RECON_DISPLAY
 }
@@ -21,8 +21,9 @@ int main(int argc, char * argv[])
 {
     char *ptr;
     string output, input;
+    int workers = 0;
 
-    // -i input_file -o output_file
+    // -i input_file -o output_file -j replay_workers
     for(int i = 1; i < argc; ++i)
     {
         ptr = argv[i];
@@ -35,6 +36,9 @@ int main(int argc, char * argv[])
             case 'i':
                 input = argv[++i];
                 break;
+            case 'j':
+                workers = atoi(argv[++i]);
+                break;
             default:
                 printf("Unkown option!\n");
                 exit(1);
@@ -46,6 +50,8 @@ int main(int argc, char * argv[])
 
     // read configuration files
     handler->ReadConfig("config.txt");
+    if(workers > 0)
+        handler->SetReplayWorkers(workers);
 
     PRadBenchMark timer;
 //    handler->ReadFromDST("/work/hallb/prad/replay/prad_001292.dst");
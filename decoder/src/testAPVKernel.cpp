@@ -0,0 +1,227 @@
+//============================================================================//
+// A benchmark of the APV kernels, it runs the scalar, SSE2 and AVX2 levels   //
+// on the same APV frames and checks the results are the same.                //
+// The raw word unpacking and header search are tested on SRS frames, the    //
+// zero suppression on the unpacked time samples. An evio file with raw GEM   //
+// banks can be given to compare the decoding time of the real data           //
+//                                                                            //
+// agent                                                                      //
+// 10/17/2026                                                                 //
+//============================================================================//
+
+#include "PRadAPVKernel.h"
+#include "PRadDataHandler.h"
+#include "PRadBenchMark.h"
+#include <iostream>
+#include <string>
+#include <vector>
+#include <random>
+#include <cstring>
+#include <cstdlib>
+
+#define APV_TIME_SAMPLES 3
+#define APV_SAMPLE_DIFF 140
+#define APV_HEADER_LEVEL 1500
+#define APV_BUFFER_SIZE (APV_TIME_SAMPLES*128 + 166)
+
+using namespace std;
+
+// pack two samples to a SRS word, the reverse of the unpacking
+uint32_t pack_word(const unsigned int &s1, const unsigned int &s2)
+{
+    return ((s2 >> 8)&0xff) | ((s2&0xff) << 8) | ((s1 >> 8)&0xff) << 16 | (s1&0xff) << 24;
+}
+
+void bench_unpack(const vector<vector<uint32_t>> &frames, const int &nframes);
+void bench_zero_sup(const vector<vector<uint32_t>> &frames, const int &nframes);
+void bench_evio(const string &path);
+
+int main(int argc, char * argv[])
+{
+    if(argc > 1 && string(argv[1]).find(".evio") != string::npos) {
+        bench_evio(argv[1]);
+        return 0;
+    }
+
+    int nframes = 200000;
+    if(argc > 1)
+        nframes = atoi(argv[1]);
+
+    // SRS frames of an APV, baseline before the header, 3 samples below the
+    // header level start the header, the channels are 10 samples after it
+    mt19937 rng(12345);
+    uniform_real_distribution<float> uni(0., 1.);
+    vector<vector<uint32_t>> frames(64);
+    for(auto &frame : frames)
+    {
+        vector<unsigned int> samples;
+        size_t pre = 20 + rng()%40;
+        for(size_t i = 0; i < pre; ++i)
+            samples.push_back(2500 + rng()%300);
+        for(size_t ts = 0; ts < APV_TIME_SAMPLES; ++ts)
+        {
+            for(size_t i = 0; i < APV_SAMPLE_DIFF - 128; ++i)
+                samples.push_back((i < 3 || rng()%2) ? 1000 + rng()%100 : 3000 + rng()%100);
+            for(size_t i = 0; i < 128; ++i)
+                samples.push_back(2500 + rng()%300 - ((uni(rng) < 0.03) ? 1000 : 0));
+        }
+        while(samples.size() < APV_BUFFER_SIZE)
+            samples.push_back(2500 + rng()%300);
+
+        for(size_t i = 0; i + 1 < samples.size(); i += 2)
+            frame.push_back(pack_word(samples[i], samples[i + 1]));
+    }
+
+    bench_unpack(frames, nframes);
+    bench_zero_sup(frames, nframes);
+
+    return 0;
+}
+
+void bench_unpack(const vector<vector<uint32_t>> &frames, const int &nframes)
+{
+    vector<float> buf(APV_BUFFER_SIZE), ref_buf(APV_BUFFER_SIZE);
+    size_t words = 0;
+    for(int i = 0; i < nframes; ++i)
+        words += frames[i%frames.size()].size();
+
+    PRadAPVKernel::Level best = PRadAPVKernel::GetBestLevel();
+    for(int l = PRadAPVKernel::Scalar; l <= best; ++l)
+    {
+        PRadAPVKernel::Level level = (PRadAPVKernel::Level) l;
+
+        // check the results with the scalar code
+        bool identical = true;
+        for(auto &frame : frames)
+        {
+            PRadAPVKernel::SetLevel(PRadAPVKernel::Scalar);
+            PRadAPVKernel::SplitData(frame.data(), frame.size(), ref_buf.data());
+            size_t ref_header = PRadAPVKernel::FindHeader(ref_buf.data(), ref_buf.size(), APV_HEADER_LEVEL);
+            PRadAPVKernel::SetLevel(level);
+            PRadAPVKernel::SplitData(frame.data(), frame.size(), buf.data());
+            size_t header = PRadAPVKernel::FindHeader(buf.data(), buf.size(), APV_HEADER_LEVEL);
+            if(memcmp(buf.data(), ref_buf.data(), buf.size()*sizeof(float)) ||
+               header != ref_header)
+                identical = false;
+        }
+
+        PRadBenchMark timer;
+        size_t headers = 0;
+        for(int i = 0; i < nframes; ++i)
+        {
+            const vector<uint32_t> &frame = frames[i%frames.size()];
+            PRadAPVKernel::SplitData(frame.data(), frame.size(), buf.data());
+            headers += PRadAPVKernel::FindHeader(buf.data(), buf.size(), APV_HEADER_LEVEL);
+        }
+        unsigned int time = timer.GetElapsedTime();
+
+        cout << "Unpack " << PRadAPVKernel::GetLevelName(level) << ": "
+             << nframes << " APV frames in " << time << " ms, "
+             << words/1000./time << " M words per second, "
+             << "header sum " << headers << ", results are "
+             << (identical ? "identical." : "different!")
+             << endl;
+    }
+}
+
+void bench_zero_sup(const vector<vector<uint32_t>> &frames, const int &nframes)
+{
+    // pedestal and thresholds of a typical APV, common mode level 20 and
+    // zero suppression level 5 as in the GEM configuration
+    mt19937 rng(54321);
+    uniform_real_distribution<float> uni(0., 1.);
+    PRadAPVKernel::Tables tables;
+    tables.split = false;
+    for(size_t i = 0; i < APV_KERNEL_CHANNELS; ++i)
+    {
+        float noise = 10. + 10.*uni(rng);
+        tables.offset[i] = 2600. + 50.*uni(rng);
+        tables.cm_thres[i] = noise*20.;
+        tables.zs_thres[i] = noise*5.;
+        tables.group[i] = 0;
+    }
+
+    // unpacked frames and the start of time samples
+    PRadAPVKernel::SetLevel(PRadAPVKernel::Scalar);
+    vector<vector<float>> raw;
+    vector<size_t> ts_index;
+    for(auto &frame : frames)
+    {
+        vector<float> samples(APV_BUFFER_SIZE);
+        PRadAPVKernel::SplitData(frame.data(), frame.size(), samples.data());
+        raw.push_back(samples);
+        ts_index.push_back(PRadAPVKernel::FindHeader(samples.data(), samples.size(), APV_HEADER_LEVEL) + 10);
+    }
+
+    vector<float> buf(APV_BUFFER_SIZE), ref_buf(APV_BUFFER_SIZE);
+    bool hit_pos[APV_KERNEL_CHANNELS], ref_hit[APV_KERNEL_CHANNELS];
+
+    PRadAPVKernel::Level best = PRadAPVKernel::GetBestLevel();
+    for(int l = PRadAPVKernel::Scalar; l <= best; ++l)
+    {
+        PRadAPVKernel::Level level = (PRadAPVKernel::Level) l;
+
+        // check the results with the scalar code
+        bool identical = true;
+        for(size_t i = 0; i < raw.size(); ++i)
+        {
+            PRadAPVKernel::SetLevel(PRadAPVKernel::Scalar);
+            ref_buf = raw[i];
+            PRadAPVKernel::ZeroSuppression(tables, &ref_buf[ts_index[i]],
+                                           APV_SAMPLE_DIFF, APV_TIME_SAMPLES, ref_hit);
+            PRadAPVKernel::SetLevel(level);
+            buf = raw[i];
+            PRadAPVKernel::ZeroSuppression(tables, &buf[ts_index[i]],
+                                           APV_SAMPLE_DIFF, APV_TIME_SAMPLES, hit_pos);
+            if(memcmp(buf.data(), ref_buf.data(), buf.size()*sizeof(float)) ||
+               memcmp(hit_pos, ref_hit, sizeof(hit_pos)))
+                identical = false;
+        }
+
+        PRadBenchMark timer;
+        size_t hits = 0;
+        for(int i = 0; i < nframes; ++i)
+        {
+            size_t idx = i%raw.size();
+            memcpy(buf.data(), raw[idx].data(), raw[idx].size()*sizeof(float));
+            PRadAPVKernel::ZeroSuppression(tables, &buf[ts_index[idx]],
+                                           APV_SAMPLE_DIFF, APV_TIME_SAMPLES, hit_pos);
+            for(size_t ch = 0; ch < APV_KERNEL_CHANNELS; ++ch)
+                hits += hit_pos[ch];
+        }
+        unsigned int time = timer.GetElapsedTime();
+
+        cout << "Zero suppression " << PRadAPVKernel::GetLevelName(level) << ": "
+             << nframes << " APV frames in " << time << " ms, "
+             << time*1e6/nframes << " ns per frame, "
+             << hits << " hits, results are "
+             << (identical ? "identical." : "different!")
+             << endl;
+    }
+}
+
+// decode the raw GEM banks in an evio file at each level
+void bench_evio(const string &path)
+{
+    PRadDataHandler *handler = new PRadDataHandler();
+    handler->ReadConfig("config.txt");
+
+    PRadAPVKernel::Level best = PRadAPVKernel::GetBestLevel();
+    for(int l = PRadAPVKernel::Scalar; l <= best; ++l)
+    {
+        PRadAPVKernel::Level level = (PRadAPVKernel::Level) l;
+        PRadAPVKernel::SetLevel(level);
+
+        PRadBenchMark timer;
+        handler->ReadFromEvio(path);
+        unsigned int time = timer.GetElapsedTime();
+
+        cout << "Decode " << PRadAPVKernel::GetLevelName(level) << ": "
+             << handler->GetEventCount() << " events in " << time << " ms"
+             << endl;
+
+        handler->Clear();
+    }
+
+    delete handler;
+}
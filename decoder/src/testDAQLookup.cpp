@@ -0,0 +1,98 @@
+//============================================================================//
+// A micro-benchmark of routing the data words to the DAQ channels, it        //
+// compares the hash map lookup with the direct-indexed lookup table          //
+//                                                                            //
+// agent                                                                      //
+// 10/17/2026                                                                 //
+//============================================================================//
+
+#include "PRadDataHandler.h"
+#include "PRadLookupTable.h"
+#include "PRadBenchMark.h"
+#include <iostream>
+#include <vector>
+#include <unordered_map>
+#include <random>
+#include <cstdlib>
+
+using namespace std;
+
+// stands for a DAQ channel, only the id is needed for routing
+struct Channel
+{
+    int id;
+};
+
+int main(int argc, char * argv[])
+{
+    int words = 20000000;
+    if(argc > 1)
+        words = atoi(argv[1]);
+
+    // HyCal like setup, 6 crates with 20 ADC1881M modules of 64 channels
+    vector<Channel> channels;
+    vector<ChannelAddress> addresses;
+    for(unsigned int crate = 1; crate <= 6; ++crate)
+    {
+        for(unsigned int slot = 3; slot < 23; ++slot)
+        {
+            for(unsigned int ch = 0; ch < 64; ++ch)
+            {
+                channels.push_back(Channel{(int)channels.size()});
+                addresses.emplace_back(crate, slot, ch);
+            }
+        }
+    }
+
+    unordered_map<ChannelAddress, Channel*> map_daq;
+    PRadLookupTable<Channel> table_daq;
+    for(size_t i = 0; i < channels.size(); ++i)
+    {
+        map_daq[addresses[i]] = &channels[i];
+        table_daq.Set(addresses[i], &channels[i]);
+    }
+
+    // data words in the order of readout, with a few unknown addresses
+    vector<ChannelAddress> data;
+    data.reserve(words);
+    mt19937 rng(12345);
+    for(int i = 0; i < words; ++i)
+    {
+        if(rng()%100 == 0)
+            data.emplace_back(6, 25, rng()%64);
+        else
+            data.push_back(addresses[rng()%addresses.size()]);
+    }
+
+    PRadBenchMark timer;
+    long long map_sum = 0;
+    for(auto &addr : data)
+    {
+        auto it = map_daq.find(addr);
+        if(it != map_daq.end())
+            map_sum += it->second->id;
+    }
+    unsigned int map_time = timer.GetElapsedTime();
+
+    timer.Reset();
+    long long table_sum = 0;
+    for(auto &addr : data)
+    {
+        Channel *channel = table_daq.Get(addr);
+        if(channel != nullptr)
+            table_sum += channel->id;
+    }
+    unsigned int table_time = timer.GetElapsedTime();
+
+    cout << "Routed " << words << " words to " << channels.size() << " channels."
+         << endl;
+    cout << "Hash map: " << map_time << " ms, "
+         << map_time*1e6/words << " ns per word" << endl;
+    cout << "Lookup table: " << table_time << " ms, "
+         << table_time*1e6/words << " ns per word, "
+         << table_daq.Size() << " entries" << endl;
+    cout << "Routing results are " << ((map_sum == table_sum) ? "identical." : "different!")
+         << endl;
+
+    return 0;
+}
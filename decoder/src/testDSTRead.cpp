@@ -0,0 +1,130 @@
+//============================================================================//
+// An example comparing the DST reading speed of row and columnar chunks,     //
+// reading all the banks or only the HyCal ADC banks with the read mask, and  //
+// the memory mapped reader that iterates the events without copying them     //
+//                                                                            //
+// agent                                                                      //
+// 10/17/2026                                                                 //
+//============================================================================//
+
+#include "PRadDataHandler.h"
+#include "PRadDSTParser.h"
+#include "PRadDSTReader.h"
+#include "PRadBenchMark.h"
+#include <iostream>
+#include <string>
+#include <cstdlib>
+
+using namespace std;
+
+void write_file(PRadDSTParser *dst_parser, const string &path, EventData &event, const int &events)
+{
+    dst_parser->OpenOutput(path);
+    for(int i = 0; i < events; ++i)
+    {
+        event.event_number = i;
+        dst_parser->WriteEvent(event);
+    }
+    dst_parser->CloseOutput();
+    cout << "Wrote " << path << ", " << dst_parser->GetBytesWritten()/1024./1024.
+         << " MB." << endl;
+}
+
+void read_file(PRadDSTParser *dst_parser, const string &path, const uint32_t &mask, const string &name)
+{
+    PRadBenchMark timer;
+    int events = 0;
+    size_t adc_hits = 0;
+
+    dst_parser->SetReadMask(mask);
+    dst_parser->OpenInput(path);
+    while(dst_parser->Read())
+    {
+        if(dst_parser->EventType() == PRad_DST_Event) {
+            adc_hits += dst_parser->GetEvent().adc_data.size();
+            ++events;
+        }
+    }
+    dst_parser->CloseInput();
+
+    unsigned int ms = timer.GetElapsedTime();
+    double sec = (ms > 0) ? ms/1000. : 0.001;
+    cout << name << ": " << events << " events, " << adc_hits << " adc hits in "
+         << sec << " s, " << events/sec << " events/s" << endl;
+}
+
+void map_file(PRadDSTReader *dst_reader, const string &path, const uint32_t &mask, const string &name)
+{
+    PRadBenchMark timer;
+    int events = 0;
+    size_t adc_hits = 0;
+    double adc_sum = 0.;
+
+    dst_reader->SetReadMask(mask);
+    dst_reader->Open(path);
+    while(dst_reader->Read())
+    {
+        if(dst_reader->EventType() == PRad_DST_Event) {
+            const EventView &event = dst_reader->GetEvent();
+            for(const auto &adc : event.adc_data)
+                adc_sum += adc.value;
+            adc_hits += event.adc_data.size();
+            ++events;
+        }
+    }
+    dst_reader->Close();
+
+    unsigned int ms = timer.GetElapsedTime();
+    double sec = (ms > 0) ? ms/1000. : 0.001;
+    cout << name << ": " << events << " events, " << adc_hits << " adc hits in "
+         << sec << " s, " << events/sec << " events/s" << endl;
+}
+
+int main(int argc, char * argv[])
+{
+    int events = 200000;
+    if(argc > 1)
+        events = atoi(argv[1]);
+
+    // a typical physics event, HyCal and GEM hits with 3 time samples
+    EventData event(CODA_Event);
+    event.trigger = PHYS_TotalSum;
+    for(int i = 0; i < 150; ++i)
+        event.add_adc(ADC_Data(i*10, 100 + i));
+    for(int i = 0; i < 20; ++i)
+        event.add_tdc(TDC_Data(i, 1000 + i));
+    for(int i = 0; i < 100; ++i)
+    {
+        GEM_Data gem(i%8, i%16, i);
+        gem.add_value(100.);
+        gem.add_value(200.);
+        gem.add_value(150.);
+        event.add_gemhit(gem);
+    }
+    for(int i = 0; i < 12; ++i)
+        event.add_dsc(DSC_Data(1000, 2000));
+
+    PRadDataHandler *handler = new PRadDataHandler();
+    PRadDSTParser *dst_parser = new PRadDSTParser(handler);
+    dst_parser->SetMode(DST_UPDATE_NONE);
+
+    dst_parser->SetColumnar(false);
+    write_file(dst_parser, "test_row.dst", event, events);
+    dst_parser->SetColumnar(true);
+    write_file(dst_parser, "test_column.dst", event, events);
+
+    read_file(dst_parser, "test_row.dst", DST_READ_ALL, "Row chunks, all banks");
+    read_file(dst_parser, "test_row.dst", DST_READ_ADC, "Row chunks, ADC only");
+    read_file(dst_parser, "test_column.dst", DST_READ_ALL, "Column chunks, all banks");
+    read_file(dst_parser, "test_column.dst", DST_READ_ADC, "Column chunks, ADC only");
+
+    PRadDSTReader *dst_reader = new PRadDSTReader();
+    map_file(dst_reader, "test_row.dst", DST_READ_ALL, "Mapped row chunks, all banks");
+    map_file(dst_reader, "test_column.dst", DST_READ_ALL, "Mapped column chunks, all banks");
+    map_file(dst_reader, "test_column.dst", DST_READ_ADC, "Mapped column chunks, ADC only");
+    delete dst_reader;
+
+    delete dst_parser;
+    delete handler;
+    return 0;
+}
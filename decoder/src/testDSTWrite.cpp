@@ -0,0 +1,184 @@
+//============================================================================//
+// An example comparing the DST writing speed, the per-word stream writing    //
+// that was used before, the block-buffered and the chunked v2 writing        //
+//                                                                            //
+// agent                                                                      //
+// 10/17/2026                                                                 //
+//============================================================================//
+
+#include "PRadDataHandler.h"
+#include "PRadDSTParser.h"
+#include "PRadBenchMark.h"
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <random>
+#include <cstdlib>
+
+using namespace std;
+
+// the old way, one stream call for each data word
+void write_event_per_word(ofstream &out, const EventData &data)
+{
+    uint32_t event_info = (PRad_DST_EvHeader << 8) | PRad_DST_Event;
+    out.write((char*) &event_info, sizeof(event_info));
+
+    out.write((char*) &data.event_number, sizeof(data.event_number));
+    out.write((char*) &data.type        , sizeof(data.type));
+    out.write((char*) &data.trigger     , sizeof(data.trigger));
+    out.write((char*) &data.timestamp   , sizeof(data.timestamp));
+
+    uint32_t adc_size = data.adc_data.size();
+    uint32_t tdc_size = data.tdc_data.size();
+    uint32_t gem_size = data.gem_data.size();
+    uint32_t dsc_size = data.dsc_data.size();
+
+    out.write((char*) &adc_size, sizeof(adc_size));
+    for(auto &adc : data.adc_data)
+        out.write((char*) &adc, sizeof(adc));
+
+    out.write((char*) &tdc_size, sizeof(tdc_size));
+    for(auto &tdc : data.tdc_data)
+        out.write((char*) &tdc, sizeof(tdc));
+
+    out.write((char*) &gem_size, sizeof(gem_size));
+    for(auto &gem : data.gem_data)
+    {
+        out.write((char*) &gem.addr, sizeof(gem.addr));
+        uint32_t hit_size = gem.values.size();
+        out.write((char*) &hit_size, sizeof(hit_size));
+        for(auto &value : gem.values)
+            out.write((char*) &value, sizeof(value));
+    }
+
+    out.write((char*) &dsc_size, sizeof(dsc_size));
+    for(auto &dsc : data.dsc_data)
+        out.write((char*) &dsc, sizeof(dsc));
+}
+
+// physics events with different hits, so the compression ratio is close to
+// the one of real data instead of the one of a repeated event
+void make_events(vector<EventData> &pool)
+{
+    mt19937 rng(2016);
+    uniform_real_distribution<double> uni(0., 1.);
+    normal_distribution<double> noise(0., 1.);
+
+    unsigned int gated = 0, ungated = 0;
+    for(size_t k = 0; k < pool.size(); ++k)
+    {
+        EventData &event = pool[k];
+        event = EventData(CODA_Event);
+        event.trigger = PHYS_TotalSum;
+        event.timestamp = k*1000 + rng()%1000;
+
+        // HyCal channels above the sparsification threshold, a few of them
+        // have the shower signal on top of the pedestal
+        int nadc = 100 + rng()%100;
+        unsigned short id = 0;
+        for(int i = 0; i < nadc; ++i)
+        {
+            id += 1 + rng()%16;
+            double value = 400. + 50.*uni(rng) + 5.*noise(rng);
+            if(uni(rng) < 0.1)
+                value += 3000.*uni(rng);
+            event.add_adc(ADC_Data(id, (unsigned short)value));
+        }
+
+        int ntdc = 10 + rng()%20;
+        for(int i = 0; i < ntdc; ++i)
+            event.add_tdc(TDC_Data(rng()%64, (unsigned short)(1000 + 100.*noise(rng))));
+
+        // GEM strips with 3 time samples, the charges rise and fall
+        int ngem = 50 + rng()%100;
+        for(int i = 0; i < ngem; ++i)
+        {
+            GEM_Data gem(rng()%8, rng()%16, rng()%128);
+            double charge = 100. + 1000.*uni(rng);
+            gem.add_value(0.3*charge + 10.*noise(rng));
+            gem.add_value(charge + 10.*noise(rng));
+            gem.add_value(0.6*charge + 10.*noise(rng));
+            event.add_gemhit(gem);
+        }
+
+        // scalers are counting up
+        gated += rng()%100;
+        ungated += 100 + rng()%100;
+        for(int i = 0; i < 12; ++i)
+            event.add_dsc(DSC_Data(gated + i, ungated + i));
+    }
+}
+
+void print_rate(const string &name, const double &bytes, const int &events, const unsigned int &ms)
+{
+    double sec = (ms > 0) ? ms/1000. : 0.001;
+    cout << name << ": " << events << " events, " << bytes/1024./1024. << " MB in "
+         << sec << " s, " << bytes/1024./1024./sec << " MB/s, "
+         << events/sec << " events/s" << endl;
+}
+
+int main(int argc, char * argv[])
+{
+    int events = 200000;
+    if(argc > 1)
+        events = atoi(argv[1]);
+
+    // more events than a v2 chunk, so no chunk is made of repeated events
+    vector<EventData> pool(4096);
+    make_events(pool);
+
+    PRadBenchMark timer;
+
+    // old path
+    ofstream out("test_per_word.dst", ios::out | ios::binary);
+    for(int i = 0; i < events; ++i)
+    {
+        EventData &event = pool[i%pool.size()];
+        event.event_number = i;
+        write_event_per_word(out, event);
+    }
+    out.close();
+    double old_bytes = ifstream("test_per_word.dst", ios::binary | ios::ate).tellg();
+    print_rate("Per-word writing", old_bytes, events, timer.GetElapsedTime());
+
+    // new path
+    PRadDataHandler *handler = new PRadDataHandler();
+    PRadDSTParser *dst_parser = new PRadDSTParser(handler);
+
+    timer.Reset();
+    dst_parser->SetOutputVersion(1);
+    dst_parser->OpenOutput("test_buffered.dst");
+    for(int i = 0; i < events; ++i)
+    {
+        EventData &event = pool[i%pool.size()];
+        event.event_number = i;
+        dst_parser->WriteEvent(event);
+    }
+    dst_parser->CloseOutput();
+    double serialized_bytes = dst_parser->GetBytesWritten();
+    print_rate("Block-buffered writing", serialized_bytes, events, timer.GetElapsedTime());
+
+    // chunked and compressed
+    timer.Reset();
+    dst_parser->SetOutputVersion(2);
+    dst_parser->OpenOutput("test_chunked.dst");
+    for(int i = 0; i < events; ++i)
+    {
+        EventData &event = pool[i%pool.size()];
+        event.event_number = i;
+        dst_parser->WriteEvent(event);
+    }
+    dst_parser->CloseOutput();
+    // the same events are serialized, so the rate is on the uncompressed
+    // bytes as the ones above, the compressed size is printed separately
+    unsigned int chunked_time = timer.GetElapsedTime();
+    double compressed_bytes = dst_parser->GetBytesWritten();
+    print_rate("Chunked v2 writing", serialized_bytes, events, chunked_time);
+    cout << "Chunked v2 file: " << compressed_bytes/1024./1024. << " MB, "
+         << "compression ratio " << serialized_bytes/compressed_bytes << endl;
+
+    delete dst_parser;
+    delete handler;
+    return 0;
+}
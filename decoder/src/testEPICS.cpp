@@ -44,7 +44,7 @@ int main(int /*argc*/, char * /*argv*/ [])
         if(dst_parser->EventType() == PRad_DST_Event) {
             ++count;
             // you can push this event into data handler
-            // handler->GetEventData().push_back(dst_parser->GetEvent()
+            // handler->GetEventStore().Add(dst_parser->GetEvent());
             // or you can just do something with this event and discard it
             auto event = dst_parser->GetEvent();
             cout << event.event_number << "  ";
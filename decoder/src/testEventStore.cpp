@@ -0,0 +1,166 @@
+//============================================================================//
+// An example comparing the event storage, a deque of event data containers  //
+// that was used before and the event store that packs the data banks in     //
+// contiguous arenas, it measures the filling time and a full-run loop        //
+//                                                                            //
+// agent                                                                      //
+// 10/17/2026                                                                 //
+//============================================================================//
+
+#include "PRadEventStore.h"
+#include "PRadBenchMark.h"
+#include <iostream>
+#include <deque>
+#include <cstdlib>
+#include <cstdio>
+
+using namespace std;
+
+// a typical physics event, HyCal and GEM hits with 3 time samples
+EventData make_event(const int &ev)
+{
+    EventData event(CODA_Event);
+    event.event_number = ev;
+    event.trigger = PHYS_TotalSum;
+    for(int i = 0; i < 100 + ev%50; ++i)
+        event.add_adc(ADC_Data(i*10, 100 + i));
+    for(int i = 0; i < 10; ++i)
+        event.add_tdc(TDC_Data(i, 1000 + i));
+    for(int i = 0; i < 80 + ev%40; ++i)
+    {
+        GEM_Data gem(i%8, i%16, i);
+        gem.add_value(100.);
+        gem.add_value(200.);
+        gem.add_value(150.);
+        event.add_gemhit(gem);
+    }
+    return event;
+}
+
+// the heap blocks of the event data containers, a rough estimation
+size_t event_bytes(const EventData &event)
+{
+    size_t bytes = sizeof(EventData)
+                   + event.adc_data.capacity()*sizeof(ADC_Data)
+                   + event.tdc_data.capacity()*sizeof(TDC_Data)
+                   + event.gem_data.capacity()*sizeof(GEM_Data)
+                   + event.dsc_data.capacity()*sizeof(DSC_Data);
+    // the GEM samples only use heap memory beyond the inline buffer
+    for(auto &gem : event.gem_data)
+    {
+        if(gem.values.capacity() > GEM_INLINE_SAMPLES)
+            bytes += gem.values.capacity()*sizeof(float);
+    }
+    return bytes;
+}
+
+template<typename T>
+double adc_sum(const T &event)
+{
+    double sum = 0.;
+    for(const auto &adc : event.adc_data)
+        sum += adc.value;
+    for(const auto &gem : event.gem_data)
+        for(const auto &value : gem.values)
+            sum += value;
+    return sum;
+}
+
+int main(int argc, char * argv[])
+{
+    int events = 200000;
+    if(argc > 1)
+        events = atoi(argv[1]);
+
+    PRadBenchMark timer;
+
+    // old path
+    deque<EventData> event_deque;
+    size_t deque_bytes = 0;
+    for(int i = 0; i < events; ++i)
+    {
+        event_deque.emplace_back(make_event(i));
+        deque_bytes += event_bytes(event_deque.back());
+    }
+    unsigned int deque_fill = timer.GetElapsedTime();
+
+    timer.Reset();
+    double deque_sum = 0.;
+    for(auto &event : event_deque)
+        deque_sum += adc_sum(event);
+    unsigned int deque_loop = timer.GetElapsedTime();
+
+    event_deque = deque<EventData>();
+
+    // event store
+    timer.Reset();
+    PRadEventStore store;
+    for(int i = 0; i < events; ++i)
+        store.Add(make_event(i));
+    unsigned int store_fill = timer.GetElapsedTime();
+
+    timer.Reset();
+    double store_sum = 0.;
+    for(size_t i = 0; i < store.Size(); ++i)
+        store_sum += adc_sum(store.View(i));
+    unsigned int store_loop = timer.GetElapsedTime();
+
+    cout << "Event deque: " << events << " events, "
+         << deque_bytes/1024./1024. << " MB, filled in " << deque_fill
+         << " ms, full loop in " << deque_loop << " ms" << endl;
+    cout << "Event store: " << events << " events, "
+         << store.GetMemoryUsage()/1024./1024. << " MB, filled in " << store_fill
+         << " ms, full loop in " << store_loop << " ms" << endl;
+    cout << "Loop results are " << ((deque_sum == store_sum) ? "identical." : "different!")
+         << endl;
+
+    // spill mode with a directory that does not exist, the store should fall
+    // back to keeping all the events instead of retrying the spill
+    PRadEventStore spill_store;
+    spill_store.SetStorage(Storage_Spill, 100, "/nonexistent_prad_spill_dir");
+    for(int i = 0; i < 1000; ++i)
+        spill_store.Add(make_event(i));
+
+    bool spill_ok = (spill_store.GetStorage() == Storage_KeepAll) &&
+                    (spill_store.Size() == 1000) &&
+                    (spill_store.View(999).event_number == 999);
+    cout << "Spill to a missing directory: "
+         << (spill_ok ? "kept all the events." : "failed!")
+         << endl;
+
+    // the spilled events are empty after the spill file is removed, the store
+    // should report the error instead of throwing
+    PRadEventStore lost_store;
+    lost_store.SetStorage(Storage_Spill, 100, "/tmp");
+    for(int i = 0; i < 1000; ++i)
+        lost_store.Add(make_event(i));
+
+    bool lost_ok = (lost_store.GetSpilledCount() > 0) &&
+                   (remove(lost_store.GetSpillPath().c_str()) == 0) &&
+                   (lost_store.View(150).event_number == 0) &&
+                   (lost_store.View(0).adc_data.size() == 0) &&
+                   (lost_store.At(1).adc_data.size() == 0) &&
+                   (lost_store.View(999).event_number == 999);
+    cout << "Removed spill file: "
+         << (lost_ok ? "the spilled events are empty." : "failed!")
+         << endl;
+
+    // online mode keeps only the last event, the block is reused
+    PRadEventStore online_store;
+    online_store.Add(make_event(0));
+    size_t online_bytes = online_store.GetMemoryUsage();
+    for(int i = 1; i < 1000; ++i)
+    {
+        online_store.Reset();
+        online_store.Add(make_event(i));
+    }
+
+    bool online_ok = (online_store.Size() == 1) &&
+                     (online_store.View(0).event_number == 999) &&
+                     (online_store.GetMemoryUsage() <= 2*online_bytes);
+    cout << "Online mode reset: "
+         << (online_ok ? "the block is reused." : "failed!")
+         << endl;
+
+    return (spill_ok && lost_ok && online_ok) ? 0 : -1;
+}
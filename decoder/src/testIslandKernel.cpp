@@ -0,0 +1,304 @@
+//============================================================================//
+// A test of the C++ island kernel, it reconstructs the same synthetic events //
+// with island.F and with the kernel, and checks the gammas are the same.     //
+// Then the events are reconstructed again by the copies of the kernel in the //
+// thread pool to check the instances are independent                         //
+//                                                                            //
+// agent                                                                      //
+// 10/17/2026                                                                 //
+//============================================================================//
+
+#include "PRadIslandKernel.h"
+#include "PRadThreadPool.h"
+#include "PRadBenchMark.h"
+#include <iostream>
+#include <string>
+#include <vector>
+#include <random>
+#include <cmath>
+#include <cstring>
+#include <cstdlib>
+
+#define MCOL 34
+#define MROW 34
+#define MAX_CC 60
+
+using namespace std;
+
+// common blocks of island.F
+extern "C"
+{
+    void load_pwo_prof_(char* config_dir, int str_len);
+    void load_lg_prof_(char* config_dir, int str_len);
+    void main_island_();
+    extern struct
+    {
+        int ech[MROW][MCOL];
+    } ech_common_;
+
+    extern struct
+    {
+        int stat_ch[MROW][MCOL];
+    } stat_ch_common_;
+
+    extern struct
+    {
+        int icl_index[MAX_CC][200], icl_iener[MAX_CC][200];
+    } icl_common_;
+
+    extern struct
+    {
+        float xsize, ysize, mine, maxe;
+        int min_dime;
+        float minm;
+        int ncol, nrow;
+        float zhycal;
+        int isect;
+    } set_common_;
+
+    extern struct
+    {
+        int nadcgam;
+        union
+        {
+            int iadcgam[50][11];
+            float fadcgam[50][11];
+        } u;
+    } adcgam_cbk_;
+}
+
+struct SectorEvent
+{
+    int isect, ncol, nrow;
+    float xsize, ysize;
+    int ech[MCOL][MROW];
+    int stat[MCOL][MROW];
+};
+
+void make_event(mt19937 &rng, SectorEvent &event);
+int run_fortran(const SectorEvent &event);
+int run_kernel(PRadIslandKernel &kernel, const SectorEvent &event);
+bool same_gamma(const PRadIslandKernel::Gamma &g1, const PRadIslandKernel::Gamma &g2);
+
+int main(int argc, char * argv[])
+{
+    int nevents = 20000;
+    string pwo_prof = "config/prof_pwo.dat", lg_prof = "config/prof_lg.dat";
+    if(argc > 1)
+        nevents = atoi(argv[1]);
+    if(argc > 3) {
+        pwo_prof = argv[2];
+        lg_prof = argv[3];
+    }
+
+    char c_path[256];
+    strcpy(c_path, pwo_prof.c_str());
+    load_pwo_prof_(c_path, strlen(c_path));
+    strcpy(c_path, lg_prof.c_str());
+    load_lg_prof_(c_path, strlen(c_path));
+
+    PRadIslandKernel kernel;
+    if(!kernel.LoadProfile(0, pwo_prof) || !kernel.LoadProfile(1, lg_prof))
+        return -1;
+
+    mt19937 rng(2016);
+    vector<SectorEvent> events(nevents);
+    for(auto &event : events)
+        make_event(rng, event);
+
+    // reference from island.F
+    vector<vector<PRadIslandKernel::Gamma>> reference(nevents);
+    PRadBenchMark timer;
+    for(int i = 0; i < nevents; ++i)
+    {
+        int ngamma = run_fortran(events[i]);
+        for(int k = 0; k < ngamma; ++k)
+        {
+            PRadIslandKernel::Gamma gamma;
+            float *fval = adcgam_cbk_.u.fadcgam[k];
+            int *ival = adcgam_cbk_.u.iadcgam[k];
+            gamma.energy = fval[0];
+            gamma.x = fval[1];
+            gamma.y = fval[2];
+            gamma.chi2 = fval[6];
+            gamma.type = ival[7];
+            gamma.dime = ival[8];
+            gamma.id = ival[9];
+            gamma.status = ival[10];
+            for(int j = 0; j < gamma.dime && j < MAX_CC; ++j)
+            {
+                gamma.icl_index[j] = icl_common_.icl_index[j][k];
+                gamma.icl_iener[j] = icl_common_.icl_iener[j][k];
+            }
+            reference[i].push_back(gamma);
+        }
+    }
+    unsigned int fortran_time = timer.GetElapsedTime();
+
+    // kernel in this thread
+    int ngammas = 0, mismatch = 0;
+    timer.Reset();
+    for(int i = 0; i < nevents; ++i)
+    {
+        int ngamma = run_kernel(kernel, events[i]);
+        bool identical = (ngamma == (int)reference[i].size());
+        for(int k = 0; identical && k < ngamma; ++k)
+            identical = same_gamma(kernel.GetGamma(k), reference[i][k]);
+        ngammas += ngamma;
+        mismatch += !identical;
+    }
+    unsigned int kernel_time = timer.GetElapsedTime();
+
+    cout << "island.F: " << fortran_time << " ms, "
+         << "kernel: " << kernel_time << " ms, "
+         << nevents << " events, " << ngammas << " gammas, "
+         << mismatch << " events are different."
+         << endl;
+
+    // copies of the kernel in the pool
+    PRadThreadPool pool(PRadThreadPool::GetDefaultSize());
+    size_t nblocks = max(pool.GetThreadNumber(), (size_t)1);
+    vector<int> block_mismatch(nblocks, 0);
+    timer.Reset();
+    pool.ParallelFor(nblocks, [&] (const size_t &b)
+    {
+        PRadIslandKernel copy(kernel);
+        for(int i = b; i < nevents; i += nblocks)
+        {
+            int ngamma = run_kernel(copy, events[i]);
+            bool identical = (ngamma == (int)reference[i].size());
+            for(int k = 0; identical && k < ngamma; ++k)
+                identical = same_gamma(copy.GetGamma(k), reference[i][k]);
+            block_mismatch[b] += !identical;
+        }
+    }, "Island Kernel");
+    unsigned int pool_time = timer.GetElapsedTime();
+
+    mismatch = 0;
+    for(auto &val : block_mismatch)
+        mismatch += val;
+
+    cout << "Pool with " << pool.GetThreadNumber() << " threads: "
+         << pool_time << " ms, "
+         << mismatch << " events are different."
+         << endl;
+
+    return 0;
+}
+
+// fraction of a shower in a cell at distance d (in cell size)
+inline double cell_fraction(const double &d, const double &width)
+{
+    return 0.5*(erf((d + 0.5)/width) - erf((d - 0.5)/width));
+}
+
+// showers in one sector, some of them are close to each other so there are
+// clusters with several peaks, the energies are in 0.1 MeV
+void make_event(mt19937 &rng, SectorEvent &event)
+{
+    const int dims[5][2] = {{34, 34}, {24, 6}, {6, 24}, {24, 6}, {6, 24}};
+    uniform_real_distribution<double> uni(0., 1.);
+
+    event.isect = rng()%5;
+    event.ncol = dims[event.isect][0];
+    event.nrow = dims[event.isect][1];
+    event.xsize = event.isect ? 3.815 : 2.077;
+    event.ysize = event.isect ? 3.815 : 2.075;
+    memset(event.ech, 0, sizeof(event.ech));
+    memset(event.stat, 0, sizeof(event.stat));
+
+    // hole and dead modules
+    if(event.isect == 0) {
+        event.stat[16][16] = event.stat[16][17] = -1;
+        event.stat[17][16] = event.stat[17][17] = -1;
+    }
+    for(int k = 0; k < 3; ++k)
+        event.stat[rng()%event.ncol][rng()%event.nrow] = 1;
+
+    double width = event.isect ? 0.3 : 0.4;
+    int nshowers = 1 + rng()%5;
+    double energy[5], x[5], y[5];
+    for(int k = 0; k < nshowers; ++k)
+    {
+        energy[k] = 500. + 30000.*uni(rng);
+        if(k > 0 && uni(rng) < 0.4) {
+            x[k] = x[0] + 2.5*(uni(rng) - 0.5);
+            y[k] = y[0] + 2.5*(uni(rng) - 0.5);
+        } else {
+            x[k] = 1. + (event.ncol - 1)*uni(rng);
+            y[k] = 1. + (event.nrow - 1)*uni(rng);
+        }
+    }
+
+    for(int i = 1; i <= event.ncol; ++i)
+    {
+        for(int j = 1; j <= event.nrow; ++j)
+        {
+            if(event.stat[i-1][j-1])
+                continue;
+
+            double e = 0.;
+            for(int k = 0; k < nshowers; ++k)
+                e += energy[k]*cell_fraction(i - x[k], width)*cell_fraction(j - y[k], width);
+            e = e*(1. + 0.05*(uni(rng) - 0.5)) + 20.*(uni(rng) - 0.5);
+
+            // 5 MeV threshold
+            if(e > 50.)
+                event.ech[i-1][j-1] = int(e + 0.5);
+        }
+    }
+}
+
+int run_fortran(const SectorEvent &event)
+{
+    set_common_.xsize = event.xsize;
+    set_common_.ysize = event.ysize;
+    set_common_.ncol = event.ncol;
+    set_common_.nrow = event.nrow;
+    set_common_.isect = event.isect;
+
+    for(int i = 0; i < MCOL; ++i)
+    {
+        for(int j = 0; j < MROW; ++j)
+        {
+            ech_common_.ech[j][i] = event.ech[i][j];
+            stat_ch_common_.stat_ch[j][i] = event.stat[i][j];
+        }
+    }
+
+    main_island_();
+    return adcgam_cbk_.nadcgam;
+}
+
+int run_kernel(PRadIslandKernel &kernel, const SectorEvent &event)
+{
+    kernel.SetSector(event.isect, event.ncol, event.nrow, event.xsize, event.ysize);
+
+    for(int i = 0; i < MCOL; ++i)
+    {
+        for(int j = 0; j < MROW; ++j)
+        {
+            kernel.SetStatus(i + 1, j + 1, event.stat[i][j]);
+            if(event.ech[i][j])
+                kernel.SetEnergy(i + 1, j + 1, event.ech[i][j]);
+        }
+    }
+
+    return kernel.Reconstruct();
+}
+
+// the results should be exactly the same
+bool same_gamma(const PRadIslandKernel::Gamma &g1, const PRadIslandKernel::Gamma &g2)
+{
+    if(g1.energy != g2.energy || g1.x != g2.x || g1.y != g2.y || g1.chi2 != g2.chi2 ||
+       g1.type != g2.type || g1.dime != g2.dime || g1.id != g2.id || g1.status != g2.status)
+        return false;
+
+    for(int j = 0; j < g1.dime && j < MAX_CC; ++j)
+    {
+        if(g1.icl_index[j] != g2.icl_index[j] || g1.icl_iener[j] != g2.icl_iener[j])
+            return false;
+    }
+
+    return true;
+}
@@ -0,0 +1,166 @@
+//============================================================================//
+// A benchmark of the island reconstruction with the precomputed profiles.    //
+// Synthetic events with several showers on HyCal are made from the channel  //
+// map, then they are reconstructed with the double exponential weight from  //
+// the Finv table and from the bisection, the time and the differences of    //
+// the cluster positions are printed. The profile lookup of the kernel is    //
+// compared with island.F in testIslandKernel                                 //
+//                                                                            //
+// agent                                                                      //
+// 10/17/2026                                                                 //
+//============================================================================//
+
+#include "PRadDataHandler.h"
+#include "PRadIslandCluster.h"
+#include "PRadBenchMark.h"
+#include "PRadDAQUnit.h"
+#include <iostream>
+#include <string>
+#include <vector>
+#include <random>
+#include <cmath>
+#include <cstdlib>
+
+using namespace std;
+
+// island method with the double exponential weight, the Finv table can be
+// dropped so the weights are from the bisection
+class WeightIsland : public PRadIslandCluster
+{
+public:
+    WeightIsland(bool bisection) : use_bisection(bisection) {};
+    void Configure(const string &path)
+    {
+        PRadIslandCluster::Configure(path);
+        fUse2ExpWeight = 1;
+        if(use_bisection)
+            fFinvTable.clear();
+    }
+
+private:
+    bool use_bisection;
+};
+
+void make_event(mt19937 &rng, PRadDataHandler *handler, EventData &event);
+unsigned int run_method(PRadDataHandler *handler, const string &name,
+                        vector<EventData> &events, vector<vector<HyCalHit>> &clusters);
+
+int main(int argc, char * argv[])
+{
+    int nevents = 10000;
+    if(argc > 1)
+        nevents = atoi(argv[1]);
+
+    PRadDataHandler *handler = new PRadDataHandler();
+    handler->ReadConfig("config.txt");
+    handler->AddHyCalClusterMethod(new WeightIsland(false), "Island Table", "config/island.conf");
+    handler->AddHyCalClusterMethod(new WeightIsland(true), "Island Bisection", "config/island.conf");
+
+    mt19937 rng(2016);
+    vector<EventData> events(nevents);
+    for(auto &event : events)
+        make_event(rng, handler, event);
+
+    vector<vector<HyCalHit>> log_res, table_res, bisect_res;
+    unsigned int log_time = run_method(handler, "Island", events, log_res);
+    unsigned int table_time = run_method(handler, "Island Table", events, table_res);
+    unsigned int bisect_time = run_method(handler, "Island Bisection", events, bisect_res);
+
+    int nclusters = 0, different = 0;
+    double max_dpos = 0.;
+    for(int i = 0; i < nevents; ++i)
+    {
+        nclusters += table_res[i].size();
+        if(table_res[i].size() != bisect_res[i].size()) {
+            different++;
+            continue;
+        }
+
+        for(size_t k = 0; k < table_res[i].size(); ++k)
+        {
+            max_dpos = max(max_dpos, (double)fabs(table_res[i][k].x_log - bisect_res[i][k].x_log));
+            max_dpos = max(max_dpos, (double)fabs(table_res[i][k].y_log - bisect_res[i][k].y_log));
+        }
+    }
+
+    cout << nevents << " events, " << nclusters << " clusters." << endl
+         << "Log weight: " << log_time << " ms, "
+         << "double exponential weight from table: " << table_time << " ms, "
+         << "from bisection: " << bisect_time << " ms."
+         << endl
+         << different << " events have different clusters, "
+         << "the largest position difference is " << max_dpos << " mm."
+         << endl;
+
+    return 0;
+}
+
+// fraction of a shower in a module at distance d (in module size)
+inline double module_fraction(const double &d, const double &width)
+{
+    return 0.5*(erf((d + 0.5)/width) - erf((d - 0.5)/width));
+}
+
+// 2 to 8 showers on HyCal, some of them are close to each other, the adc
+// values are from the pedestals and the calibration factors
+void make_event(mt19937 &rng, PRadDataHandler *handler, EventData &event)
+{
+    uniform_real_distribution<double> uni(0., 1.);
+
+    int nshowers = 2 + rng()%7;
+    vector<double> energy(nshowers), x(nshowers), y(nshowers);
+    for(int k = 0; k < nshowers; ++k)
+    {
+        energy[k] = 200. + 1800.*uni(rng);
+        if(k > 0 && uni(rng) < 0.3) {
+            x[k] = x[0] + 60.*(uni(rng) - 0.5);
+            y[k] = y[0] + 60.*(uni(rng) - 0.5);
+        } else {
+            do {
+                x[k] = 1100.*(uni(rng) - 0.5);
+                y[k] = 1100.*(uni(rng) - 0.5);
+            } while(fabs(x[k]) < 40. && fabs(y[k]) < 40.);
+        }
+    }
+
+    event.adc_data.clear();
+    for(auto &channel : handler->GetChannelList())
+    {
+        PRadDAQUnit::Geometry geo = channel->GetGeometry();
+        if(geo.type != PRadDAQUnit::LeadGlass && geo.type != PRadDAQUnit::LeadTungstate)
+            continue;
+        if(channel->GetCalibrationFactor() <= 0.)
+            continue;
+
+        double width = (geo.type == PRadDAQUnit::LeadTungstate) ? 0.4 : 0.3;
+        double e = 0.;
+        for(int k = 0; k < nshowers; ++k)
+            e += energy[k]*module_fraction((x[k] - geo.x)/geo.size_x, width)
+                          *module_fraction((y[k] - geo.y)/geo.size_y, width);
+        e = e*(1. + 0.05*(uni(rng) - 0.5)) + 2.*(uni(rng) - 0.5);
+
+        // 5 MeV threshold
+        if(e < 5.)
+            continue;
+
+        double adc = channel->GetPedestal().mean + e/channel->GetCalibrationFactor();
+        event.add_adc(ADC_Data(channel->GetID(), (unsigned short)(adc + 0.5)));
+    }
+}
+
+unsigned int run_method(PRadDataHandler *handler, const string &name,
+                        vector<EventData> &events, vector<vector<HyCalHit>> &clusters)
+{
+    handler->SetHyCalClusterMethod(name);
+    clusters.resize(events.size());
+
+    PRadBenchMark timer;
+    for(size_t i = 0; i < events.size(); ++i)
+    {
+        handler->HyCalReconstruct(events[i]);
+        auto hits = handler->GetHyCalCluster();
+        clusters[i].assign(hits.begin(), hits.end());
+    }
+
+    return timer.GetElapsedTime();
+}
@@ -46,7 +46,7 @@ int main(int /*argc*/, char * /*argv*/ [])
             ++count;
             // you can push this event into data handler
             // stored event enables you to check it one by one
-            handler->GetEventData().push_back(dst_parser->GetEvent());
+            handler->GetEventStore().Add(dst_parser->GetEvent());
             // fill the event into histograms
             // if you only want to deal with histograms, you can comment
             // the above lines to save memory
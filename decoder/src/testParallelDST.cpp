@@ -0,0 +1,95 @@
+//============================================================================//
+// An example of processing a chunked DST file in parallel, the chunk ranges  //
+// are reconstructed by cloned handlers and the outputs are merged in order   //
+//                                                                            //
+// agent                                                                      //
+// 10/17/2026                                                                 //
+//============================================================================//
+
+#include "PRadDataHandler.h"
+#include "PRadDSTParser.h"
+#include "PRadBenchMark.h"
+#include "PRadGEMSystem.h"
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cstdlib>
+
+using namespace std;
+
+// the output of one chunk range
+struct ClusterOutput
+{
+    vector<int> events;
+    vector<int> clusters;
+    double energy;
+
+    ClusterOutput() : energy(0.) {};
+};
+
+int main(int argc, char * argv[])
+{
+    if(argc < 2) {
+        cout << "usage: testParallelDST <dst_file> [threads]" << endl;
+        return 0;
+    }
+
+    string path = argv[1];
+    size_t threads = (argc > 2) ? atoi(argv[2]) : 0;
+
+    PRadDataHandler *handler = new PRadDataHandler();
+    PRadDSTParser *dst_parser = new PRadDSTParser(handler);
+    handler->ReadConfig("config.txt");
+    handler->SetHyCalClusterMethod("Square");
+
+    // reconstruct the physics events, the handler is the one owned by the
+    // thread that processes this event
+    auto process = [] (PRadDataHandler *h, EventData &event, ClusterOutput &out)
+                   {
+                       if(!event.is_physics_event())
+                           return;
+
+                       h->HyCalReconstruct(event);
+                       h->GetSRS()->Reconstruct(event);
+
+                       int nclusters;
+                       HyCalHit *hits = h->GetHyCalCluster(nclusters);
+                       for(int i = 0; i < nclusters; ++i)
+                           out.energy += hits[i].E;
+
+                       out.events.push_back(event.event_number);
+                       out.clusters.push_back(nclusters);
+                   };
+
+    // called in the order of the chunk ranges
+    ClusterOutput total;
+    auto merge = [&total] (ClusterOutput &out)
+                 {
+                     total.events.insert(total.events.end(), out.events.begin(), out.events.end());
+                     total.clusters.insert(total.clusters.end(), out.clusters.begin(), out.clusters.end());
+                     total.energy += out.energy;
+                 };
+
+    PRadBenchMark timer;
+    dst_parser->ProcessParallel<ClusterOutput>(path, process, merge, threads);
+    unsigned int par_time = timer.GetElapsedTime();
+    ClusterOutput parallel = total;
+
+    total = ClusterOutput();
+    handler->GetEPICSData().clear();
+    timer.Reset();
+    dst_parser->ProcessParallel<ClusterOutput>(path, process, merge, 1);
+    unsigned int seq_time = timer.GetElapsedTime();
+
+    cout << "Sequential: " << total.events.size() << " events, total cluster energy "
+         << total.energy << " MeV in " << seq_time << " ms" << endl;
+    cout << "Parallel: " << parallel.events.size() << " events, total cluster energy "
+         << parallel.energy << " MeV in " << par_time << " ms" << endl;
+
+    bool same = (parallel.events == total.events) && (parallel.clusters == total.clusters);
+    cout << "Outputs are " << (same ? "identical." : "different!") << endl;
+
+    delete dst_parser;
+    delete handler;
+    return 0;
+}
@@ -16,6 +16,9 @@
 #include <iostream>
 #include <string>
 #include <vector>
+#include <algorithm>
+
+#define MAXHIT 100 // maximum number of clusters saved in the tree
 
 using namespace std;
 
@@ -41,7 +44,7 @@ int main(int /*argc*/, char * /*argv*/ [])
     TTree *t = new TTree("T", "T");
 
     int N;
-    double E[100], x[100], y[100]; // maximum number of clusters, 100 is enough
+    double E[MAXHIT], x[MAXHIT], y[MAXHIT];
     // retrieve part of the cluster information
     t->Branch("NClusters", &N, "NClusters/I");
     t->Branch("ClusterE", &E, "ClusterE/D");
@@ -49,19 +52,27 @@ int main(int /*argc*/, char * /*argv*/ [])
     t->Branch("ClusterY", &y[0], "ClusterY[NClusters]/D");
 
 
-    for(size_t i = 0; i < handler->GetEventCount(); ++i)
-    {
-        handler->HyCalReconstruct(i);
-        HyCalHit *hit = handler->GetHyCalCluster(N);
-
-        for(int i = 0; i < N; ++i)
-        {
-            E[i] = hit[i].E;
-            x[i] = hit[i].x_log;
-            y[i] = hit[i].y_log;
-        }
-        t->Fill();
-    }
+    // clustering runs in the thread pool, the events come back in order
+    handler->HyCalReconstructAll([&] (const EventData &event,
+                                      ArraySpan<HyCalHit> hits,
+                                      ArraySpan<HyCalBlock>)
+                                 {
+                                     N = min((int)hits.size(), MAXHIT);
+                                     if((int)hits.size() > MAXHIT) {
+                                         cerr << "Event " << event.event_number
+                                              << " has " << hits.size()
+                                              << " clusters, only the first "
+                                              << MAXHIT << " are saved."
+                                              << endl;
+                                     }
+                                     for(int i = 0; i < N; ++i)
+                                     {
+                                         E[i] = hits[i].E;
+                                         x[i] = hits[i].x_log;
+                                         y[i] = hits[i].y_log;
+                                     }
+                                     t->Fill();
+                                 });
 
     cout << "TIMER: Finished, took " << timer.GetElapsedTime() << " ms" << endl;
     cout << "Read " << handler->GetEventCount() << " events and "
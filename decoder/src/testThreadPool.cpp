@@ -0,0 +1,98 @@
+//============================================================================//
+// A test of the thread pool, it runs nested parallel loops with the pool and //
+// with the calling thread only, and checks the results are the same.         //
+// An evio file can be given to print the job timing and queue depth of the   //
+// decoding with the data handler                                             //
+//                                                                            //
+// agent                                                                      //
+// 10/17/2026                                                                 //
+//============================================================================//
+
+#include "PRadThreadPool.h"
+#include "PRadDataHandler.h"
+#include "PRadBenchMark.h"
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cmath>
+#include <cstdlib>
+
+using namespace std;
+
+double run_loops(PRadThreadPool &pool, const size_t &n_outer, const size_t &n_inner);
+void bench_evio(const string &path);
+
+int main(int argc, char * argv[])
+{
+    if(argc > 1 && string(argv[1]).find(".evio") != string::npos) {
+        bench_evio(argv[1]);
+        return 0;
+    }
+
+    size_t n_threads = PRadThreadPool::GetDefaultSize();
+    if(argc > 1)
+        n_threads = atoi(argv[1]);
+
+    // outer loops are events and inner loops are FECs
+    size_t n_outer = 2000, n_inner = 8;
+
+    PRadThreadPool serial(0);
+    PRadBenchMark timer;
+    double ref = run_loops(serial, n_outer, n_inner);
+    unsigned int serial_time = timer.GetElapsedTime();
+
+    PRadThreadPool pool(n_threads);
+    timer.Reset();
+    double res = run_loops(pool, n_outer, n_inner);
+    unsigned int pool_time = timer.GetElapsedTime();
+
+    cout << "Serial: " << serial_time << " ms, "
+         << "pool with " << pool.GetThreadNumber() << " threads: "
+         << pool_time << " ms, results are "
+         << ((res == ref) ? "identical." : "different!")
+         << endl;
+
+    pool.PrintStatistics(cout);
+    return 0;
+}
+
+double run_loops(PRadThreadPool &pool, const size_t &n_outer, const size_t &n_inner)
+{
+    vector<double> outer_sum(n_outer, 0.);
+
+    pool.ParallelFor(n_outer, [&] (const size_t &i)
+    {
+        vector<double> inner_sum(n_inner, 0.);
+        pool.ParallelFor(n_inner, [&] (const size_t &j)
+        {
+            double sum = 0.;
+            for(size_t k = 0; k < 2000; ++k)
+                sum += sin(i*0.001 + j*0.01 + k*0.0001);
+            inner_sum[j] = sum;
+        }, "Inner Loop");
+
+        for(auto &val : inner_sum)
+            outer_sum[i] += val;
+    }, "Outer Loop");
+
+    double total = 0.;
+    for(auto &val : outer_sum)
+        total += val;
+    return total;
+}
+
+// decode an evio file and print the statistics of the handler's pool
+void bench_evio(const string &path)
+{
+    PRadDataHandler *handler = new PRadDataHandler();
+    handler->ReadConfig("config.txt");
+
+    PRadBenchMark timer;
+    handler->ReadFromEvio(path);
+
+    cout << "Decoded " << handler->GetEventCount() << " events in "
+         << timer.GetElapsedTime() << " ms" << endl;
+
+    handler->GetThreadPool()->PrintStatistics(cout);
+    delete handler;
+}
@@ -0,0 +1,50 @@
+#ifndef PRAD_APV_KERNEL_H
+#define PRAD_APV_KERNEL_H
+
+#include <cstddef>
+#include <cstdint>
+
+// number of channels of an APV, same as TIME_SAMPLE_SIZE in PRadGEMAPV
+#define APV_KERNEL_CHANNELS 128
+
+class PRadAPVKernel
+{
+public:
+    enum Level
+    {
+        Scalar = 0,
+        SSE2,
+        AVX2,
+        Max_Level,
+    };
+
+    // the per channel pedestal and thresholds in structure of arrays, they are
+    // updated by the APV when its pedestal or settings change
+    struct Tables
+    {
+        float offset[APV_KERNEL_CHANNELS];
+        float cm_thres[APV_KERNEL_CHANNELS];   // common mode threshold
+        float zs_thres[APV_KERNEL_CHANNELS];   // zero suppression threshold
+        int32_t group[APV_KERNEL_CHANNELS];    // -1 for the first group in split mode
+        bool split;
+    };
+
+public:
+    static void SplitData(const uint32_t *buf, const size_t &size, float *out);
+    static size_t FindHeader(const float *buf, const size_t &size, const float &thres);
+    static void ZeroSuppression(const Tables &tables,
+                                float *buf,
+                                const size_t &ts_diff,
+                                const size_t &time_samples,
+                                bool *hit_pos);
+
+    static Level GetLevel() {return level;};
+    static Level GetBestLevel();
+    static void SetLevel(const Level &l);
+    static const char *GetLevelName(const Level &l);
+
+private:
+    static Level level;
+};
+
+#endif
@@ -5,6 +5,9 @@
 #include <vector>
 #include <iostream>
 #include <unordered_map>
+#ifdef MULTI_THREAD
+#include <atomic>
+#endif
 #include "TH1.h"
 #include "datastruct.h"
 
@@ -206,7 +209,12 @@ protected:
     Pedestal pedestal;
     std::string tdcName;
     PRadTDCGroup *tdcGroup;
+#ifdef MULTI_THREAD
+    // events can be decoded in parallel
+    std::atomic<int> occupancy;
+#else
     int occupancy;
+#endif
     unsigned short sparsify;
     unsigned short channelID;
     unsigned short adc_value;
@@ -2,14 +2,55 @@
 #define PRAD_DST_PARSER_H
 
 #include <fstream>
+#include <iostream>
 #include <string>
+#include <vector>
+#include <sstream>
+#include <algorithm>
+#include <functional>
+#ifdef MULTI_THREAD
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+#endif
 #include "PRadException.h"
 #include "PRadEventStruct.h"
 
+#define DST_FILE_VERSION 0x13  // 0xff
+#define DST_FILE_VERSION_V2 0x20
+#define DST_FILE_VERSION_COL 0x21 // version 2 with column chunks
+
 class PRadDataHandler;
 
 class PRadDSTParser
 {
+public:
+    // chunk information in version 2 file
+    struct ChunkInfo
+    {
+        uint64_t offset;
+        int first_event;
+        int last_event;
+        uint32_t events;
+        uint32_t records;
+        uint32_t type_mask;
+
+        ChunkInfo()
+        : offset(0), first_event(0), last_event(0), events(0), records(0), type_mask(0)
+        {};
+    };
+
+    // consecutive chunks processed by one worker in parallel processing
+    struct ChunkRange
+    {
+        size_t first;
+        size_t end;
+
+        ChunkRange() : first(0), end(0) {};
+        ChunkRange(const size_t &f, const size_t &e) : first(f), end(e) {};
+    };
+
 public:
     PRadDSTParser(PRadDataHandler *h);
     virtual ~PRadDSTParser();
@@ -17,12 +58,31 @@ public:
     void OpenOutput(const std::string &path, std::ios::openmode mode = std::ios::out | std::ios::binary);
     void OpenInput(const std::string &path, std::ios::openmode mode = std::ios::in | std::ios::binary);
     void CloseOutput();
+    void FlushOutput();
     void CloseInput();
     void SetMode(const uint32_t &bit) {update_mode = bit;};
+    void SetOutputVersion(const int &v);
+    void SetCodec(const PRadDSTCodec &c);
+    void SetColumnar(const bool &c);
+    void SetReadMask(const uint32_t &mask) {read_mask = mask;};
+    uint32_t GetReadMask() {return read_mask;};
+    PRadDSTCodec GetCodec() {return codec;};
     bool Read();
     PRadDSTInfo EventType() {return type;};
     EventData &GetEvent() {return event;};
     EPICSData &GetEPICSEvent() {return epics_event;};
+    uint64_t GetBytesWritten() {return bytes_written;};
+    uint64_t GetEventsWritten() {return events_written;};
+    const std::vector<ChunkInfo> &GetChunkIndex() {return chunk_index;};
+    bool IsInputOpen() {return dst_in.is_open();};
+    bool SeekChunk(const size_t &idx);
+    bool SeekRange(const size_t &first, const size_t &end);
+    bool SeekPosition(const uint64_t &begin, const uint64_t &end);
+    int FindChunk(const int &event_number) const;
+    int FindChunk(const PRadDSTInfo &type, const size_t &start = 0) const;
+    static void DecompressChunk(const PRadDSTCodec &c,
+                                const char *in, const size_t &in_size,
+                                char *out, const size_t &size) throw(PRadException);
 
 
     void WriteEvent(const EventData &data) throw(PRadException);
@@ -31,9 +91,159 @@ public:
     void WriteRunInfo() throw(PRadException);
     void WriteHyCalInfo() throw(PRadException);
     void WriteGEMInfo() throw(PRadException);
+    void AppendFile(const std::string &path) throw(PRadException);
+
+    //========================================================================//
+    // Process the events of a chunked DST file in parallel                   //
+    // The file is split into chunk ranges, each worker job has its own      //
+    // parser and a handler cloned from this parser's handler, so the HyCal   //
+    // clustering methods and GEM system are thread-local                     //
+    // The jobs run in the handler's thread pool, n_threads = 0 means using   //
+    // all the threads in the pool                                            //
+    // process(handler, event, output) is called for every event with the     //
+    // worker's handler and the output of the event's range                   //
+    // merge(output) is called once for every range in the file order         //
+    // Files without the chunk index are processed sequentially               //
+    //========================================================================//
+    template<typename Output>
+    void ProcessParallel(const std::string &path,
+                         std::function<void(PRadDataHandler *, EventData &, Output &)> process,
+                         std::function<void(Output &)> merge,
+                         const size_t &n_threads = 0)
+    {
+        std::vector<ChunkRange> ranges;
+        std::vector<PRadDataHandler *> workers;
+
+#ifdef MULTI_THREAD
+        if(!prepareParallel(path, n_threads, ranges, workers))
+#else
+        (void) n_threads;
+#endif
+        {
+            // sequential processing with this parser
+            Output output;
+            OpenInput(path);
+            while(readRangeEvent())
+                process(handler, event, output);
+            CloseInput();
+            merge(output);
+            return;
+        }
+
+#ifdef MULTI_THREAD
+        std::vector<Output> outputs(ranges.size());
+        std::vector<bool> finished(ranges.size(), false);
+        std::atomic<size_t> next_range(0);
+        size_t next_merge = 0;
+        std::mutex merge_locker;
+
+        auto process_ranges = [&] (PRadDataHandler *worker)
+        {
+            PRadDSTParser worker_parser(worker);
+            worker_parser.SetMode(DST_UPDATE_NONE);
+            worker_parser.SetReadMask(read_mask);
+            worker_parser.OpenInput(path);
+
+            size_t idx;
+            while((idx = next_range++) < ranges.size())
+            {
+                worker_parser.beginRange(ranges[idx]);
+                try {
+                    while(worker_parser.readRangeEvent())
+                        process(worker, worker_parser.event, outputs[idx]);
+                } catch(PRadException &e) {
+                    std::cerr << e.FailureType() << ": "
+                              << e.FailureDesc() << std::endl
+                              << "DST Parser: Failed to process chunk range "
+                              << idx << std::endl;
+                }
+
+                // merge the finished ranges in order
+                std::lock_guard<std::mutex> lock(merge_locker);
+                finished[idx] = true;
+                while(next_merge < ranges.size() && finished[next_merge])
+                {
+                    merge(outputs[next_merge]);
+                    outputs[next_merge] = Output();
+                    ++next_merge;
+                }
+            }
+        };
+
+        runParallel(workers, process_ranges);
+        finishParallel(workers);
+#endif
+    }
 
 private:
+    template<typename T>
+    void saveData(const T &t)
+    {
+        const char *ptr = (const char*) &t;
+        out_buf.insert(out_buf.end(), ptr, ptr + sizeof(T));
+    }
+    template<typename T>
+    void saveArray(const T *t, const size_t &n)
+    {
+        const char *ptr = (const char*) t;
+        out_buf.insert(out_buf.end(), ptr, ptr + n*sizeof(T));
+    }
+    template<typename T>
+    void saveData(std::vector<char> &buf, const T &t)
+    {
+        const char *ptr = (const char*) &t;
+        buf.insert(buf.end(), ptr, ptr + sizeof(T));
+    }
+    template<typename T>
+    void saveArray(std::vector<char> &buf, const T *t, const size_t &n)
+    {
+        const char *ptr = (const char*) t;
+        buf.insert(buf.end(), ptr, ptr + n*sizeof(T));
+    }
+    template<typename T>
+    void loadArray(const int &col, T *t, const size_t &n) throw(PRadException)
+    {
+        size_t size = n*sizeof(T);
+        if(col_pos[col] + size > col_in[col].size())
+            throw PRadException("READ DST", "column block overrun, probably corrupted file");
+        std::copy(col_in[col].begin() + col_pos[col],
+                  col_in[col].begin() + col_pos[col] + size,
+                  (char*) t);
+        col_pos[col] += size;
+    }
+    template<typename T>
+    void loadData(const int &col, T &t) throw(PRadException)
+    {
+        loadArray(col, &t, 1);
+    }
+    void saveRecord(const PRadDSTInfo &type, const int &ev = 0);
+    void saveColumns(const EventData &data);
+    void beginRowRecord();
+    void submitBuffer();
+#ifdef MULTI_THREAD
+    void flushLoop();
+#endif
+    void writeBlock(const std::vector<char> &buf, ChunkInfo &chunk, const std::vector<uint32_t> &cols);
+    void writeColumnChunk(const std::vector<char> &buf, ChunkInfo &chunk, const std::vector<uint32_t> &cols);
+    void writeFooter();
+    void readFooter();
+    bool readChunk() throw(PRadException);
+    void readColumnChunk(const PRadDSTCodec &c) throw(PRadException);
+    void clearColumns();
+    bool hasRecord() throw(PRadException);
+    bool compressChunk(const PRadDSTCodec &c, const std::vector<char> &in, std::vector<char> &out);
     void readEvent(EventData &data) throw(PRadException);
+    void readColumnEvent(EventData &data) throw(PRadException);
+    bool readRangeEvent();
+    void beginRange(const ChunkRange &range);
+#ifdef MULTI_THREAD
+    bool prepareParallel(const std::string &path, size_t n_threads,
+                         std::vector<ChunkRange> &ranges,
+                         std::vector<PRadDataHandler *> &workers);
+    void runParallel(const std::vector<PRadDataHandler *> &workers,
+                     const std::function<void(PRadDataHandler *)> &job);
+    void finishParallel(std::vector<PRadDataHandler *> &workers);
+#endif
     void readEPICS(EPICSData &data) throw(PRadException);
     void readEPICSMap() throw(PRadException);
     void readRunInfo() throw(PRadException);
@@ -45,10 +255,48 @@ private:
     std::ofstream dst_out;
     std::ifstream dst_in;
     int64_t input_length;
+    uint32_t input_version;
+    int64_t data_end;
+    int64_t chunk_end; // the end of all chunks
+    std::istream *in_stream;
+    std::istringstream chunk_stream;
+    int64_t chunk_length;
     EventData event;
     EPICSData epics_event;
     PRadDSTInfo type;
     uint32_t update_mode;
+    uint32_t read_mask;
+    // column blocks being read, only the requested ones are filled
+    std::vector<char> col_in[DST_Column_Size];
+    size_t col_pos[DST_Column_Size];
+    uint32_t col_events;
+    uint32_t col_index;
+    uint32_t output_version;
+    PRadDSTCodec codec;
+    bool columnar;
+    bool out_columnar;
+    std::vector<ChunkInfo> chunk_index;
+    std::vector<char> comp_buf;
+
+    // output is serialized to memory and written by blocks
+    std::vector<char> out_buf;
+    std::vector<char> col_buf[DST_Column_Size];
+    std::vector<uint32_t> out_cols; // column block sizes packed in out_buf
+    ChunkInfo out_chunk;
+    uint64_t bytes_written;
+    uint64_t events_written;
+#ifdef MULTI_THREAD
+    // double buffering, the flush thread writes one block to file
+    // while the other one is being filled
+    std::vector<char> flush_buf;
+    std::vector<uint32_t> flush_cols;
+    ChunkInfo flush_chunk;
+    std::thread flush_thread;
+    std::mutex flush_lock;
+    std::condition_variable flush_cond;
+    bool flush_pending;
+    bool flush_stop;
+#endif
 };
 
 #endif
@@ -0,0 +1,81 @@
+#ifndef PRAD_DST_READER_H
+#define PRAD_DST_READER_H
+
+#include <string>
+#include <vector>
+#include <cstring>
+#include "PRadException.h"
+#include "PRadEventStruct.h"
+
+class PRadDSTReader
+{
+public:
+    PRadDSTReader();
+    virtual ~PRadDSTReader();
+
+    bool Open(const std::string &path);
+    void Close();
+    bool IsOpen() {return map_begin != nullptr;};
+    bool Read();
+    void SetReadMask(const uint32_t &mask) {read_mask = mask;};
+    uint32_t GetReadMask() {return read_mask;};
+    PRadDSTInfo EventType() {return type;};
+    const EventView &GetEvent() {return event;};
+    const EPICSView &GetEPICSEvent() {return epics_event;};
+
+private:
+    template<typename T>
+    void getData(const char *&ptr, const char *end, T &t) throw(PRadException)
+    {
+        checkSize(ptr, end, sizeof(T));
+        memcpy((void*) &t, ptr, sizeof(T));
+        ptr += sizeof(T);
+    }
+    template<typename T>
+    void getArray(const char *&ptr, const char *end, ArrayView<T> &view, const uint32_t &n)
+    throw(PRadException)
+    {
+        checkSize(ptr, end, n*sizeof(T));
+        view = ArrayView<T>(ptr, n);
+        ptr += n*sizeof(T);
+    }
+    void checkSize(const char *ptr, const char *end, const size_t &size) throw(PRadException);
+    bool nextChunk() throw(PRadException);
+    void readColumnChunk(const PRadDSTCodec &c) throw(PRadException);
+    const char *chunkData(const PRadDSTCodec &c,
+                          const char *data, const uint32_t &data_size,
+                          const uint32_t &raw_size,
+                          std::vector<char> &buf) throw(PRadException);
+    void readEvent() throw(PRadException);
+    void readColumnEvent() throw(PRadException);
+    void readGEMHits(const char *&ptr, const char *end, const uint32_t &n) throw(PRadException);
+    void readEPICS() throw(PRadException);
+    void skipRecord() throw(PRadException);
+
+private:
+    const char *map_begin;
+    size_t map_size;
+    uint32_t version;
+    uint32_t read_mask;
+    PRadDSTInfo type;
+    EventView event;
+    EPICSView epics_event;
+
+    // chunks in the mapped file, version 1 file is one chunk of row records
+    const char *file_pos;
+    const char *file_end;
+
+    // row records in the current chunk
+    const char *rec_pos;
+    const char *rec_end;
+    std::vector<char> chunk_buf;
+
+    // column blocks in the current chunk
+    const char *col_pos[DST_Column_Size];
+    const char *col_end[DST_Column_Size];
+    std::vector<char> col_buf[DST_Column_Size];
+    uint32_t col_events;
+    uint32_t col_index;
+};
+
+#endif
@@ -5,12 +5,17 @@
 #include <map>
 #include <deque>
 #include <fstream>
+#include <functional>
 #include "PRadEventStruct.h"
+#include "PRadEventStore.h"
+#include "PRadEventPool.h"
+#include "PRadLookupTable.h"
 #include "PRadException.h"
 #include "ConfigParser.h"
-#include <thread>
+#include "PRadThreadPool.h"
 
 class PRadEvioParser;
+class PRadEventPipeline;
 class PRadHyCalCluster;
 class PRadDSTParser;
 class PRadDAQUnit;
@@ -20,6 +25,9 @@ class PRadGEMAPV;
 class TH1D;
 class TH2I;
 
+// number of events reconstructed by a job in HyCalReconstructRange
+#define HYCAL_RECON_JOB_EVENTS 64
+
 // epics channel
 struct epics_ch
 {
@@ -53,12 +61,28 @@ namespace std
 
 class PRadDataHandler
 {
+public:
+    // called with the event and its clusters, the block offsets of the
+    // clusters are in the blocks of this event
+    // the event and the spans are only valid during the call, the buffers
+    // are reused for the next events, copy the data to keep them
+    typedef std::function<void(const EventData &,
+                               ArraySpan<HyCalHit>,
+                               ArraySpan<HyCalBlock>)> HyCalCallback;
+
 public:
     PRadDataHandler();
     virtual ~PRadDataHandler();
 
     // mode change
     void SetOnlineMode(const bool &mode);
+    void SetEventStorage(const std::string &mode, const int &capacity, const std::string &spill_dir);
+    void SetDecodeWorkers(const int &n);
+    int GetDecodeWorkers() {return decode_workers;};
+    void SetReplayWorkers(const int &n);
+    int GetReplayWorkers() {return replay_workers;};
+    void SetThreadPoolSize(const int &n);
+    PRadThreadPool *GetThreadPool() {return thread_pool;};
 
     // add channels
     void AddChannel(PRadDAQUnit *channel);
@@ -79,7 +103,7 @@ public:
     std::vector< PRadDAQUnit* > &GetChannelList() {return channelList;};
 
     // read config files
-    void ReadConfig(const std::string &path);
+    void ReadConfig(const std::string &path, const bool &setup_only = false);
     template<typename... Args>
     void ExecuteConfigCommand(void (PRadDataHandler::*act)(Args...), Args&&... args);
     void ReadTDCList(const std::string &path);
@@ -93,6 +117,7 @@ public:
     // file reading and writing
     void ReadFromDST(const std::string &path, const uint32_t &mode = DST_UPDATE_ALL);
     void ReadFromEvio(const std::string &path, const int &evt = -1, const bool &verbose = false);
+    void ReadRangeFromEvio(const std::string &path, const int &first, const int &last);
     void ReadFromSplitEvio(const std::string &path, const int &split = -1, const bool &verbose = true);
     void Decode(const void *buffer);
     void Replay(const std::string &r_path, const int &split = -1, const std::string &w_path = "");
@@ -101,34 +126,42 @@ public:
     // data handler
     void Clear();
     void SetRunNumber(const int &run) {runInfo.run_number = run;};
-    void StartofNewEvent(const unsigned char &tag);
+    EventData *StartofNewEvent(const unsigned char &tag);
     void EndofThisEvent(const unsigned int &ev);
     void EndProcess(EventData *data);
+    void CommitEvent(EventData &data);
     void WaitEventProcess();
-    void FeedData(JLabTIData &tiData);
-    void FeedData(JLabDSCData &dscData);
-    void FeedData(ADC1881MData &adcData);
-    void FeedData(TDCV767Data &tdcData);
-    void FeedData(TDCV1190Data &tdcData);
-    void FeedData(GEMRawData &gemData);
-    void FeedData(std::vector<GEMZeroSupData> &gemData);
-    void FeedTaggerHits(TDCV1190Data &tdcData);
+    void FeedData(JLabTIData &tiData, EventData &event);
+    void FeedData(JLabDSCData &dscData, EventData &event);
+    void FeedData(ADC1881MData &adcData, EventData &event);
+    void FeedData(TDCV767Data &tdcData, EventData &event);
+    void FeedData(TDCV1190Data &tdcData, EventData &event);
+    void FeedData(std::vector<GEMRawData> &gemData, EventData &event);
+    void FeedData(std::vector<GEMZeroSupData> &gemData, EventData &event);
+    void FeedTaggerHits(TDCV1190Data &tdcData, EventData &event);
     void FillHistograms(EventData &data);
+    void FillHistograms(const EventView &data);
     void UpdateEPICS(const std::string &name, const float &value);
-    void UpdateTrgType(const unsigned char &trg);
+    void UpdateTrgType(const unsigned char &trg, EventData &event);
     void AccumulateBeamCharge(EventData &event);
     void UpdateLiveTimeScaler(EventData &event);
     void UpdateOnlineInfo(EventData &event);
     void UpdateRunInfo(const RunInfo &ri) {runInfo = ri;};
+    PRadDataHandler *CloneSetup();
     void AddHyCalClusterMethod(PRadHyCalCluster *r, const std::string &name, const std::string &c_path);
     void SetHyCalClusterMethod(const std::string &name);
     void ListHyCalClusterMethods();
+    // the clustering methods copy the channel constants, they are copied again
+    // when the version changes, so it should be updated after changing them
+    void UpdateSetupVersion() {++setup_version;};
+    unsigned int GetSetupVersion() const {return setup_version;};
 
     // show data
     int GetCurrentEventNb();
     void ChooseEvent(const int &idx = -1);
     void ChooseEvent(const EventData &event);
-    unsigned int GetEventCount() {return energyData.size();};
+    void ChooseEvent(const EventView &event);
+    unsigned int GetEventCount() {return energyData.Size();};
     unsigned int GetEPICSEventCount() {return epicsData.size();};
     int GetRunNumber() {return runInfo.run_number;};
     double GetBeamCharge() {return runInfo.beam_charge;};
@@ -136,15 +169,17 @@ public:
     TH1D *GetEnergyHist() {return energyHist;};
     TH2I *GetTagEHist() {return TagEHist;};
     TH2I *GetTagTHist() {return TagTHist;};
-    EventData &GetEvent(const unsigned int &index);
+    EventData GetEvent(const unsigned int &index);
     EventData &GetLastEvent();
-    std::deque<EventData> &GetEventData() {return energyData;};
+    PRadEventStore &GetEventStore() {return energyData;};
+    PRadEventPool &GetEventPool() {return eventPool;};
     EPICSData &GetEPICSEvent(const unsigned int &index);
     std::deque<EPICSData> &GetEPICSData() {return epicsData;};
     RunInfo &GetRunInfo() {return runInfo;};
     OnlineInfo &GetOnlineInfo() {return onlineInfo;};
     double GetEnergy() {return totalE;};
     double GetEnergy(const EventData &event);
+    double GetEnergy(const EventView &event);
     float GetEPICSValue(const std::string &name);
     float GetEPICSValue(const std::string &name, const int &index);
     float GetEPICSValue(const std::string &name, const EventData &event);
@@ -168,8 +203,12 @@ public:
     int FindEventIndex(const int &event_number);
     void HyCalReconstruct(const int &event_index);
     void HyCalReconstruct(EventData &event);
+    void HyCalReconstruct(const EventView &event);
+    void HyCalReconstructRange(const int &first, const int &last, const HyCalCallback &callback);
+    void HyCalReconstructAll(const HyCalCallback &callback);
     HyCalHit *GetHyCalCluster(int &size);
-    std::vector<HyCalHit> GetHyCalCluster();
+    ArraySpan<HyCalHit> GetHyCalCluster();
+    ArraySpan<HyCalBlock> GetHyCalClusterBlocks(const HyCalHit &hit);
 
 
     // other functions
@@ -177,10 +216,27 @@ public:
     std::vector<epics_ch> GetSortedEPICSList();
     void SaveEPICSChannels(const std::string &path);
 
+private:
+    template<typename T>
+    void fillHistograms(const T &data);
+    template<typename T>
+    void chooseEvent(const T &event);
+    template<typename T>
+    double getEnergy(const T &event);
+    void replaySplitParallel(const std::string &r_path, const int &split, const std::string &w_path);
+    void replaySplit(const std::string &r_path, const std::string &w_path);
+    void copySetup(const PRadDataHandler &other);
+    void mergeHistograms(const PRadDataHandler &other);
+    void shareThreadPool(PRadThreadPool *pool);
+
 private:
     PRadEvioParser *parser;
+    PRadEventPipeline *pipeline;
     PRadDSTParser *dst_parser;
     PRadGEMSystem *gem_srs;
+    PRadThreadPool *thread_pool;
+    PRadThreadPool::TaskGroup *end_group;
+    bool own_pool;
     PRadHyCalCluster *hycal_recon;
     RunInfo runInfo;
     OnlineInfo onlineInfo;
@@ -188,7 +244,10 @@ private:
     bool onlineMode;
     bool replayMode;
     int current_event;
-    std::thread end_thread;
+    int decode_workers;
+    int replay_workers;
+    unsigned int setup_version;
+    std::string config_path;
 
     // maps
     std::unordered_map< ChannelAddress, PRadDAQUnit* > map_daq;
@@ -196,6 +255,9 @@ private:
     std::unordered_map< std::string, PRadTDCGroup* > map_name_tdc;
     std::unordered_map< ChannelAddress, PRadTDCGroup* > map_daq_tdc;
     std::unordered_map< std::string, PRadHyCalCluster *> hycal_recon_map;
+    // direct-indexed tables for routing the data words in decoding
+    PRadLookupTable< PRadDAQUnit > table_daq;
+    PRadLookupTable< PRadTDCGroup > table_daq_tdc;
 
     std::vector< PRadDAQUnit* > channelList;
     std::vector< PRadDAQUnit* > freeList; // channels that should be freed by handler
@@ -204,10 +266,11 @@ private:
     // data related
     std::unordered_map< std::string, uint32_t > epics_map;
     std::vector< float > epics_values;
-    std::deque< EventData > energyData;
+    PRadEventStore energyData;
     std::deque< EPICSData > epicsData;
 
     EventData *newEvent;
+    PRadEventPool eventPool;
     TH1D *energyHist;
     TH2I *TagEHist;
     TH2I *TagTHist;
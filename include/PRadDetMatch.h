@@ -37,6 +37,11 @@ public:
     //getter for HyCal cluster
     int GetNHyCalClusters() {return fNHyCalClusters;}
     HyCalHit *GetHyCalClusters() {return fHyCalClusters;}
+    //ids of the GEM 2D clusters matched to the HyCal cluster
+    ArraySpan<unsigned short> GetMatchedGEMClusters(const HyCalHit &hit, const int &igem) const
+    {
+        return ArraySpan<unsigned short>(fGEMMatchPool, hit.gemOffset[igem], hit.gemNClusters[igem]);
+    }
 
     //getter for GEM 1d clusters
     map<int, list<GEMPlaneCluster>* > & GetGEM1DClusters() { return fGEM1DClusters; }
@@ -73,6 +78,7 @@ protected:
     //input and output
     int                           fNHyCalClusters;
     HyCalHit*                     fHyCalClusters;
+    vector<unsigned short>        fGEMMatchPool;
     map<int,
         list<GEMPlaneCluster>* >  fGEM1DClusters;
 
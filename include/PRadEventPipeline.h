@@ -0,0 +1,59 @@
+#ifndef PRAD_EVENT_PIPELINE_H
+#define PRAD_EVENT_PIPELINE_H
+
+#include <vector>
+#include <mutex>
+#include <condition_variable>
+#include <cstdint>
+#include "datastruct.h"
+#include "PRadEventStruct.h"
+#include "PRadThreadPool.h"
+
+class PRadDataHandler;
+class PRadEvioParser;
+
+class PRadEventPipeline
+{
+public:
+    // an event in decoding, it has its own parser and event container
+    struct Slot
+    {
+        PRadEventHeader *header;
+        PRadEvioParser *parser;
+        EventData event;
+        bool valid;
+        bool ready;   // decoded and waiting for commit, by commit_lock
+
+        Slot() : header(nullptr), parser(nullptr), valid(false), ready(false) {};
+    };
+
+public:
+    PRadEventPipeline(PRadDataHandler *h, PRadThreadPool *pool, const size_t &n_slots);
+    virtual ~PRadEventPipeline();
+
+    void Submit(PRadEventHeader *header);
+    void Wait();
+    void SetEventNumber(const int &ev) {event_number = ev;};
+    int GetEventNumber() {return event_number;};
+    size_t GetWorkerNumber() {return slots.size();};
+
+private:
+    void decode(const uint64_t &seq);
+    void commit(Slot *slot);
+
+private:
+    PRadDataHandler *handler;
+    PRadThreadPool::TaskGroup *group;
+    std::vector<Slot *> slots;
+    int event_number;
+
+    // reader stage to the decoding jobs
+    uint64_t next_seq;
+
+    // decoding jobs to ordered commit stage
+    uint64_t next_commit;
+    std::mutex commit_lock;
+    std::condition_variable space_cond;
+};
+
+#endif
@@ -0,0 +1,44 @@
+#ifndef PRAD_EVENT_POOL_H
+#define PRAD_EVENT_POOL_H
+
+#include <atomic>
+#include <cstdint>
+#include "PRadEventStruct.h"
+
+class PRadEventPool
+{
+public:
+    PRadEventPool(const size_t &size = 16);
+    virtual ~PRadEventPool();
+
+    EventData *Get(const unsigned char &tag = 0);
+    void Put(EventData *data);
+    size_t GetCapacity() const {return mask + 1;};
+    uint64_t GetHits() const {return hits;};
+    uint64_t GetMisses() const {return misses;};
+    uint64_t GetDropped() const {return dropped;};
+    void ResetCounters();
+
+private:
+    bool push(EventData *data);
+    bool pop(EventData *&data);
+
+private:
+    // bounded queue, the sequence tells if the cell is ready to be
+    // written or read at the position
+    struct Cell
+    {
+        std::atomic<size_t> sequence;
+        EventData *data;
+    };
+
+    Cell *cells;
+    size_t mask;
+    std::atomic<size_t> push_pos;
+    std::atomic<size_t> pop_pos;
+    std::atomic<uint64_t> hits;
+    std::atomic<uint64_t> misses;
+    std::atomic<uint64_t> dropped;
+};
+
+#endif
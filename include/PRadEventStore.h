@@ -0,0 +1,107 @@
+#ifndef PRAD_EVENT_STORE_H
+#define PRAD_EVENT_STORE_H
+
+#include <deque>
+#include <vector>
+#include <string>
+#include <cstdint>
+#include "PRadEventStruct.h"
+
+class PRadDSTParser;
+
+class PRadEventStore
+{
+public:
+    // event information and the positions of its data banks in the arenas
+    struct Record
+    {
+        int event_number;
+        unsigned char type;
+        unsigned char trigger;
+        uint64_t timestamp;
+        uint32_t adc_begin, adc_size;
+        uint32_t tdc_begin, tdc_size;
+        uint32_t gem_begin, gem_end, gem_size;
+        uint32_t dsc_begin, dsc_size;
+    };
+
+    // a block of events, the data banks of all the events are packed in
+    // contiguous arenas, GEM hits are packed as the DST records
+    struct Block
+    {
+        std::vector<Record> records;
+        std::vector<ADC_Data> adc_arena;
+        std::vector<TDC_Data> tdc_arena;
+        std::vector<char> gem_arena;
+        std::vector<DSC_Data> dsc_arena;
+
+        void Add(const EventData &event);
+        EventView View(const size_t &i) const;
+        void Clear();
+        size_t Size() const {return records.size();};
+        size_t Bytes() const;
+    };
+
+    // a block of events paged out to the temporary DST file
+    struct Page
+    {
+        uint64_t begin;  // in bytes, from the beginning of the file
+        uint64_t end;
+        int first_event;
+        int last_event;
+
+        Page() : begin(0), end(0), first_event(0), last_event(0) {};
+    };
+
+public:
+    PRadEventStore();
+    virtual ~PRadEventStore();
+
+    void SetStorage(const PRadEventStorage &mode,
+                    const size_t &capacity = 0,
+                    const std::string &spill_dir = "");
+    PRadEventStorage GetStorage() const {return storage;};
+    size_t GetCapacity() const {return capacity;};
+    size_t GetSpilledCount() const {return pages.size()*block_events;};
+    const std::string &GetSpillPath() const {return spill_path;};
+    size_t GetMemoryUsage() const;
+
+    void Clear();
+    void Reset();
+    void Add(const EventData &event);
+    size_t Size() const {return GetSpilledCount() + resident - front;};
+    bool Empty() const {return Size() == 0;};
+    EventView View(const size_t &index);
+    EventData At(const size_t &index);
+    EventData Back();
+    int Find(const int &event_number);
+
+private:
+    void makeRoom();
+    bool spillBlock();
+    bool loadPage(const size_t &idx);
+    void closeSpill();
+    void clearBlocks();
+
+private:
+    PRadEventStorage storage;
+    size_t capacity;
+    size_t block_events;
+    std::string spill_dir;
+
+    // the events in memory, front is the number of events dropped from the
+    // first block in ring mode
+    std::deque<Block*> blocks;
+    size_t resident;
+    size_t front;
+
+    // spilled blocks and the one that was paged back
+    std::string spill_path;
+    PRadDSTParser *spill_out;
+    PRadDSTParser *spill_in;
+    std::vector<Page> pages;
+    Block page_cache;
+    size_t cached_page;
+};
+
+#endif
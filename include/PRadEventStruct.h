@@ -5,6 +5,8 @@
 #include <vector>
 #include <deque>
 #include <utility>
+#include <algorithm>
+#include <cstring>
 #include "datastruct.h"
 #include "TObject.h"
 
@@ -116,10 +118,123 @@ struct APVAddress
     {};
 };
 
+// the time samples of a GEM hit are stored inline up to GEM_INLINE_SAMPLES,
+// so a hit with the usual 3 time samples does not allocate memory
+// more samples are moved to the heap, it behaves like a std::vector<float>
+#define GEM_INLINE_SAMPLES 6
+
+template<typename T> class ArrayView;
+
+class GEMSamples
+{
+public:
+    GEMSamples() : heap(nullptr), n(0), cap(GEM_INLINE_SAMPLES) {};
+    GEMSamples(const GEMSamples &rhs)
+    : heap(nullptr), n(0), cap(GEM_INLINE_SAMPLES)
+    {
+        assign(rhs.data(), rhs.n);
+    };
+    GEMSamples(GEMSamples &&rhs)
+    : heap(nullptr), n(0), cap(GEM_INLINE_SAMPLES)
+    {
+        steal(rhs);
+    };
+    ~GEMSamples() {delete [] heap;};
+
+    GEMSamples &operator =(const GEMSamples &rhs)
+    {
+        if(this != &rhs)
+            assign(rhs.data(), rhs.n);
+        return *this;
+    };
+    GEMSamples &operator =(GEMSamples &&rhs)
+    {
+        if(this != &rhs) {
+            delete [] heap;
+            heap = nullptr;
+            steal(rhs);
+        }
+        return *this;
+    };
+
+    size_t size() const {return n;};
+    size_t capacity() const {return cap;};
+    bool empty() const {return n == 0;};
+    float *data() {return heap ? heap : buf;};
+    const float *data() const {return heap ? heap : buf;};
+    float *begin() {return data();};
+    float *end() {return data() + n;};
+    const float *begin() const {return data();};
+    const float *end() const {return data() + n;};
+    float &operator [](const size_t &i) {return data()[i];};
+    const float &operator [](const size_t &i) const {return data()[i];};
+    operator ArrayView<float>() const;
+    bool operator ==(const GEMSamples &rhs) const
+    {
+        return (n == rhs.n) && std::equal(begin(), end(), rhs.begin());
+    };
+    bool operator !=(const GEMSamples &rhs) const {return !(*this == rhs);};
+
+    void clear() {n = 0;};
+    void reserve(const size_t &size)
+    {
+        if(size <= cap)
+            return;
+        float *mem = new float[size];
+        memcpy(mem, data(), n*sizeof(float));
+        delete [] heap;
+        heap = mem;
+        cap = size;
+    };
+    void resize(const size_t &size)
+    {
+        reserve(size);
+        for(size_t i = n; i < size; ++i)
+            data()[i] = 0.;
+        n = size;
+    };
+    void push_back(const float &val)
+    {
+        if(n == cap)
+            reserve(2*cap);
+        data()[n++] = val;
+    };
+    void emplace_back(const float &val) {push_back(val);};
+
+private:
+    void assign(const float *vals, const size_t &size)
+    {
+        n = 0;
+        reserve(size);
+        memcpy(data(), vals, size*sizeof(float));
+        n = size;
+    };
+    void steal(GEMSamples &rhs)
+    {
+        if(rhs.heap) {
+            heap = rhs.heap;
+            cap = rhs.cap;
+        } else {
+            memcpy(buf, rhs.buf, rhs.n*sizeof(float));
+            cap = GEM_INLINE_SAMPLES;
+        }
+        n = rhs.n;
+        rhs.heap = nullptr;
+        rhs.n = 0;
+        rhs.cap = GEM_INLINE_SAMPLES;
+    };
+
+private:
+    float buf[GEM_INLINE_SAMPLES];
+    float *heap;
+    uint32_t n;
+    uint32_t cap;
+};
+
 struct GEM_Data
 {
     APVAddress addr;
-    std::vector<float> values;
+    GEMSamples values;
 
     GEM_Data() {};
     GEM_Data(const unsigned char &f,
@@ -330,6 +445,190 @@ struct EventData
     };
 };
 
+// read-only view of a packed array in memory, such as the data banks in a
+// memory mapped DST file, the data may not be aligned, so the elements are
+// copied out when they are accessed
+template<typename T>
+class ArrayView
+{
+public:
+    class iterator
+    {
+    public:
+        iterator(const char *p) : ptr(p) {};
+        T operator *() const {T t; memcpy((void*) &t, ptr, sizeof(T)); return t;};
+        iterator &operator ++() {ptr += sizeof(T); return *this;};
+        bool operator ==(const iterator &rhs) const {return ptr == rhs.ptr;};
+        bool operator !=(const iterator &rhs) const {return ptr != rhs.ptr;};
+    private:
+        const char *ptr;
+    };
+
+    ArrayView() : ptr(nullptr), n(0) {};
+    ArrayView(const void *p, const size_t &size) : ptr((const char*) p), n(size) {};
+    ArrayView(const std::vector<T> &vec) : ptr((const char*) vec.data()), n(vec.size()) {};
+
+    size_t size() const {return n;};
+    bool empty() const {return n == 0;};
+    const char *data() const {return ptr;};
+    iterator begin() const {return iterator(ptr);};
+    iterator end() const {return iterator(ptr + n*sizeof(T));};
+    T operator [](const size_t &i) const {T t; memcpy((void*) &t, ptr + i*sizeof(T), sizeof(T)); return t;};
+    // Container is a std::vector<T> or the GEMSamples
+    template<class Container>
+    void copy_to(Container &vec) const
+    {
+        vec.resize(n);
+        memcpy((void*) vec.data(), ptr, n*sizeof(T));
+    };
+
+private:
+    const char *ptr;
+    size_t n;
+};
+
+inline GEMSamples::operator ArrayView<float>() const
+{
+    return ArrayView<float>(data(), n);
+}
+
+// read-only span of the aligned elements in memory, such as a part of the
+// per-event pools, it is only valid before the pool is changed
+template<typename T>
+class ArraySpan
+{
+public:
+    ArraySpan() : ptr(nullptr), n(0) {};
+    ArraySpan(const T *p, const size_t &size) : ptr(p), n(size) {};
+    ArraySpan(const std::vector<T> &vec, const size_t &offset, const size_t &size)
+    : ptr(vec.data() + offset), n(size) {};
+
+    size_t size() const {return n;};
+    bool empty() const {return n == 0;};
+    const T *data() const {return ptr;};
+    const T *begin() const {return ptr;};
+    const T *end() const {return ptr + n;};
+    const T &operator [](const size_t &i) const {return ptr[i];};
+
+private:
+    const T *ptr;
+    size_t n;
+};
+
+// a GEM hit record in the DST file, APV address, time samples and values
+struct GEMHitView
+{
+    APVAddress addr;
+    ArrayView<float> values;
+};
+
+// the packed GEM hit records of one event
+class GEMHitRange
+{
+public:
+    class iterator
+    {
+    public:
+        iterator(const char *p) : ptr(p) {};
+        GEMHitView operator *() const
+        {
+            GEMHitView hit;
+            uint32_t size;
+            memcpy(&hit.addr, ptr, sizeof(APVAddress));
+            memcpy(&size, ptr + sizeof(APVAddress), sizeof(size));
+            hit.values = ArrayView<float>(ptr + sizeof(APVAddress) + sizeof(size), size);
+            return hit;
+        };
+        iterator &operator ++()
+        {
+            uint32_t size;
+            memcpy(&size, ptr + sizeof(APVAddress), sizeof(size));
+            ptr += sizeof(APVAddress) + sizeof(size) + size*sizeof(float);
+            return *this;
+        };
+        bool operator ==(const iterator &rhs) const {return ptr == rhs.ptr;};
+        bool operator !=(const iterator &rhs) const {return ptr != rhs.ptr;};
+    private:
+        const char *ptr;
+    };
+
+    GEMHitRange() : first(nullptr), last(nullptr), n(0) {};
+    GEMHitRange(const char *b, const char *e, const size_t &size) : first(b), last(e), n(size) {};
+
+    size_t size() const {return n;};
+    bool empty() const {return n == 0;};
+    iterator begin() const {return iterator(first);};
+    iterator end() const {return iterator(last);};
+
+private:
+    const char *first;
+    const char *last;
+    size_t n;
+};
+
+// event that points to the data banks in a memory mapped DST file
+// it is only valid before the reader moves to the next chunk
+struct EventView
+{
+    // event info
+    int event_number;
+    unsigned char type;
+    unsigned char trigger;
+    uint64_t timestamp;
+
+    // data banks
+    ArrayView<ADC_Data> adc_data;
+    ArrayView<TDC_Data> tdc_data;
+    GEMHitRange gem_data;
+    ArrayView<DSC_Data> dsc_data;
+
+    EventView()
+    : event_number(0), type(0), trigger(0), timestamp(0)
+    {};
+
+    bool is_physics_event() const
+    {
+        return ( (trigger == PHYS_LeadGlassSum) ||
+                 (trigger == PHYS_TotalSum)     ||
+                 (trigger == PHYS_TaggerE)      ||
+                 (trigger == PHYS_Scintillator) );
+    };
+    bool is_monitor_event() const
+    {
+        return ( (trigger == LMS_Led) ||
+                 (trigger == LMS_Alpha) );
+    };
+
+    // copy the event to a full event data container
+    void copy_to(EventData &data) const
+    {
+        data.event_number = event_number;
+        data.type = type;
+        data.trigger = trigger;
+        data.timestamp = timestamp;
+        adc_data.copy_to(data.adc_data);
+        tdc_data.copy_to(data.tdc_data);
+        dsc_data.copy_to(data.dsc_data);
+        data.gem_data.resize(gem_data.size());
+        size_t i = 0;
+        for(const auto &hit : gem_data)
+        {
+            data.gem_data[i].addr = hit.addr;
+            hit.values.copy_to(data.gem_data[i].values);
+            ++i;
+        }
+    };
+};
+
+// epics record in a memory mapped DST file
+struct EPICSView
+{
+    int event_number;
+    ArrayView<float> values;
+
+    EPICSView() : event_number(0) {};
+};
+
 enum HyCalClusterStatus{
     kPWO = 0,     //cluster center at PWO region
     kLG,          //cluster center at LG region
@@ -345,6 +644,19 @@ enum HyCalClusterStatus{
     kMultiGEMHits //multiple GEM hits appear near HyCal Hit
 };
 
+// a module in HyCal cluster
+struct HyCalBlock
+{
+    unsigned short id;  // PrimEx ID of the module
+    float E;            // energy deposited in the module (MeV)
+
+    HyCalBlock() : id(0), E(0) {};
+    HyCalBlock(const unsigned short &i, const float &e) : id(i), E(e) {};
+};
+
+// the modules and the matched GEM clusters are not in the cluster record, they
+// are stored in the per-event pools of the reconstruction and matching, the
+// records only keep the offsets and lengths in the pools
 struct HyCalHit
 {
 #define TIME_MEASURE_SIZE 3
@@ -365,46 +677,46 @@ struct HyCalHit
     float sigma_E;
     float dz;           // z shift due to shower depth corretion
     unsigned short time[TIME_MEASURE_SIZE];      // time information from central TDC group
-    unsigned short moduleID[MAX_CC];
-    float moduleE[MAX_CC];
 
-    //for GEM HyCal match
-    unsigned short gemClusterID[NGEM][MAX_GEM_MATCH];
+    // modules in the block pool of the reconstruction
+    unsigned int block_offset;
+    unsigned short block_size;
+
+    //for GEM HyCal match, cluster ids in the match pool of PRadDetMatch
+    unsigned int gemOffset[NGEM];
     unsigned short gemNClusters[NGEM];
 
     HyCalHit()
     : flag(0), type(0), status(0), nblocks(0), cid(0), E(0), x(0), y(0), x_log(0),
-      y_log(0), chi2(0), sigma_E(0), dz(0)
+      y_log(0), chi2(0), sigma_E(0), dz(0), block_offset(0), block_size(0)
     {
         clear_time();
         clear_gem();
-        for (int i=0; i<NGEM; i++) gemNClusters[i] = 0;
     }
 
     HyCalHit(const float &cx, const float &cy, const float &cE)
     : flag(0), type(0), status(0), nblocks(0), cid(0), E(cE), x(cx), y(cy), x_log(0),
-      y_log(0), chi2(0), sigma_E(0), dz(0)
+      y_log(0), chi2(0), sigma_E(0), dz(0), block_offset(0), block_size(0)
     {
         clear_time();
         clear_gem();
-        for (int i=0; i<NGEM; i++) gemNClusters[i] = 0;
     }
 
     HyCalHit(const float &cx, const float &cy, const float &cE, const std::vector<unsigned short> &t)
     : flag(0), type(0), status(0), nblocks(0), cid(0), E(cE), x(cx), y(cy), x_log(0),
-      y_log(0), chi2(0), sigma_E(0), dz(0)
+      y_log(0), chi2(0), sigma_E(0), dz(0), block_offset(0), block_size(0)
     {
         set_time(t);
+        clear_gem();
     }
 
     HyCalHit(const short &t, const short &s, const short &n,
              const float &cx, const float &cy, const float &cE, const float &ch)
     : flag(0), type(t), status(s), nblocks(n), cid(0), E(cE), x(cx), y(cy), x_log(0),
-      y_log(0), chi2(ch), sigma_E(0), dz(0)
+      y_log(0), chi2(ch), sigma_E(0), dz(0), block_offset(0), block_size(0)
     {
         clear_time();
         clear_gem();
-        for (int i=0; i<NGEM; i++) gemNClusters[i] = 0;
     }
     void clear_time()
     {
@@ -422,14 +734,17 @@ struct HyCalHit
         }
     }
 
-    void add_gem_clusterID(const int & detid, const unsigned short &id){
+    // the ids of a GEM are added together, so they are continuous in the pool
+    void add_gem_clusterID(std::vector<unsigned short> &pool,
+                           const int & detid, const unsigned short &id){
         if (gemNClusters[detid] >= MAX_GEM_MATCH) return;
-        gemClusterID[detid][gemNClusters[detid]] = id;
+        if (gemNClusters[detid] == 0) gemOffset[detid] = pool.size();
+        pool.push_back(id);
         gemNClusters[detid]++;
     }
 
     void clear_gem(){
-        for (int i=0; i<NGEM; i++) gemNClusters[i] = 0;
+        for (int i=0; i<NGEM; i++) {gemOffset[i] = 0; gemNClusters[i] = 0;}
         x_gem = 0.; y_gem = 0.; z_gem = -1;
     }
 
@@ -483,6 +798,37 @@ enum PRadDSTHeader
     // headers
     PRad_DST_Header = 0xc0c0c0,
     PRad_DST_EvHeader = 0xe0e0e0,
+    PRad_DST_ChunkHeader = 0xd0d0d0,
+    PRad_DST_ColumnChunk = 0xd1d1d1,
+    PRad_DST_Footer = 0xf0f0f0,
+};
+
+enum PRadDSTCodec
+{
+    // compression of the chunks in DST version 2
+    DST_Codec_None = 0,
+    DST_Codec_Zlib,
+};
+
+enum PRadDSTColumn
+{
+    // column blocks of the events in a column chunk
+    DST_Column_Header = 0,
+    DST_Column_ADC,
+    DST_Column_TDC,
+    DST_Column_GEM,
+    DST_Column_DSC,
+    DST_Column_Size,
+};
+
+enum PRadDSTReadMask
+{
+    // data banks to be read from the DST events
+    DST_READ_ADC = 1 << 0,
+    DST_READ_TDC = 1 << 1,
+    DST_READ_GEM = 1 << 2,
+    DST_READ_DSC = 1 << 3,
+    DST_READ_ALL = 0xf,
 };
 
 enum PRadDSTMode
@@ -496,4 +842,12 @@ enum PRadDSTMode
     DST_UPDATE_NONE = 0xffffffff,
 };
 
+enum PRadEventStorage
+{
+    // how the data handler keeps the decoded events
+    Storage_KeepAll = 0,  // all the events in memory
+    Storage_Ring,         // only the last N events in memory
+    Storage_Spill,        // the last N events in memory, older ones in a temporary DST
+};
+
 #endif
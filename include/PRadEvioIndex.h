@@ -0,0 +1,47 @@
+#ifndef PRAD_EVIO_INDEX_H
+#define PRAD_EVIO_INDEX_H
+
+#include <vector>
+#include <string>
+#include <cstdint>
+
+class PRadEvioIndex
+{
+public:
+    struct Entry
+    {
+        int event_number;
+        unsigned short tag;
+        uint64_t offset;  // in bytes, from the beginning of evio file
+
+        Entry() : event_number(0), tag(0), offset(0) {};
+        Entry(const int &ev, const unsigned short &t, const uint64_t &off)
+        : event_number(ev), tag(t), offset(off) {};
+    };
+
+public:
+    PRadEvioIndex();
+    virtual ~PRadEvioIndex();
+
+    bool Build(const std::string &evio_path);
+    bool Save(const std::string &path);
+    bool Load(const std::string &path);
+    bool Open(const std::string &evio_path, const bool &save = true);
+    void Clear();
+
+    const std::string &GetFilePath() const {return file_path;};
+    uint64_t GetFileSize() const {return file_size;};
+    const std::vector<Entry> &GetEntries() const {return entries;};
+    size_t GetSize() const {return entries.size();};
+    int FindEntry(const int &event_number) const;
+    int LowerBound(const int &event_number) const;
+
+    static std::string SidecarPath(const std::string &evio_path);
+
+private:
+    std::string file_path;
+    uint64_t file_size;
+    std::vector<Entry> entries;
+};
+
+#endif
@@ -3,11 +3,15 @@
 
 #include <fstream>
 #include <cstdint>
+#include <vector>
 #include "datastruct.h"
 #include "PRadException.h"
 
 class PRadDataHandler;
+class PRadEventPipeline;
+class PRadEvioIndex;
 class ConfigParser;
+struct EventData;
 
 class PRadEvioParser
 {
@@ -16,30 +20,51 @@ public:
     virtual ~PRadEvioParser();
     unsigned int GetEventNumber() {return event_number;};
     void SetEventNumber(const unsigned int &ev) {event_number = ev;};
+    void SetMMapMode(const bool &m) {mmap_mode = m;};
+    bool GetMMapMode() {return mmap_mode;};
+    void SetPipeline(PRadEventPipeline *p) {pipeline = p;};
     void ReadEvioFile(const char *filepath, const int &evt = -1, const bool &verbose = false);
     void ParseEventByHeader(PRadEventHeader *evt_header);
+    bool DecodeEvent(PRadEventHeader *evt_header, EventData &data);
+    int ReadEvent(const char *filepath, const int &ev);
+    int ReadRange(const char *filepath, const int &first, const int &last);
+    int ReadEPICS(const char *filepath);
+    PRadEvioIndex *GetIndex() {return index;};
 
     static PRadTriggerType bit_to_trigger(const unsigned int &bit);
     static unsigned int trigger_to_bit(const PRadTriggerType &trg);
 
 private:
+    void dispatchEvent(PRadEventHeader *evt_header);
     void parseROCBank(PRadEventHeader *roc_header);
     void parseDataBank(PRadEventHeader *data_header);
     void parseADC1881M(const uint32_t *data);
     void parseGEMData(const uint32_t *data, const size_t &size, const int &fec_id);
     void parseGEMZeroSupData(const uint32_t *data, const size_t &size);
+    void feedGEMFrames();
     void parseTDCV767(const uint32_t *data, const size_t &size, const int &roc_id);
     void parseTDCV1190(const uint32_t *data, const size_t &size, const int &roc_id);
     void parseDSCData(const uint32_t *data, const size_t &size);
     void parseTIData(const uint32_t *data, const size_t &size, const int &roc_id);
     void parseEPICS(const uint32_t *data);
+    void parseEPICSEvent(PRadEventHeader *header);
     size_t getAPVDataSize(const uint32_t *data);
     int getEvioBlock(std::ifstream &s, uint32_t *buf) throw(PRadException);
+    int parseEvioBlock(const uint32_t *buf, const size_t &max_size) throw(PRadException);
+    bool readEvioMMap(const char *filepath, const int &evt, const bool &verbose);
+    void readEvioStream(const char *filepath, const int &evt, const bool &verbose);
+    bool readIndexedEvents(const char *filepath, const size_t &begin, const size_t &end, int &count,
+                           const bool &epics_only = false);
 
 private:
     PRadDataHandler *myHandler;
     ConfigParser *c_parser;
+    PRadEventPipeline *pipeline;
+    PRadEvioIndex *index;
+    EventData *event_data;
+    std::vector<GEMRawData> gem_frames;
     unsigned int event_number;
+    bool mmap_mode;
 };
 
 #endif
@@ -4,7 +4,11 @@
 #include <vector>
 #include <fstream>
 #include <iostream>
+#ifdef MULTI_THREAD
+#include <mutex>
+#endif
 #include "PRadEventStruct.h"
+#include "PRadAPVKernel.h"
 #include "datastruct.h"
 
 class PRadGEMPlane;
@@ -53,7 +57,7 @@ public:
     void FitPedestal();
     void FillRawData(const uint32_t *buf, const size_t &siz);
     void FillZeroSupData(const size_t &ch, const size_t &ts, const unsigned short &val);
-    void FillZeroSupData(const size_t &ch, const std::vector<float> &vals);
+    void FillZeroSupData(const size_t &ch, const ArrayView<float> &vals);
     void SplitData(const uint32_t &buf, float &word1, float &word2);
     void UpdatePedestal(std::vector<Pedestal> &ped);
     void UpdatePedestal(const Pedestal &ped, const size_t &index);
@@ -91,8 +95,14 @@ public:
     void SetOrientation(const int &o) {orientation = o;};
     void SetPlaneIndex(const int &p);
     void SetHeaderLevel(const int &h) {header_level = h;};
-    void SetCommonModeThresLevel(const float &t) {common_thres = t;};
-    void SetZeroSupThresLevel(const float &t) {zerosup_thres = t;};
+    void SetCommonModeThresLevel(const float &t) {common_thres = t; updateKernelTables();};
+    void SetZeroSupThresLevel(const float &t) {zerosup_thres = t; updateKernelTables();};
+#ifdef MULTI_THREAD
+    std::mutex &GetLocker() {return locker;};
+#endif
+
+private:
+    void updateKernelTables();
 
 private:
     PRadGEMPlane *plane;
@@ -116,6 +126,10 @@ private:
     bool hit_pos[TIME_SAMPLE_SIZE];
     TH1I *offset_hist[TIME_SAMPLE_SIZE];
     TH1I *noise_hist[TIME_SAMPLE_SIZE];
+    PRadAPVKernel::Tables kernel_tables;
+#ifdef MULTI_THREAD
+    std::mutex locker;
+#endif
 };
 
 std::ostream &operator <<(std::ostream &os, const GEMChannelAddress &ad);
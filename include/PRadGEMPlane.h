@@ -4,6 +4,7 @@
 #include <list>
 #include <vector>
 #include <string>
+#include "PRadEventStruct.h"
 
 class PRadGEMDetector;
 class PRadGEMAPV;
@@ -59,9 +60,9 @@ public:
     void ConnectAPV(PRadGEMAPV *apv);
     void DisconnectAPV(const size_t &plane_index);
     double GetStripPosition(const int &plane_strip);
-    double GetMaxCharge(const std::vector<float> &charges);
+    double GetMaxCharge(const ArrayView<float> &charges);
     double GetIntegratedCharge(const std::vector<float> &charges);
-    void AddPlaneHit(const int &plane_strip, const std::vector<float> &charges);
+    void AddPlaneHit(const int &plane_strip, const ArrayView<float> &charges);
     void ClearPlaneHits();
     void CollectAPVHits();
     void ReconstructHits();
@@ -11,6 +11,8 @@
 #include "PRadGEMPlane.h"
 #include "PRadGEMFEC.h"
 #include "PRadGEMAPV.h"
+#include "PRadLookupTable.h"
+#include "PRadThreadPool.h"
 
 
 #ifdef MULTI_THREAD
@@ -42,7 +44,9 @@ public:
     void Clear();
     void SortFECList();
     void ChooseEvent(const EventData &data);
+    void ChooseEvent(const EventView &data);
     void Reconstruct(const EventData &data);
+    void Reconstruct(const EventView &data);
     void LoadConfiguration(const std::string &path) throw(PRadException);
     void LoadPedestal(const std::string &path) throw(PRadException);
     void RegisterDetector(PRadGEMDetector *det);
@@ -50,6 +54,7 @@ public:
     void RegisterAPV(const std::string &plane, PRadGEMAPV *apv);
     void BuildAPVMap();
     void FillRawData(GEMRawData &raw, std::vector<GEM_Data> &container, const bool &fill_hist = false);
+    void FillRawData(std::vector<GEMRawData> &frames, std::vector<GEM_Data> &container, const bool &fill_hist = false);
     void FillZeroSupData(std::vector<GEMZeroSupData> &data_pack, std::vector<GEM_Data> &container);
     void FillZeroSupData(GEMZeroSupData &data);
 
@@ -57,6 +62,7 @@ public:
     void SetUnivZeroSupThresLevel(const float &thres);
     void SetUnivTimeSample(const size_t &thres);
     void SetPedestalMode(const bool &m);
+    void SetThreadPool(PRadThreadPool *pool) {thread_pool = pool;};
     void FitPedestal();
     void SavePedestal(const std::string &path);
     void SaveHistograms(const std::string &path);
@@ -73,6 +79,13 @@ public:
     std::vector<PRadGEMDetector*> &GetDetectorList() {return det_list;};
     std::vector<PRadGEMFEC*> &GetFECList() {return fec_list;};
     std::vector<PRadGEMAPV*> GetAPVList();
+    PRadThreadPool *GetThreadPool() {return thread_pool;};
+
+private:
+    template<typename T>
+    void chooseEvent(const T &data);
+    template<typename T>
+    void reconstruct(const T &data);
 
 private:
     std::vector<PRadGEMDetector*> det_list;
@@ -81,11 +94,9 @@ private:
     std::vector<PRadGEMFEC*> fec_list;
     std::unordered_map<int, PRadGEMFEC*> fec_map;
     std::unordered_map<GEMChannelAddress, PRadGEMAPV*> apv_map;
+    PRadLookupTable<PRadGEMAPV> apv_table;
     bool PedestalMode;
-
-#ifdef MULTI_THREAD
-    std::mutex locker;
-#endif
+    PRadThreadPool *thread_pool;
 };
 
 #endif
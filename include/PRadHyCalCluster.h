@@ -8,6 +8,7 @@
 #include "PRadDataHandler.h"
 #include "PRadDAQUnit.h"
 #include "PRadTDCGroup.h"
+#include "PRadModuleGrid.h"
 #include "ConfigParser.h"
 
 #define MAX_HCLUSTERS 250 // Maximum storage
@@ -16,6 +17,31 @@ class PRadDataHandler;
 
 class PRadHyCalCluster
 {
+public:
+    // constants of a channel copied from the handler, the energies of the
+    // modules are calculated from them without touching the channels
+    struct ModuleInfo
+    {
+        bool hycal;
+        int primex_id;
+        int tdc_id;         // index of the tdc group in handler, -1 for none
+        double pedestal;
+        double factor;      // MeV per adc count
+        PRadDAQUnit::Geometry geometry;
+    };
+
+    // a fired HyCal module in the event
+    struct ModuleHit
+    {
+        unsigned short id;  // channel id in handler
+        int primex_id;
+        int tdc_id;
+        double energy;      // MeV
+        double x;
+        double y;
+        PRadDAQUnit::ChannelType type;
+    };
+
 public:
     PRadHyCalCluster(PRadDataHandler *h = nullptr);
     virtual ~PRadHyCalCluster();
@@ -25,21 +51,53 @@ public:
                                const std::string &def_value,
                                bool verbose = true);
     void SetHandler(PRadDataHandler *h);
+    virtual void UpdateModuleTable();
+    const std::vector<ModuleInfo> &GetModuleTable() const {return fModuleTable;};
+    const PRadModuleGrid &GetModuleGrid() const {return fModuleGrid;};
+    const std::vector<ModuleHit> &GetModuleHits() const {return fModuleHits;};
+    const std::vector<unsigned short> &GetTimeMeasure(const int &tdc_id) const;
 
     // functions that to be overloaded
+    virtual PRadHyCalCluster *Clone();
     virtual void Configure(const std::string &path);
     virtual void Clear();
     virtual void Reconstruct(EventData &event);
+    virtual void Reconstruct(const EventView &event);
     virtual int GetNClusters() {return fNHyCalClusters;};
     virtual HyCalHit *GetCluster() {return fHyCalCluster;};
+    ArraySpan<HyCalHit> GetClusters() const {return ArraySpan<HyCalHit>(fHyCalCluster, fNHyCalClusters);};
+    ArraySpan<HyCalBlock> GetBlocks() const {return ArraySpan<HyCalBlock>(fBlockPool.data(), fBlockPool.size());};
+    ArraySpan<HyCalBlock> GetClusterBlocks(const HyCalHit &hit) const
+    {
+        return ArraySpan<HyCalBlock>(fBlockPool, hit.block_offset, hit.block_size);
+    };
+
+protected:
+    // reconstruct from the fired modules in fModuleHits
+    virtual void ReconstructModules();
+    void checkModuleTable();
+
+private:
+    template<typename T>
+    void loadEvent(const T &event);
 
 protected:
     PRadDataHandler *fHandler;
+    // channel constants and the setup version of handler they are from
+    std::vector<ModuleInfo> fModuleTable;
+    unsigned int fTableVersion;
+    // spatial index of the modules, indexed by channel id
+    PRadModuleGrid fModuleGrid;
+    // fired modules sorted by channel id, and the time measures of the event
+    std::vector<ModuleHit> fModuleHits;
+    std::vector< std::vector<unsigned short> > fTimeMeasure;
+    std::vector<int> fFiredTDC;
     // configuration map
     std::unordered_map<std::string, ConfigValue> fConfigMap;
-    // result array
+    // result array and the modules of the clusters in this event
     HyCalHit fHyCalCluster[MAX_HCLUSTERS];
     int fNHyCalClusters;
+    std::vector<HyCalBlock> fBlockPool;
 };
 
 #endif
@@ -3,6 +3,7 @@
 
 #include <string>
 #include "PRadHyCalCluster.h"
+#include "PRadIslandKernel.h"
 #include <vector>
 
 //this is a c++ wrapper around the primex island algorithm
@@ -64,74 +65,24 @@ typedef struct
     float e;   // Energy of ADC
 } cluster_block_t;
 
-extern "C"
-{
-    void load_pwo_prof_(char* config_dir, int str_len);
-    void load_lg_prof_(char* config_dir, int str_len);
-    void main_island_();
-    extern struct
-    {
-        int ech[MROW][MCOL];
-    } ech_common_;
-
-    extern struct
-    {
-        int stat_ch[MROW][MCOL];
-    } stat_ch_common_;
-
-    extern struct
-    {
-        int icl_index[MAX_CC][200], icl_iener[MAX_CC][200];
-    } icl_common_;
-
-    extern struct
-    {
-        float xsize, ysize, mine, maxe;
-        int min_dime;
-        float minm;
-        int ncol, nrow;
-        float zhycal;
-        int isect;
-    } set_common_;
-
-    extern struct
-    {
-        int nadcgam;
-        union
-        {
-            int iadcgam[50][11];
-            float fadcgam[50][11];
-        } u;
-    } adcgam_cbk_;
-
-    extern struct
-    {
-        float fa[100];
-    } hbk_common_;
-
-    #define ECH(M,N) ech_common_.ech[N-1][M-1]
-    #define STAT_CH(M,N) stat_ch_common_.stat_ch[N-1][M-1]
-    #define ICL_INDEX(M,N) icl_common_.icl_index[N][M]
-    #define ICL_IENER(M,N) icl_common_.icl_iener[N][M]
-    #define HEGEN(N) read_mcfile_com_.hegen[N-1]
-    #define SET_XSIZE set_common_.xsize
-    #define SET_YSIZE set_common_.ysize
-    #define SET_EMIN  set_common_.mine
-    #define SET_EMAX  set_common_.maxe
-    #define SET_HMIN  set_common_.min_dime
-    #define SET_MINM  set_common_.minm
-    #define NCOL      set_common_.ncol
-    #define NROW      set_common_.nrow
-    #define ZHYCAL    set_common_.zhycal
-    #define ISECT     set_common_.isect
-    #define FA(N) hbk_common_.fa[N-1]
-}
+// cluster cuts that were passed to island.F in set_common
+#define ISLAND_MAX_CLUSTER_E 9.9
+#define ISLAND_MIN_CLUSTER_HITS 1
+#define ISLAND_MIN_MAX_CELL_E 0.01
+
+// points of the Finv table for the double exponential weight
+#define ISLAND_FINV_TABLE_SIZE 1024
+
+// clusters in different sectors are glued if they have cells closer than 1.1
+// module size, so the cells that can be glued are within 1.1 glass size (cm)
+#define ISLAND_GLUE_RANGE (1.1*GLASS_SIZE*1.001)
 
 class PRadIslandCluster : public PRadHyCalCluster
 {
 public:
     PRadIslandCluster(PRadDataHandler *h = nullptr);
     virtual ~PRadIslandCluster() {;}
+    PRadHyCalCluster *Clone();
 
     void  SetHandler(PRadDataHandler* theHandler) { fHandler = theHandler; }
     void  Configure(const std::string &c_path);
@@ -139,13 +90,15 @@ public:
     void  LoadCrystalProfile(const std::string &path);
     void  LoadLeadGlassProfile(const std::string &path);
     void  LoadNonLinearity(const std::string &path);
-    void  Reconstruct(EventData &event);
     void  Clear();
 
 protected:
-    void  LoadModuleData(EventData& thisEvent);
+    void  ReconstructModules();
+    void  LoadModuleData();
     void  CallIsland(int isect);
     void  GlueTransitionClusters();
+    void  FindTransitionBlocks();
+    int   GlueGroupRoot(int i);
     void  ClusterProcessing();
     int   ClustersMinDist(int i,int j);
     void  MergeClusters(int i, int j);
@@ -153,6 +106,7 @@ protected:
     void  FinalProcessing();
     float GetShowerDepth(int type, float & E);
     float GetDoubleExpWeight(float& e, float& E);
+    void  BuildWeightTable();
     float Finv(float y);
     float Fx(float& x);
     
@@ -168,14 +122,29 @@ protected:
     float fZHyCal;
     float fCutOffThr;
     float f2ExpFreeWeight;
+    // Finv at the cut off and 1, and Finv on a log(y) grid from the cut off
+    // to 1, they only depend on the configuration
+    float fFinvCutOff;
+    float fFinvOne;
+    float fFinvLogMin;
+    float fFinvLogStep;
+    std::vector<float> fFinvTable;
 
     blockINFO_t fBlockINFO[T_BLOCKS];
+    // blocks within the glue range of a block in another sector
+    bool fTransitionBlock[T_BLOCKS];
+    // cells of the clusters in the spatial hash, the cluster pairs to test
+    // and the glue groups as a union-find, reused for every event
+    std::vector< std::pair<int, int> > fGlueCells;
+    std::vector< std::pair<int, int> > fGluePairs;
+    std::vector<int> fGlueParent;
     float fNonLin[T_BLOCKS];
     int fModuleStatus[MSECT][MCOL][MROW];
     int fNClusterBlocks;
     cluster_block_t fClusterBlock[T_BLOCKS];
     cluster_t fClusterStorage[MAX_HCLUSTERS];
     int ich[MCOL][MROW];
+    PRadIslandKernel fIsland;
     std::vector<blockINFO_t> fDeadModules;
     float fE0[2];
     float fZ0[2];
@@ -0,0 +1,114 @@
+#ifndef PRAD_ISLAND_KERNEL_H
+#define PRAD_ISLAND_KERNEL_H
+
+#include <string>
+#include <vector>
+#include <memory>
+
+// dimensions from island.F
+#define ISLAND_MAX_COL 34       // MCOL
+#define ISLAND_MAX_ROW 34       // MROW
+#define ISLAND_MAX_CC 60        // MAX_CC
+#define ISLAND_MAX_GAMMAS 50    // madcgam
+#define ISLAND_MAX_CLUSTERS 200 // maxcl in clus_hyc
+#define ISLAND_PROFILE_SIZE 501 // profile tables are 0:500 in 0.01 cell
+
+// C++ port of the PrimEx island algorithm in island.F, all the data that were
+// in the common blocks are members of the instance, so several instances can
+// reconstruct events at the same time, the profile tables are shared by the
+// copies of an instance since they are only read in reconstruction
+class PRadIslandKernel
+{
+public:
+    // a point of the profile tables, the energy fraction and its derivative
+    // are stored together since the chi2 reads both at the same point
+    struct ProfilePoint
+    {
+        float cell;
+        float d2c;
+    };
+
+    // shower profile of crystal (0) and lead glass (1), same as profile_com
+    struct Profile
+    {
+        ProfilePoint point[2][ISLAND_PROFILE_SIZE][ISLAND_PROFILE_SIZE];
+    };
+
+    // reconstructed gamma, same as adcgam_cbk and icl_common
+    struct Gamma
+    {
+        float energy;   // GeV
+        float x, y, z;  // cm, PrimEx convention
+        float xc, yc;   // cm, shift of the two-gamma split
+        float chi2;
+        int type;
+        int dime;       // number of cells
+        int id;
+        int status;
+        int icl_index[ISLAND_MAX_CC];  // cell address 100*col + row
+        int icl_iener[ISLAND_MAX_CC];  // cell energy in 0.1 MeV
+    };
+
+public:
+    PRadIslandKernel();
+
+    bool LoadProfile(const int &type, const std::string &path);
+    void SetSector(const int &isect, const int &ncol, const int &nrow,
+                   const float &xsize, const float &ysize);
+    void SetStatus(const int &col, const int &row, const int &status);
+    void SetEnergy(const int &col, const int &row, const int &energy);
+    int Reconstruct();
+    int GetNGammas() const {return nadcgam;};
+    const Gamma &GetGamma(const int &i) const {return gammas[i];};
+
+private:
+    // routines of island.F, the arrays are 1-based as in fortran
+    void dataHyc(int &nw);
+    void clusHyc(const int &nw, int &ncl);
+    void orderHyc(const int &nw, int *ia, int *id);
+    void gamsHyc(const int &nadc, int *ia, int *id);
+    int peakType(const int &ix, const int &iy) const;
+    void gammaHyc(const int &nadc, const int *ia, const int *id,
+                  float &chisq, float &e1, float &x1, float &y1);
+    void fillZeros(const int &nadc, const int *ia, int &nneib);
+    void mom1Pht(const int &nadc, const int *ia, const int *id, const int &nzero,
+                 float &a0, float &x0, float &y0) const;
+    float chisq1Hyc(const int &nadc, const int *ia, const int *id, const int &nneib,
+                    const float &e1, const float &x1, const float &y1);
+    void sigma2Terms(const float &e);
+    float sigma2(const float &dx, const float &dy, const float &fc, const float &d2) const;
+    const ProfilePoint *profilePoint(const float &x, const float &y, float &wx, float &wy) const;
+    void profileHyc(const float &x, const float &y, float &fc, float &d2) const;
+    float cellHyc(const float &x, const float &y) const;
+    void outHyc();
+    int *iwrk(const int &col) {return &work_i[col*(ISLAND_MAX_COL*ISLAND_MAX_ROW + 1)];};
+    float *fwrk(const int &col) {return &work_f[col*(ISLAND_MAX_COL*ISLAND_MAX_ROW + 1)];};
+
+private:
+    std::shared_ptr<Profile> profile;
+    // profile table of the sector
+    const ProfilePoint (*sect_profile)[ISLAND_PROFILE_SIZE];
+
+    // set_common
+    float xsize, ysize;
+    int ncol, nrow, isect;
+
+    // terms of sigma2 that only depend on the gamma energy
+    float sig2_d2c, sig2_ped;
+    double sig2_scale;
+
+    // ech_common and stat_ch_common
+    int ech[ISLAND_MAX_COL][ISLAND_MAX_ROW];
+    int stat_ch[ISLAND_MAX_COL][ISLAND_MAX_ROW];
+
+    // hits, clusters and working arrays
+    std::vector<int> ia, id, lencl, iaz;
+    std::vector<int> work_i;
+    std::vector<float> work_f;
+
+    // output
+    int nadcgam;
+    Gamma gammas[ISLAND_MAX_GAMMAS];
+};
+
+#endif
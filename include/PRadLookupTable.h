@@ -0,0 +1,72 @@
+//============================================================================//
+// Direct-indexed lookup table for the DAQ channels                           //
+// The DAQ address is packed into a small integer in the same way as its hash //
+// function, and it is used as the index of a flat array, so routing a data   //
+// word in decoding is one bound check and one array access. The hash maps    //
+// are still kept for the queries at configuration time                       //
+//                                                                            //
+// agent                                                                      //
+// 10/17/2026                                                                 //
+//============================================================================//
+
+#ifndef PRAD_LOOKUP_TABLE_H
+#define PRAD_LOOKUP_TABLE_H
+
+#include <vector>
+#include <cstddef>
+#include "datastruct.h"
+
+#define LOOKUP_INVALID_INDEX ((size_t) -1)
+
+// crate id is 1-6, slot is 1-26, channel is 0-63 (0-127 for TDC V1190)
+// [ 0 0 0 | 0 0 0 0 0 | 0 0 0 0 0 0 0 0 ]
+// [ crate |    slot   |     channel     ]
+inline size_t lookup_index(const ChannelAddress &addr)
+{
+    if(addr.crate >= (1 << 3) || addr.slot >= (1 << 5) || addr.channel >= (1 << 8))
+        return LOOKUP_INVALID_INDEX;
+    return (addr.crate << 13 | addr.slot << 8 | addr.channel);
+}
+
+// [ fec id (8 bits) | adc channel (8 bits) ]
+inline size_t lookup_index(const GEMChannelAddress &addr)
+{
+    if(addr.fec_id < 0 || addr.fec_id >= (1 << 8) ||
+       addr.adc_ch < 0 || addr.adc_ch >= (1 << 8))
+        return LOOKUP_INVALID_INDEX;
+    return (addr.fec_id << 8 | addr.adc_ch);
+}
+
+template<typename T>
+class PRadLookupTable
+{
+public:
+    // the table only grows to the largest address that is set
+    template<typename Address>
+    bool Set(const Address &addr, T *val)
+    {
+        size_t idx = lookup_index(addr);
+        if(idx == LOOKUP_INVALID_INDEX)
+            return false;
+        if(idx >= table.size())
+            table.resize(idx + 1, nullptr);
+        table[idx] = val;
+        return true;
+    };
+
+    // return nullptr if nothing is set for the address
+    template<typename Address>
+    T *Get(const Address &addr) const
+    {
+        size_t idx = lookup_index(addr);
+        return (idx < table.size()) ? table[idx] : nullptr;
+    };
+
+    void Clear() {table.clear();};
+    size_t Size() const {return table.size();};
+
+private:
+    std::vector<T*> table;
+};
+
+#endif
@@ -0,0 +1,35 @@
+#ifndef PRAD_MODULE_GRID_H
+#define PRAD_MODULE_GRID_H
+
+#include <vector>
+#include "PRadDAQUnit.h"
+
+// uniform grid over the modules, a module is registered in all the cells its
+// area overlaps, the modules are indexed by their positions in the list
+class PRadModuleGrid
+{
+public:
+    PRadModuleGrid();
+
+    void Clear();
+    void Build(const std::vector<PRadDAQUnit::Geometry> &geometry);
+    int Locate(const double &x, const double &y) const;
+    void FindNeighbors(const double &x, const double &y, const double &radius,
+                       std::vector<unsigned short> &ids) const;
+    size_t GetNbOfModules() const {return modules.size();};
+    double GetCellSize() const {return cell_size;};
+
+private:
+    int cellX(const double &x) const;
+    int cellY(const double &y) const;
+
+private:
+    std::vector<PRadDAQUnit::Geometry> modules;
+    double x_min, y_min, cell_size;
+    int nx, ny;
+    // modules in cell i are cell_ids[cell_begin[i]] to cell_ids[cell_begin[i+1]-1]
+    std::vector<unsigned int> cell_begin;
+    std::vector<unsigned short> cell_ids;
+};
+
+#endif
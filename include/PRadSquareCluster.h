@@ -9,18 +9,20 @@ public:
     PRadSquareCluster(PRadDataHandler *h = nullptr);
     virtual ~PRadSquareCluster();
 
+    PRadHyCalCluster *Clone();
     void Configure(const std::string &path);
     void Clear();
-    void Reconstruct(EventData &event);
+    void UpdateModuleTable();
     PRadDAQUnit *LocateModule(const double &x, const double &y);
 
 protected:
+    void ReconstructModules();
     unsigned short getMaxEChannel();
     //void GEMCoorToLab(float* x, float *y, int type);
     //void HyCalCoorToLab(float* x, float *y);
     bool useLogWeight(double x, double y);
-    std::vector<unsigned short> findCluster(unsigned short cneterID, double &clusterEnergy);
-    std::vector<unsigned short> &GetTimeForCluster(PRadDAQUnit *module);
+    std::vector<const ModuleHit*> findCluster(unsigned short cneterID, double &clusterEnergy);
+    const std::vector<unsigned short> &GetTimeForCluster(const unsigned short &centerID);
 
     // parameters for reconstruction
     double fMinClusterCenterE;
@@ -32,6 +34,15 @@ protected:
     double fLogWeightThres;
     std::vector<unsigned short> fClusterCenterID;
 
+    // precomputed neighbors of every module by channel id
+    // cluster: the modules within the cluster radius of their types
+    // merge: the modules that cannot be a new center if it is a center
+    std::vector< std::vector<unsigned short> > fClusterNeighbors;
+    std::vector< std::vector<unsigned short> > fMergeNeighbors;
+    // hit index of the channels and the merged flags in current event
+    std::vector<int> fHitIndex;
+    std::vector<unsigned char> fMerged;
+
 public:
     static double Distance(PRadDAQUnit *u1, PRadDAQUnit *u2);
     static double Distance(const double &x1, const double &y1, const double &x2, const double &y2);
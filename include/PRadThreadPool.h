@@ -0,0 +1,139 @@
+#ifndef PRAD_THREAD_POOL_H
+#define PRAD_THREAD_POOL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <deque>
+#include <map>
+#include <ostream>
+#include <atomic>
+#include <mutex>
+#include <functional>
+#ifdef MULTI_THREAD
+#include <thread>
+#include <condition_variable>
+#endif
+
+// environment variable for the number of threads, it has priority over the
+// configuration file
+#define THREAD_POOL_ENV "PRAD_THREAD_POOL_SIZE"
+
+class PRadThreadPool
+{
+public:
+    typedef std::function<void()> Job;
+    typedef std::function<void(const size_t &)> Task;
+
+    // timing of the jobs from the groups with the same name
+    struct TaskStat
+    {
+        uint64_t count;
+        uint64_t total_ns;
+        uint64_t max_ns;
+
+        TaskStat() : count(0), total_ns(0), max_ns(0) {};
+    };
+
+    // a group of jobs that can be waited together, Wait() runs the queued
+    // jobs of the group in the waiting thread, so a job can wait for its own
+    // sub-group without blocking a thread of the pool
+    class TaskGroup
+    {
+        friend class PRadThreadPool;
+
+    public:
+        TaskGroup(PRadThreadPool *p, const std::string &n = "Default");
+        virtual ~TaskGroup();
+
+        void Run(const Job &job);
+        void Wait();
+        bool Finished() const {return pending == 0;};
+        const std::string &GetName() const {return name;};
+        PRadThreadPool *GetPool() const {return pool;};
+
+    private:
+        void execute(const Job &job);
+
+    private:
+        PRadThreadPool *pool;
+        std::string name;
+        std::atomic<size_t> pending;
+        std::atomic<uint64_t> count;
+        std::atomic<uint64_t> total_ns;
+        std::atomic<uint64_t> max_ns;
+#ifdef MULTI_THREAD
+        std::mutex done_lock;
+        std::condition_variable done_cond;
+#endif
+    };
+
+public:
+    PRadThreadPool(const size_t &n_threads = 0);
+    virtual ~PRadThreadPool();
+
+    void Resize(const size_t &n_threads);
+    size_t GetThreadNumber() const;
+    void ParallelFor(const size_t &n, const Task &task, const std::string &name = "Parallel For");
+
+    // statistics
+    size_t GetQueueDepth() const {return depth;};
+    size_t GetMaxQueueDepth() const {return max_depth;};
+    uint64_t GetStealCount() const {return steals;};
+    std::map<std::string, TaskStat> GetTaskStats();
+    void ResetStatistics();
+    void PrintStatistics(std::ostream &os);
+
+    static int GetEnvironmentSize();
+    static size_t GetDefaultSize();
+
+private:
+    void collect(TaskGroup *group);
+
+#ifdef MULTI_THREAD
+    struct Item
+    {
+        Job job;
+        TaskGroup *group;
+
+        Item(const Job &j, TaskGroup *g) : job(j), group(g) {};
+    };
+
+    // every worker has its own queue, the worker takes the newest job from
+    // its own queue and steals the oldest ones from the others, the jobs
+    // from the other threads go to the shared queue
+    struct Queue
+    {
+        std::mutex lock;
+        std::deque<Item*> items;
+    };
+
+    void push(Item *item);
+    Item *take();
+    Item *popBack(Queue *queue);
+    Item *popFront(Queue *queue);
+    Item *popGroup(Queue *queue, TaskGroup *group);
+    bool runOne();
+    bool runGroup(TaskGroup *group);
+    void workerLoop(const size_t &index);
+    void start(const size_t &n);
+    void stop();
+
+private:
+    std::vector<std::thread> threads;
+    std::vector<Queue*> queues;
+    Queue shared;
+    std::mutex sleep_lock;
+    std::condition_variable sleep_cond;
+    bool stopped;
+#endif
+
+    std::atomic<size_t> depth;
+    std::atomic<size_t> max_depth;
+    std::atomic<uint64_t> steals;
+    std::mutex stat_lock;
+    std::map<std::string, TaskStat> stats;
+};
+
+#endif
@@ -0,0 +1,421 @@
+//============================================================================//
+// Vectorized kernels for processing the APV raw data                         //
+// Raw word unpacking, APV header search, pedestal subtraction, common mode   //
+// correction, time sample averaging and zero suppression threshold are done  //
+// with SSE2 or AVX2 if the cpu supports them, and with the scalar code       //
+// otherwise, the level is chosen at runtime.                                 //
+// The results are bit-compatible with the scalar code in PRadGEMAPV, so the  //
+// common mode average is still summed channel by channel in the original     //
+// order, only the masking and the element-wise arithmetic are vectorized     //
+//                                                                            //
+// agent                                                                      //
+// 10/17/2026                                                                 //
+//============================================================================//
+
+#include "PRadAPVKernel.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define APV_KERNEL_X86
+#include <immintrin.h>
+#endif
+
+#define N_CH APV_KERNEL_CHANNELS
+
+PRadAPVKernel::Level PRadAPVKernel::level = PRadAPVKernel::GetBestLevel();
+
+// sum in the channel order, the channels not selected are zeros, adding
+// zeros does not change the sum so it is the same as the scalar code
+static inline float ordered_sum(const float *vals)
+{
+    float sum = 0.;
+    for(size_t i = 0; i < N_CH; ++i)
+        sum += vals[i];
+    return sum;
+}
+
+static void zero_sup_scalar(const PRadAPVKernel::Tables &tab,
+                            float *buf,
+                            const size_t &ts_diff,
+                            const size_t &time_samples,
+                            bool *hit_pos)
+{
+    for(size_t ts = 0; ts < time_samples; ++ts)
+    {
+        float *ch = buf + ts*ts_diff;
+        int count1 = 0, count2 = 0;
+        float average1 = 0, average2 = 0;
+
+        for(size_t i = 0; i < N_CH; ++i)
+        {
+            ch[i] = tab.offset[i] - ch[i];
+            if(ch[i] < tab.cm_thres[i]) {
+                if(tab.group[i]) {
+                    average1 += ch[i];
+                    count1++;
+                } else {
+                    average2 += ch[i];
+                    count2++;
+                }
+            }
+        }
+
+        if(count1)
+            average1 /= (float)count1;
+        if(count2)
+            average2 /= (float)count2;
+
+        for(size_t i = 0; i < N_CH; ++i)
+        {
+            ch[i] -= tab.group[i] ? average1 : average2;
+        }
+    }
+
+    for(size_t i = 0; i < N_CH; ++i)
+    {
+        float average = 0.;
+        for(size_t j = 0; j < time_samples; ++j)
+        {
+            average += buf[i + j*ts_diff];
+        }
+        average /= time_samples;
+
+        hit_pos[i] = (average > tab.zs_thres[i]);
+    }
+}
+
+// a 32 bit SRS word has two 16 bit samples in big endian
+static void split_data_scalar(const uint32_t *buf, const size_t &size, float *out)
+{
+    for(size_t i = 0; i < size; ++i)
+    {
+        uint32_t data = buf[i];
+        out[2*i] = (float)((((data>>16)&0xff)<<8) | (data>>24));
+        out[2*i + 1] = (float)(((data&0xff)<<8) | ((data>>8)&0xff));
+    }
+}
+
+// the position of the third one in three consecutive samples below level
+static size_t find_header_scalar(const float *buf, const size_t &begin,
+                                 const size_t &size, const float &level)
+{
+    for(size_t i = begin; i < size; ++i)
+    {
+        if((buf[i] < level) && (buf[i-1] < level) && (buf[i-2] < level))
+            return i;
+    }
+
+    return size;
+}
+
+#ifdef APV_KERNEL_X86
+
+static inline int horizontal_sum(const __m128i &v)
+{
+    alignas(16) int32_t vals[4];
+    _mm_store_si128((__m128i*) vals, v);
+    return vals[0] + vals[1] + vals[2] + vals[3];
+}
+
+static void zero_sup_sse2(const PRadAPVKernel::Tables &tab,
+                          float *buf,
+                          const size_t &ts_diff,
+                          const size_t &time_samples,
+                          bool *hit_pos)
+{
+    alignas(16) float sel1[N_CH], sel2[N_CH];
+
+    for(size_t ts = 0; ts < time_samples; ++ts)
+    {
+        float *ch = buf + ts*ts_diff;
+        // the masks are -1 for the selected channels, subtract them to count
+        __m128i count1 = _mm_setzero_si128(), count2 = _mm_setzero_si128();
+
+        // pedestal subtraction and the channels selected for common mode
+        for(size_t i = 0; i < N_CH; i += 4)
+        {
+            __m128 val = _mm_sub_ps(_mm_loadu_ps(tab.offset + i), _mm_loadu_ps(ch + i));
+            _mm_storeu_ps(ch + i, val);
+
+            __m128 pass = _mm_cmplt_ps(val, _mm_loadu_ps(tab.cm_thres + i));
+            __m128 grp = _mm_castsi128_ps(_mm_loadu_si128((const __m128i*) (tab.group + i)));
+            __m128 pass1 = _mm_and_ps(grp, pass);
+            __m128 pass2 = _mm_andnot_ps(grp, pass);
+            _mm_store_ps(sel1 + i, _mm_and_ps(pass1, val));
+            _mm_store_ps(sel2 + i, _mm_and_ps(pass2, val));
+            count1 = _mm_sub_epi32(count1, _mm_castps_si128(pass1));
+            count2 = _mm_sub_epi32(count2, _mm_castps_si128(pass2));
+        }
+
+        int n1 = horizontal_sum(count1), n2 = horizontal_sum(count2);
+        float average1 = tab.split ? ordered_sum(sel1) : 0.;
+        float average2 = ordered_sum(sel2);
+        if(n1)
+            average1 /= (float)n1;
+        if(n2)
+            average2 /= (float)n2;
+
+        __m128 ave1 = _mm_set1_ps(average1), ave2 = _mm_set1_ps(average2);
+        for(size_t i = 0; i < N_CH; i += 4)
+        {
+            __m128 grp = _mm_castsi128_ps(_mm_loadu_si128((const __m128i*) (tab.group + i)));
+            __m128 ave = _mm_or_ps(_mm_and_ps(grp, ave1), _mm_andnot_ps(grp, ave2));
+            _mm_storeu_ps(ch + i, _mm_sub_ps(_mm_loadu_ps(ch + i), ave));
+        }
+    }
+
+    // average over time samples and compare with the threshold
+    __m128 nts = _mm_set1_ps((float)time_samples);
+    for(size_t i = 0; i < N_CH; i += 4)
+    {
+        __m128 average = _mm_setzero_ps();
+        for(size_t j = 0; j < time_samples; ++j)
+        {
+            average = _mm_add_ps(average, _mm_loadu_ps(buf + i + j*ts_diff));
+        }
+        average = _mm_div_ps(average, nts);
+
+        int hits = _mm_movemask_ps(_mm_cmpgt_ps(average, _mm_loadu_ps(tab.zs_thres + i)));
+        for(size_t k = 0; k < 4; ++k)
+            hit_pos[i + k] = (hits >> k) & 1;
+    }
+}
+
+__attribute__((target("avx2")))
+static void zero_sup_avx2(const PRadAPVKernel::Tables &tab,
+                          float *buf,
+                          const size_t &ts_diff,
+                          const size_t &time_samples,
+                          bool *hit_pos)
+{
+    alignas(32) float sel1[N_CH], sel2[N_CH];
+
+    for(size_t ts = 0; ts < time_samples; ++ts)
+    {
+        float *ch = buf + ts*ts_diff;
+        // the masks are -1 for the selected channels, subtract them to count
+        __m256i count1 = _mm256_setzero_si256(), count2 = _mm256_setzero_si256();
+
+        // pedestal subtraction and the channels selected for common mode
+        for(size_t i = 0; i < N_CH; i += 8)
+        {
+            __m256 val = _mm256_sub_ps(_mm256_loadu_ps(tab.offset + i), _mm256_loadu_ps(ch + i));
+            _mm256_storeu_ps(ch + i, val);
+
+            __m256 pass = _mm256_cmp_ps(val, _mm256_loadu_ps(tab.cm_thres + i), _CMP_LT_OQ);
+            __m256 grp = _mm256_castsi256_ps(_mm256_loadu_si256((const __m256i*) (tab.group + i)));
+            __m256 pass1 = _mm256_and_ps(grp, pass);
+            __m256 pass2 = _mm256_andnot_ps(grp, pass);
+            _mm256_store_ps(sel1 + i, _mm256_and_ps(pass1, val));
+            _mm256_store_ps(sel2 + i, _mm256_and_ps(pass2, val));
+            count1 = _mm256_sub_epi32(count1, _mm256_castps_si256(pass1));
+            count2 = _mm256_sub_epi32(count2, _mm256_castps_si256(pass2));
+        }
+
+        int n1 = horizontal_sum(_mm_add_epi32(_mm256_castsi256_si128(count1),
+                                              _mm256_extracti128_si256(count1, 1)));
+        int n2 = horizontal_sum(_mm_add_epi32(_mm256_castsi256_si128(count2),
+                                              _mm256_extracti128_si256(count2, 1)));
+        float average1 = tab.split ? ordered_sum(sel1) : 0.;
+        float average2 = ordered_sum(sel2);
+        if(n1)
+            average1 /= (float)n1;
+        if(n2)
+            average2 /= (float)n2;
+
+        __m256 ave1 = _mm256_set1_ps(average1), ave2 = _mm256_set1_ps(average2);
+        for(size_t i = 0; i < N_CH; i += 8)
+        {
+            __m256 grp = _mm256_castsi256_ps(_mm256_loadu_si256((const __m256i*) (tab.group + i)));
+            __m256 ave = _mm256_blendv_ps(ave2, ave1, grp);
+            _mm256_storeu_ps(ch + i, _mm256_sub_ps(_mm256_loadu_ps(ch + i), ave));
+        }
+    }
+
+    // average over time samples and compare with the threshold
+    __m256 nts = _mm256_set1_ps((float)time_samples);
+    for(size_t i = 0; i < N_CH; i += 8)
+    {
+        __m256 average = _mm256_setzero_ps();
+        for(size_t j = 0; j < time_samples; ++j)
+        {
+            average = _mm256_add_ps(average, _mm256_loadu_ps(buf + i + j*ts_diff));
+        }
+        average = _mm256_div_ps(average, nts);
+
+        int hits = _mm256_movemask_ps(_mm256_cmp_ps(average, _mm256_loadu_ps(tab.zs_thres + i), _CMP_GT_OQ));
+        for(size_t k = 0; k < 8; ++k)
+            hit_pos[i + k] = (hits >> k) & 1;
+    }
+}
+
+// the two samples in a word are byte swapped 32 bit words, swap the bytes in
+// each 16 bit word and then the two 16 bit words
+static void split_data_sse2(const uint32_t *buf, const size_t &size, float *out)
+{
+    const __m128i zero = _mm_setzero_si128();
+    size_t i = 0;
+    for(; i + 4 <= size; i += 4)
+    {
+        __m128i data = _mm_loadu_si128((const __m128i*) (buf + i));
+        data = _mm_or_si128(_mm_slli_epi16(data, 8), _mm_srli_epi16(data, 8));
+        data = _mm_shufflelo_epi16(data, _MM_SHUFFLE(2, 3, 0, 1));
+        data = _mm_shufflehi_epi16(data, _MM_SHUFFLE(2, 3, 0, 1));
+        _mm_storeu_ps(out + 2*i, _mm_cvtepi32_ps(_mm_unpacklo_epi16(data, zero)));
+        _mm_storeu_ps(out + 2*i + 4, _mm_cvtepi32_ps(_mm_unpackhi_epi16(data, zero)));
+    }
+
+    split_data_scalar(buf + i, size - i, out + 2*i);
+}
+
+static size_t find_header_sse2(const float *buf, const size_t &size, const float &level)
+{
+    const __m128 lv = _mm_set1_ps(level);
+    size_t i = 2;
+    for(; i + 4 <= size; i += 4)
+    {
+        __m128 below = _mm_and_ps(_mm_cmplt_ps(_mm_loadu_ps(buf + i), lv),
+                                  _mm_cmplt_ps(_mm_loadu_ps(buf + i - 1), lv));
+        below = _mm_and_ps(below, _mm_cmplt_ps(_mm_loadu_ps(buf + i - 2), lv));
+        int mask = _mm_movemask_ps(below);
+        if(mask)
+            return i + __builtin_ctz(mask);
+    }
+
+    return find_header_scalar(buf, i, size, level);
+}
+
+__attribute__((target("avx2")))
+static void split_data_avx2(const uint32_t *buf, const size_t &size, float *out)
+{
+    // reverse the bytes in each 32 bit word
+    const __m256i swap = _mm256_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12,
+                                          3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+    size_t i = 0;
+    for(; i + 8 <= size; i += 8)
+    {
+        __m256i data = _mm256_loadu_si256((const __m256i*) (buf + i));
+        data = _mm256_shuffle_epi8(data, swap);
+        __m256i lo = _mm256_cvtepu16_epi32(_mm256_castsi256_si128(data));
+        __m256i hi = _mm256_cvtepu16_epi32(_mm256_extracti128_si256(data, 1));
+        _mm256_storeu_ps(out + 2*i, _mm256_cvtepi32_ps(lo));
+        _mm256_storeu_ps(out + 2*i + 8, _mm256_cvtepi32_ps(hi));
+    }
+
+    // avoid the AVX-SSE transition penalty in the scalar code
+    _mm256_zeroupper();
+    split_data_scalar(buf + i, size - i, out + 2*i);
+}
+
+__attribute__((target("avx2")))
+static size_t find_header_avx2(const float *buf, const size_t &size, const float &level)
+{
+    const __m256 lv = _mm256_set1_ps(level);
+    size_t i = 2;
+    for(; i + 8 <= size; i += 8)
+    {
+        __m256 below = _mm256_and_ps(_mm256_cmp_ps(_mm256_loadu_ps(buf + i), lv, _CMP_LT_OQ),
+                                     _mm256_cmp_ps(_mm256_loadu_ps(buf + i - 1), lv, _CMP_LT_OQ));
+        below = _mm256_and_ps(below, _mm256_cmp_ps(_mm256_loadu_ps(buf + i - 2), lv, _CMP_LT_OQ));
+        int mask = _mm256_movemask_ps(below);
+        if(mask)
+            return i + __builtin_ctz(mask);
+    }
+
+    _mm256_zeroupper();
+    return find_header_scalar(buf, i, size, level);
+}
+
+#endif
+
+// unpack the raw words to samples, out needs to have 2*size samples
+void PRadAPVKernel::SplitData(const uint32_t *buf, const size_t &size, float *out)
+{
+    switch(level)
+    {
+#ifdef APV_KERNEL_X86
+    case AVX2:
+        split_data_avx2(buf, size, out);
+        break;
+    case SSE2:
+        split_data_sse2(buf, size, out);
+        break;
+#endif
+    default:
+        split_data_scalar(buf, size, out);
+        break;
+    }
+}
+
+// find the first position that it and the two samples before it are all below
+// the threshold, return size if not found
+size_t PRadAPVKernel::FindHeader(const float *buf, const size_t &size, const float &thres)
+{
+    switch(level)
+    {
+#ifdef APV_KERNEL_X86
+    case AVX2:
+        return find_header_avx2(buf, size, thres);
+    case SSE2:
+        return find_header_sse2(buf, size, thres);
+#endif
+    default:
+        return find_header_scalar(buf, 2, size, thres);
+    }
+}
+
+// buf points to the first time sample, the time samples are ts_diff apart,
+// the channels are pedestal subtracted and common mode corrected in place,
+// and hit_pos is set for the channels above the zero suppression threshold
+void PRadAPVKernel::ZeroSuppression(const Tables &tables,
+                                    float *buf,
+                                    const size_t &ts_diff,
+                                    const size_t &time_samples,
+                                    bool *hit_pos)
+{
+    switch(level)
+    {
+#ifdef APV_KERNEL_X86
+    case AVX2:
+        zero_sup_avx2(tables, buf, ts_diff, time_samples, hit_pos);
+        break;
+    case SSE2:
+        zero_sup_sse2(tables, buf, ts_diff, time_samples, hit_pos);
+        break;
+#endif
+    default:
+        zero_sup_scalar(tables, buf, ts_diff, time_samples, hit_pos);
+        break;
+    }
+}
+
+// the best level supported by the cpu
+PRadAPVKernel::Level PRadAPVKernel::GetBestLevel()
+{
+#ifdef APV_KERNEL_X86
+    // it may be called before the cpu info is initialized by the runtime
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx2"))
+        return AVX2;
+    if(__builtin_cpu_supports("sse2"))
+        return SSE2;
+#endif
+    return Scalar;
+}
+
+// change the level, it cannot go beyond the best level the cpu supports
+void PRadAPVKernel::SetLevel(const Level &l)
+{
+    Level best = GetBestLevel();
+    level = (l > best || l < Scalar) ? best : l;
+}
+
+const char *PRadAPVKernel::GetLevelName(const Level &l)
+{
+    switch(l)
+    {
+    case Scalar: return "Scalar";
+    case SSE2: return "SSE2";
+    case AVX2: return "AVX2";
+    default: return "Unknown";
+    }
+}
@@ -12,13 +12,29 @@
 #include "PRadDAQUnit.h"
 #include "PRadGEMSystem.h"
 
-#define DST_FILE_VERSION 0x13  // 0xff
+#ifdef USE_ZLIB
+#include <zlib.h>
+#endif
+
+#define DST_BLOCK_SIZE 4*1024*1024 // bytes in one write block
+#define DST_CHUNK_EVENTS 2000 // events in one chunk for version 2
+#define DST_ZLIB_LEVEL 1
 
 using namespace std;
 
 PRadDSTParser::PRadDSTParser(PRadDataHandler *h)
-: handler(h), input_length(0), type(PRad_DST_Undefined), update_mode(0)
+: handler(h), input_length(0), input_version(DST_FILE_VERSION), data_end(0), chunk_end(0),
+  in_stream(&dst_in), chunk_length(0), type(PRad_DST_Undefined), update_mode(0),
+  read_mask(DST_READ_ALL), col_events(0), col_index(0),
+  output_version(DST_FILE_VERSION_V2), codec(DST_Codec_Zlib),
+  columnar(false), out_columnar(false),
+  bytes_written(0), events_written(0)
+#ifdef MULTI_THREAD
+  , flush_pending(false), flush_stop(false)
+#endif
 {
+    out_buf.reserve(DST_BLOCK_SIZE + DST_BLOCK_SIZE/4);
+    SetCodec(codec);
 }
 
 PRadDSTParser::~PRadDSTParser()
@@ -27,8 +43,36 @@ PRadDSTParser::~PRadDSTParser()
     CloseOutput();
 }
 
+// output format version, 1 is the plain record stream,
+// 2 is the chunked format with compression and footer index
+void PRadDSTParser::SetOutputVersion(const int &v)
+{
+    output_version = (v == 1) ? DST_FILE_VERSION : DST_FILE_VERSION_V2;
+}
+
+// save the event banks in separated column blocks in each chunk, so they can
+// be read selectively, it only affects version 2 output
+void PRadDSTParser::SetColumnar(const bool &c)
+{
+    columnar = c;
+}
+
+// compression of the chunks, it only affects version 2 output
+void PRadDSTParser::SetCodec(const PRadDSTCodec &c)
+{
+    codec = c;
+
+#ifndef USE_ZLIB
+    if(codec == DST_Codec_Zlib) {
+        codec = DST_Codec_None;
+    }
+#endif
+}
+
 void PRadDSTParser::OpenOutput(const string &path, ios::openmode mode)
 {
+    CloseOutput();
+
     dst_out.open(path, mode);
 
     if(!dst_out.is_open()) {
@@ -37,17 +81,360 @@ void PRadDSTParser::OpenOutput(const string &path, ios::openmode mode)
         return;
     }
 
-    uint32_t version_info = (PRad_DST_Header << 8) | DST_FILE_VERSION;
+    out_columnar = columnar && (output_version != DST_FILE_VERSION);
+    uint32_t version = out_columnar ? DST_FILE_VERSION_COL : output_version;
+    uint32_t version_info = (PRad_DST_Header << 8) | version;
     dst_out.write((char*) &version_info, sizeof(version_info));
+
+    bytes_written = sizeof(version_info);
+    events_written = 0;
+    out_buf.clear();
+    out_cols.clear();
+    for(auto &col : col_buf)
+        col.clear();
+    out_chunk = ChunkInfo();
+    chunk_index.clear();
+
+#ifdef MULTI_THREAD
+    flush_pending = false;
+    flush_stop = false;
+    flush_thread = thread(&PRadDSTParser::flushLoop, this);
+#endif
 }
 
 void PRadDSTParser::CloseOutput()
 {
+    if(!dst_out.is_open())
+        return;
+
+    FlushOutput();
+
+#ifdef MULTI_THREAD
+    flush_lock.lock();
+    flush_stop = true;
+    flush_lock.unlock();
+    flush_cond.notify_all();
+
+    if(flush_thread.joinable())
+        flush_thread.join();
+#endif
+
+    if(output_version != DST_FILE_VERSION)
+        writeFooter();
+
     dst_out.close();
 }
 
+// write all the buffered data to the file, and wait until it is done
+void PRadDSTParser::FlushOutput()
+{
+    submitBuffer();
+
+#ifdef MULTI_THREAD
+    unique_lock<mutex> lock(flush_lock);
+    flush_cond.wait(lock, [this] {return !flush_pending;});
+#endif
+
+    dst_out.flush();
+}
+
+// a record is finished in the buffer, the buffer is handed to the flush
+// thread once it is full, so the caller does not wait for the disk
+// for version 2, a full buffer is one chunk
+void PRadDSTParser::saveRecord(const PRadDSTInfo &rec_type, const int &ev)
+{
+    if(rec_type == PRad_DST_Event || rec_type == PRad_DST_Epics) {
+        if(out_chunk.records == 0 || ev < out_chunk.first_event)
+            out_chunk.first_event = ev;
+        if(out_chunk.records == 0 || ev > out_chunk.last_event)
+            out_chunk.last_event = ev;
+    }
+    if(rec_type == PRad_DST_Event) {
+        ++out_chunk.events;
+        ++events_written;
+    }
+    out_chunk.records++;
+    out_chunk.type_mask |= 1 << rec_type;
+
+    size_t buf_size = out_buf.size();
+    for(auto &col : col_buf)
+        buf_size += col.size();
+
+    if(buf_size >= DST_BLOCK_SIZE ||
+       (output_version != DST_FILE_VERSION && out_chunk.events >= DST_CHUNK_EVENTS))
+        submitBuffer();
+}
+
+// save the event into column blocks
+void PRadDSTParser::saveColumns(const EventData &data)
+{
+    // row records go to their own chunk
+    if(!out_buf.empty())
+        submitBuffer();
+
+    uint32_t adc_size = data.adc_data.size();
+    uint32_t tdc_size = data.tdc_data.size();
+    uint32_t gem_size = data.gem_data.size();
+    uint32_t dsc_size = data.dsc_data.size();
+
+    vector<char> &header = col_buf[DST_Column_Header];
+    saveData(header, data.event_number);
+    saveData(header, data.type);
+    saveData(header, data.trigger);
+    saveData(header, data.timestamp);
+    saveData(header, adc_size);
+    saveData(header, tdc_size);
+    saveData(header, gem_size);
+    saveData(header, dsc_size);
+
+    saveArray(col_buf[DST_Column_ADC], data.adc_data.data(), adc_size);
+    saveArray(col_buf[DST_Column_TDC], data.tdc_data.data(), tdc_size);
+    for(auto &gem : data.gem_data)
+    {
+        uint32_t hit_size = gem.values.size();
+        saveData(col_buf[DST_Column_GEM], gem.addr);
+        saveData(col_buf[DST_Column_GEM], hit_size);
+        saveArray(col_buf[DST_Column_GEM], gem.values.data(), hit_size);
+    }
+    saveArray(col_buf[DST_Column_DSC], data.dsc_data.data(), dsc_size);
+
+    saveRecord(PRad_DST_Event, data.event_number);
+}
+
+// the pending column data should be written before a row record
+void PRadDSTParser::beginRowRecord()
+{
+    if(!col_buf[DST_Column_Header].empty())
+        submitBuffer();
+}
+
+void PRadDSTParser::submitBuffer()
+{
+    // pack the column blocks, out_buf is empty when there are column data
+    if(!col_buf[DST_Column_Header].empty()) {
+        out_cols.resize(DST_Column_Size);
+        for(int i = 0; i < DST_Column_Size; ++i)
+        {
+            out_cols[i] = col_buf[i].size();
+            out_buf.insert(out_buf.end(), col_buf[i].begin(), col_buf[i].end());
+            col_buf[i].clear();
+        }
+    }
+
+    if(out_buf.empty())
+        return;
+
+#ifdef MULTI_THREAD
+    unique_lock<mutex> lock(flush_lock);
+    // the flush thread is still writing the other block
+    flush_cond.wait(lock, [this] {return !flush_pending;});
+
+    out_buf.swap(flush_buf);
+    out_cols.swap(flush_cols);
+    flush_chunk = out_chunk;
+    flush_pending = true;
+    lock.unlock();
+    flush_cond.notify_all();
+#else
+    writeBlock(out_buf, out_chunk, out_cols);
+#endif
+
+    out_buf.clear();
+    out_cols.clear();
+    out_chunk = ChunkInfo();
+}
+
+#ifdef MULTI_THREAD
+void PRadDSTParser::flushLoop()
+{
+    unique_lock<mutex> lock(flush_lock);
+
+    while(true)
+    {
+        flush_cond.wait(lock, [this] {return flush_pending || flush_stop;});
+
+        if(!flush_pending)
+            return; // stopped
+
+        // the block belongs to this thread until flush_pending is reset
+        lock.unlock();
+        writeBlock(flush_buf, flush_chunk, flush_cols);
+        lock.lock();
+
+        flush_pending = false;
+        flush_cond.notify_all();
+    }
+}
+#endif
+
+// write a block of records to file, version 2 writes it as a chunk
+// cols are the sizes of column blocks, it is empty for row records
+void PRadDSTParser::writeBlock(const vector<char> &buf, ChunkInfo &chunk, const vector<uint32_t> &cols)
+{
+    if(output_version == DST_FILE_VERSION) {
+        dst_out.write(buf.data(), buf.size());
+        bytes_written += buf.size();
+        return;
+    }
+
+    if(!cols.empty()) {
+        writeColumnChunk(buf, chunk, cols);
+        return;
+    }
+
+    chunk.offset = dst_out.tellp();
+
+    PRadDSTCodec chunk_codec = codec;
+    if(!compressChunk(chunk_codec, buf, comp_buf) || comp_buf.size() >= buf.size())
+        chunk_codec = DST_Codec_None;
+
+    const vector<char> &data = (chunk_codec == DST_Codec_None) ? buf : comp_buf;
+
+    uint32_t chunk_info = ((uint32_t)PRad_DST_ChunkHeader << 8) | chunk_codec;
+    uint32_t raw_size = buf.size(), data_size = data.size();
+
+    dst_out.write((char*) &chunk_info, sizeof(chunk_info));
+    dst_out.write((char*) &raw_size, sizeof(raw_size));
+    dst_out.write((char*) &data_size, sizeof(data_size));
+    dst_out.write((char*) &chunk.records, sizeof(chunk.records));
+    dst_out.write((char*) &chunk.first_event, sizeof(chunk.first_event));
+    dst_out.write((char*) &chunk.last_event, sizeof(chunk.last_event));
+    dst_out.write(data.data(), data.size());
+
+    bytes_written += 6*sizeof(uint32_t) + data.size();
+    chunk_index.push_back(chunk);
+}
+
+// column chunk, each column block is compressed separately so the reader
+// can skip the unrequested columns
+void PRadDSTParser::writeColumnChunk(const vector<char> &buf, ChunkInfo &chunk, const vector<uint32_t> &cols)
+{
+    chunk.offset = dst_out.tellp();
+
+    vector<uint32_t> raw_sizes, data_sizes;
+    vector<char> col_data, col_comp;
+    size_t pos = 0;
+    comp_buf.clear();
+
+    for(auto &size : cols)
+    {
+        col_data.assign(buf.begin() + pos, buf.begin() + pos + size);
+        pos += size;
+
+        raw_sizes.push_back(size);
+        if(compressChunk(codec, col_data, col_comp) && col_comp.size() < size) {
+            comp_buf.insert(comp_buf.end(), col_comp.begin(), col_comp.end());
+            data_sizes.push_back(col_comp.size());
+        } else {
+            // uncompressed column has the same raw size and data size
+            comp_buf.insert(comp_buf.end(), col_data.begin(), col_data.end());
+            data_sizes.push_back(size);
+        }
+    }
+
+    uint32_t chunk_info = ((uint32_t)PRad_DST_ColumnChunk << 8) | codec;
+    uint32_t n_cols = cols.size();
+
+    dst_out.write((char*) &chunk_info, sizeof(chunk_info));
+    dst_out.write((char*) &n_cols, sizeof(n_cols));
+    dst_out.write((char*) &chunk.events, sizeof(chunk.events));
+    dst_out.write((char*) &chunk.first_event, sizeof(chunk.first_event));
+    dst_out.write((char*) &chunk.last_event, sizeof(chunk.last_event));
+    for(uint32_t i = 0; i < n_cols; ++i)
+    {
+        dst_out.write((char*) &raw_sizes[i], sizeof(raw_sizes[i]));
+        dst_out.write((char*) &data_sizes[i], sizeof(data_sizes[i]));
+    }
+    dst_out.write(comp_buf.data(), comp_buf.size());
+
+    bytes_written += (5 + 2*n_cols)*sizeof(uint32_t) + comp_buf.size();
+    comp_buf.clear();
+    chunk_index.push_back(chunk);
+}
+
+// the footer indexes all the chunks, the last 12 bytes of the file are the
+// footer position and a tail word, so it can be found from the file end
+void PRadDSTParser::writeFooter()
+{
+    uint64_t footer_pos = dst_out.tellp();
+
+    uint32_t footer_info = ((uint32_t)PRad_DST_Footer << 8) | 0;
+    uint32_t size = chunk_index.size();
+    dst_out.write((char*) &footer_info, sizeof(footer_info));
+    dst_out.write((char*) &size, sizeof(size));
+
+    for(auto &chunk : chunk_index)
+    {
+        dst_out.write((char*) &chunk.offset, sizeof(chunk.offset));
+        dst_out.write((char*) &chunk.first_event, sizeof(chunk.first_event));
+        dst_out.write((char*) &chunk.last_event, sizeof(chunk.last_event));
+        dst_out.write((char*) &chunk.events, sizeof(chunk.events));
+        dst_out.write((char*) &chunk.records, sizeof(chunk.records));
+        dst_out.write((char*) &chunk.type_mask, sizeof(chunk.type_mask));
+    }
+
+    uint32_t tail_info = ((uint32_t)PRad_DST_Footer << 8) | 0xff;
+    dst_out.write((char*) &footer_pos, sizeof(footer_pos));
+    dst_out.write((char*) &tail_info, sizeof(tail_info));
+
+    bytes_written = dst_out.tellp();
+}
+
+// compress a chunk with the codec, return false if it is not compressed
+bool PRadDSTParser::compressChunk(const PRadDSTCodec &c, const vector<char> &in, vector<char> &out)
+{
+    switch(c)
+    {
+#ifdef USE_ZLIB
+    case DST_Codec_Zlib:
+    {
+        uLongf size = compressBound(in.size());
+        out.resize(size);
+        if(compress2((Bytef*) out.data(), &size, (const Bytef*) in.data(), in.size(), DST_ZLIB_LEVEL) != Z_OK)
+            return false;
+        out.resize(size);
+        return true;
+    }
+#endif
+    default:
+        return false;
+    }
+}
+
+// decompress data to out, which should have the raw size
+// it is shared with the memory mapped reader
+void PRadDSTParser::DecompressChunk(const PRadDSTCodec &c,
+                                    const char *in, const size_t &in_size,
+                                    char *out, const size_t &size)
+throw(PRadException)
+{
+    // data are not compressed if the size does not change
+    if(in_size == size) {
+        copy(in, in + in_size, out);
+        return;
+    }
+
+    switch(c)
+    {
+#ifdef USE_ZLIB
+    case DST_Codec_Zlib:
+    {
+        uLongf out_size = size;
+        if(uncompress((Bytef*) out, &out_size, (const Bytef*) in, in_size) != Z_OK
+           || out_size != size)
+            throw PRadException("READ DST", "failed to decompress chunk");
+        return;
+    }
+#endif
+    default:
+        throw PRadException("READ DST", "unsupported compression codec " + to_string((int)c));
+    }
+}
+
 void PRadDSTParser::OpenInput(const string &path, ios::openmode mode)
 {
+    CloseInput();
+
     dst_in.open(path, mode);
 
     if(!dst_in.is_open()) {
@@ -69,11 +456,27 @@ void PRadDSTParser::OpenInput(const string &path, ios::openmode mode)
         CloseInput();
         return;
     }
-    if((version_info & 0xff) != DST_FILE_VERSION) {
+
+    input_version = version_info & 0xff;
+
+    switch(input_version)
+    {
+    case DST_FILE_VERSION:
+        in_stream = &dst_in;
+        data_end = input_length;
+        break;
+    case DST_FILE_VERSION_V2:
+    case DST_FILE_VERSION_COL:
+        in_stream = &chunk_stream;
+        readFooter();
+        break;
+    default:
         cerr << "DST Parser: Version mismatch between the file and library. "
              << endl
              << "Expected version " << (DST_FILE_VERSION >> 4)
              << "." << (DST_FILE_VERSION & 0xf)
+             << " or " << (DST_FILE_VERSION_V2 >> 4)
+             << "." << (DST_FILE_VERSION_V2 & 0xf)
              << ", but the file version is "
              << ((version_info >> 4) & 0xf)
              << "." << (version_info & 0xf)
@@ -87,6 +490,252 @@ void PRadDSTParser::OpenInput(const string &path, ios::openmode mode)
 void PRadDSTParser::CloseInput()
 {
     dst_in.close();
+    dst_in.clear();
+    chunk_stream.str("");
+    chunk_stream.clear();
+    chunk_length = 0;
+    clearColumns();
+    in_stream = &dst_in;
+    chunk_index.clear();
+}
+
+void PRadDSTParser::clearColumns()
+{
+    for(int i = 0; i < DST_Column_Size; ++i)
+    {
+        col_in[i].clear();
+        col_pos[i] = 0;
+    }
+    col_events = 0;
+    col_index = 0;
+}
+
+// read the chunk index from the footer, a file that was not closed properly
+// does not have the footer, it can still be read sequentially
+void PRadDSTParser::readFooter()
+{
+    chunk_index.clear();
+    data_end = input_length;
+
+    uint64_t footer_pos = 0;
+    uint32_t tail_info = 0, footer_info = 0, size = 0;
+    int64_t tail_pos = input_length - sizeof(footer_pos) - sizeof(tail_info);
+
+    if(tail_pos > 0) {
+        dst_in.seekg(tail_pos);
+        dst_in.read((char*) &footer_pos, sizeof(footer_pos));
+        dst_in.read((char*) &tail_info, sizeof(tail_info));
+    }
+
+    if(tail_info == (((uint32_t)PRad_DST_Footer << 8) | 0xff) && (int64_t)footer_pos < tail_pos) {
+        dst_in.seekg(footer_pos);
+        dst_in.read((char*) &footer_info, sizeof(footer_info));
+        dst_in.read((char*) &size, sizeof(size));
+    }
+
+    if(footer_info == (((uint32_t)PRad_DST_Footer << 8) | 0)) {
+        chunk_index.resize(size);
+        for(auto &chunk : chunk_index)
+        {
+            dst_in.read((char*) &chunk.offset, sizeof(chunk.offset));
+            dst_in.read((char*) &chunk.first_event, sizeof(chunk.first_event));
+            dst_in.read((char*) &chunk.last_event, sizeof(chunk.last_event));
+            dst_in.read((char*) &chunk.events, sizeof(chunk.events));
+            dst_in.read((char*) &chunk.records, sizeof(chunk.records));
+            dst_in.read((char*) &chunk.type_mask, sizeof(chunk.type_mask));
+        }
+        data_end = footer_pos;
+    } else {
+        cerr << "DST Parser: Cannot find the footer index, "
+             << "the file will only be read sequentially." << endl;
+    }
+
+    chunk_end = data_end;
+
+    dst_in.clear();
+    dst_in.seekg(sizeof(uint32_t), dst_in.beg);
+}
+
+// read the next chunk into memory
+bool PRadDSTParser::readChunk() throw(PRadException)
+{
+    if(dst_in.tellg() >= data_end || dst_in.tellg() == -1)
+        return false;
+
+    uint32_t chunk_info, raw_size, data_size, records;
+    int first_event, last_event;
+    dst_in.read((char*) &chunk_info, sizeof(chunk_info));
+
+    // reached the footer
+    if((chunk_info >> 8) == PRad_DST_Footer)
+        return false;
+
+    if((chunk_info >> 8) == PRad_DST_ColumnChunk) {
+        readColumnChunk((PRadDSTCodec)(chunk_info & 0xff));
+        return true;
+    }
+
+    if((chunk_info >> 8) != PRad_DST_ChunkHeader)
+        throw PRadException("READ DST", "unrecognized chunk header, probably corrupted file");
+
+    dst_in.read((char*) &raw_size, sizeof(raw_size));
+    dst_in.read((char*) &data_size, sizeof(data_size));
+    dst_in.read((char*) &records, sizeof(records));
+    dst_in.read((char*) &first_event, sizeof(first_event));
+    dst_in.read((char*) &last_event, sizeof(last_event));
+
+    comp_buf.resize(data_size);
+    dst_in.read(comp_buf.data(), data_size);
+
+    if(!dst_in.good())
+        throw PRadException("READ DST", "incomplete chunk, probably corrupted file");
+
+    string chunk_data(raw_size, '\0');
+    DecompressChunk((PRadDSTCodec)(chunk_info & 0xff), comp_buf.data(), comp_buf.size(), &chunk_data[0], raw_size);
+
+    chunk_stream.str(chunk_data);
+    chunk_stream.clear();
+    chunk_length = raw_size;
+
+    return true;
+}
+
+// read a column chunk, only the header column and the columns required by
+// the read mask are decompressed, the others are skipped
+void PRadDSTParser::readColumnChunk(const PRadDSTCodec &chunk_codec) throw(PRadException)
+{
+    uint32_t n_cols, events;
+    int first_event, last_event;
+    dst_in.read((char*) &n_cols, sizeof(n_cols));
+    dst_in.read((char*) &events, sizeof(events));
+    dst_in.read((char*) &first_event, sizeof(first_event));
+    dst_in.read((char*) &last_event, sizeof(last_event));
+
+    if(!dst_in.good() || n_cols != DST_Column_Size)
+        throw PRadException("READ DST", "unrecognized column chunk, probably corrupted file");
+
+    uint32_t raw_sizes[DST_Column_Size], data_sizes[DST_Column_Size];
+    for(int i = 0; i < DST_Column_Size; ++i)
+    {
+        dst_in.read((char*) &raw_sizes[i], sizeof(raw_sizes[i]));
+        dst_in.read((char*) &data_sizes[i], sizeof(data_sizes[i]));
+    }
+
+    const uint32_t required[DST_Column_Size] = {DST_READ_ALL, DST_READ_ADC, DST_READ_TDC,
+                                            DST_READ_GEM, DST_READ_DSC};
+
+    clearColumns();
+    for(int i = 0; i < DST_Column_Size; ++i)
+    {
+        if(!(read_mask & required[i])) {
+            dst_in.seekg(data_sizes[i], ios::cur);
+            continue;
+        }
+
+        comp_buf.resize(data_sizes[i]);
+        dst_in.read(comp_buf.data(), data_sizes[i]);
+        if(!dst_in.good())
+            throw PRadException("READ DST", "incomplete chunk, probably corrupted file");
+
+        col_in[i].resize(raw_sizes[i]);
+        DecompressChunk(chunk_codec, comp_buf.data(), comp_buf.size(), col_in[i].data(), raw_sizes[i]);
+    }
+
+    col_events = events;
+
+    // no row records in this chunk
+    chunk_stream.str("");
+    chunk_stream.clear();
+    chunk_length = 0;
+}
+
+// check if there is more record to read
+bool PRadDSTParser::hasRecord() throw(PRadException)
+{
+    if(input_version == DST_FILE_VERSION)
+        return dst_in.tellg() < data_end && dst_in.tellg() != -1;
+
+    while(col_index >= col_events &&
+          (chunk_stream.tellg() == -1 || chunk_stream.tellg() >= chunk_length))
+    {
+        if(!readChunk())
+            return false;
+    }
+
+    return true;
+}
+
+// move the reading position to the beginning of a chunk
+bool PRadDSTParser::SeekChunk(const size_t &idx)
+{
+    if(input_version == DST_FILE_VERSION || idx >= chunk_index.size())
+        return false;
+
+    dst_in.clear();
+    dst_in.seekg(chunk_index[idx].offset);
+    chunk_stream.str("");
+    chunk_stream.clear();
+    chunk_length = 0;
+    clearColumns();
+    data_end = chunk_end;
+
+    return true;
+}
+
+// only read the chunks from first to end (not included)
+bool PRadDSTParser::SeekRange(const size_t &first, const size_t &end)
+{
+    if(first >= end || !SeekChunk(first))
+        return false;
+
+    if(end < chunk_index.size())
+        data_end = chunk_index[end].offset;
+
+    return true;
+}
+
+// only read the records between two file positions, the position should be
+// the beginning of a record or chunk, it also works for the file that is
+// still being written and does not have the footer index
+bool PRadDSTParser::SeekPosition(const uint64_t &begin, const uint64_t &end)
+{
+    if(!dst_in.is_open() || begin >= end)
+        return false;
+
+    dst_in.clear();
+    dst_in.seekg(begin);
+    chunk_stream.str("");
+    chunk_stream.clear();
+    chunk_length = 0;
+    clearColumns();
+    data_end = end;
+
+    return true;
+}
+
+// find the chunk that contains the event number, return -1 if not found
+int PRadDSTParser::FindChunk(const int &ev) const
+{
+    for(size_t i = 0; i < chunk_index.size(); ++i)
+    {
+        if(ev >= chunk_index[i].first_event && ev <= chunk_index[i].last_event)
+            return i;
+    }
+
+    return -1;
+}
+
+// find the next chunk from start that has the record type
+// return -1 if not found
+int PRadDSTParser::FindChunk(const PRadDSTInfo &rec_type, const size_t &start) const
+{
+    for(size_t i = start; i < chunk_index.size(); ++i)
+    {
+        if(chunk_index[i].type_mask & (1 << rec_type))
+            return i;
+    }
+
+    return -1;
 }
 
 void PRadDSTParser::WriteEvent(const EventData &data) throw(PRadException)
@@ -94,15 +743,20 @@ void PRadDSTParser::WriteEvent(const EventData &data) throw(PRadException)
     if(!dst_out.is_open())
         throw PRadException("WRITE DST", "output file is not opened!");
 
+    if(out_columnar) {
+        saveColumns(data);
+        return;
+    }
+
     // write header
     uint32_t event_info = (PRad_DST_EvHeader << 8) | PRad_DST_Event;
-    dst_out.write((char*) &event_info, sizeof(event_info));
+    saveData(event_info);
 
     // event information
-    dst_out.write((char*) &data.event_number, sizeof(data.event_number));
-    dst_out.write((char*) &data.type        , sizeof(data.type));
-    dst_out.write((char*) &data.trigger     , sizeof(data.trigger));
-    dst_out.write((char*) &data.timestamp   , sizeof(data.timestamp));
+    saveData(data.event_number);
+    saveData(data.type);
+    saveData(data.trigger);
+    saveData(data.timestamp);
 
     // all data banks
     uint32_t adc_size = data.adc_data.size();
@@ -110,30 +764,28 @@ void PRadDSTParser::WriteEvent(const EventData &data) throw(PRadException)
     uint32_t gem_size = data.gem_data.size();
     uint32_t dsc_size = data.dsc_data.size();
 
-    dst_out.write((char*) &adc_size, sizeof(adc_size));
-    for(auto &adc : data.adc_data)
-        dst_out.write((char*) &adc, sizeof(adc));
+    saveData(adc_size);
+    saveArray(data.adc_data.data(), adc_size);
 
-    dst_out.write((char*) &tdc_size, sizeof(tdc_size));
-    for(auto &tdc : data.tdc_data)
-        dst_out.write((char*) &tdc, sizeof(tdc));
+    saveData(tdc_size);
+    saveArray(data.tdc_data.data(), tdc_size);
 
-    dst_out.write((char*) &gem_size, sizeof(gem_size));
+    saveData(gem_size);
     for(auto &gem : data.gem_data)
     {
-        dst_out.write((char*) &gem.addr, sizeof(gem.addr));
+        saveData(gem.addr);
         uint32_t hit_size = gem.values.size();
-        dst_out.write((char*) &hit_size, sizeof(hit_size));
-        for(auto &value : gem.values)
-            dst_out.write((char*) &value, sizeof(value));
+        saveData(hit_size);
+        saveArray(gem.values.data(), hit_size);
     }
 
-    dst_out.write((char*) &dsc_size, sizeof(dsc_size));
-    for(auto &dsc : data.dsc_data)
-        dst_out.write((char*) &dsc, sizeof(dsc));
+    saveData(dsc_size);
+    saveArray(data.dsc_data.data(), dsc_size);
 
+    saveRecord(PRad_DST_Event, data.event_number);
 }
 
+// the unrequested banks are skipped without being decoded
 void PRadDSTParser::readEvent(EventData &data) throw(PRadException)
 {
     if(!dst_in.is_open())
@@ -142,51 +794,99 @@ void PRadDSTParser::readEvent(EventData &data) throw(PRadException)
     data.clear();
 
     // event information
-    dst_in.read((char*) &data.event_number, sizeof(data.event_number));
-    dst_in.read((char*) &data.type        , sizeof(data.type));
-    dst_in.read((char*) &data.trigger     , sizeof(data.trigger));
-    dst_in.read((char*) &data.timestamp   , sizeof(data.timestamp));
+    in_stream->read((char*) &data.event_number, sizeof(data.event_number));
+    in_stream->read((char*) &data.type        , sizeof(data.type));
+    in_stream->read((char*) &data.trigger     , sizeof(data.trigger));
+    in_stream->read((char*) &data.timestamp   , sizeof(data.timestamp));
 
     uint32_t adc_size, tdc_size, gem_size, value_size, dsc_size;
-    ADC_Data adc;
-    TDC_Data tdc;
-    DSC_Data dsc;
 
-    dst_in.read((char*) &adc_size, sizeof(adc_size));
-    for(uint32_t i = 0; i < adc_size; ++i)
-    {
-        dst_in.read((char*) &adc, sizeof(adc));
-        data.add_adc(adc);
+    in_stream->read((char*) &adc_size, sizeof(adc_size));
+    if(read_mask & DST_READ_ADC) {
+        data.adc_data.resize(adc_size);
+        in_stream->read((char*) data.adc_data.data(), adc_size*sizeof(ADC_Data));
+    } else {
+        in_stream->seekg(adc_size*sizeof(ADC_Data), ios::cur);
     }
 
-    dst_in.read((char*) &tdc_size, sizeof(tdc_size));
-    for(uint32_t i = 0; i < tdc_size; ++i)
-    {
-        dst_in.read((char*) &tdc, sizeof(tdc));
-        data.add_tdc(tdc);
+    in_stream->read((char*) &tdc_size, sizeof(tdc_size));
+    if(read_mask & DST_READ_TDC) {
+        data.tdc_data.resize(tdc_size);
+        in_stream->read((char*) data.tdc_data.data(), tdc_size*sizeof(TDC_Data));
+    } else {
+        in_stream->seekg(tdc_size*sizeof(TDC_Data), ios::cur);
     }
 
-    float value;
-    dst_in.read((char*) &gem_size, sizeof(gem_size));
+    in_stream->read((char*) &gem_size, sizeof(gem_size));
+    if(read_mask & DST_READ_GEM)
+        data.gem_data.resize(gem_size);
     for(uint32_t i = 0; i < gem_size; ++i)
     {
-        GEM_Data gemhit;
-        dst_in.read((char*) &gemhit.addr, sizeof(gemhit.addr));
-        dst_in.read((char*) &value_size, sizeof(value_size));
-        for(uint32_t j = 0; j < value_size; ++j)
+        APVAddress addr;
+        in_stream->read((char*) &addr, sizeof(addr));
+        in_stream->read((char*) &value_size, sizeof(value_size));
+        if(read_mask & DST_READ_GEM) {
+            GEM_Data &gemhit = data.gem_data[i];
+            gemhit.addr = addr;
+            gemhit.values.resize(value_size);
+            in_stream->read((char*) gemhit.values.data(), value_size*sizeof(float));
+        } else {
+            in_stream->seekg(value_size*sizeof(float), ios::cur);
+        }
+    }
+
+    in_stream->read((char*) &dsc_size, sizeof(dsc_size));
+    if(read_mask & DST_READ_DSC) {
+        data.dsc_data.resize(dsc_size);
+        in_stream->read((char*) data.dsc_data.data(), dsc_size*sizeof(DSC_Data));
+    } else {
+        in_stream->seekg(dsc_size*sizeof(DSC_Data), ios::cur);
+    }
+}
+
+// read the next event from the column blocks
+void PRadDSTParser::readColumnEvent(EventData &data) throw(PRadException)
+{
+    data.clear();
+
+    loadData(DST_Column_Header, data.event_number);
+    loadData(DST_Column_Header, data.type);
+    loadData(DST_Column_Header, data.trigger);
+    loadData(DST_Column_Header, data.timestamp);
+
+    uint32_t adc_size, tdc_size, gem_size, value_size, dsc_size;
+    loadData(DST_Column_Header, adc_size);
+    loadData(DST_Column_Header, tdc_size);
+    loadData(DST_Column_Header, gem_size);
+    loadData(DST_Column_Header, dsc_size);
+
+    if(read_mask & DST_READ_ADC) {
+        data.adc_data.resize(adc_size);
+        loadArray(DST_Column_ADC, data.adc_data.data(), adc_size);
+    }
+
+    if(read_mask & DST_READ_TDC) {
+        data.tdc_data.resize(tdc_size);
+        loadArray(DST_Column_TDC, data.tdc_data.data(), tdc_size);
+    }
+
+    if(read_mask & DST_READ_GEM) {
+        data.gem_data.resize(gem_size);
+        for(auto &gemhit : data.gem_data)
         {
-            dst_in.read((char*) &value, sizeof(value));
-            gemhit.add_value(value);
+            loadData(DST_Column_GEM, gemhit.addr);
+            loadData(DST_Column_GEM, value_size);
+            gemhit.values.resize(value_size);
+            loadArray(DST_Column_GEM, gemhit.values.data(), value_size);
         }
-        data.add_gemhit(gemhit);
     }
 
-    dst_in.read((char*) &dsc_size, sizeof(dsc_size));
-    for(uint32_t i = 0; i < dsc_size; ++i)
-    {
-        dst_in.read((char*) &dsc, sizeof(dsc));
-        data.add_dsc(dsc);
+    if(read_mask & DST_READ_DSC) {
+        data.dsc_data.resize(dsc_size);
+        loadArray(DST_Column_DSC, data.dsc_data.data(), dsc_size);
     }
+
+    ++col_index;
 }
 
 void PRadDSTParser::WriteEPICS(const EPICSData &data) throw(PRadException)
@@ -194,17 +894,21 @@ void PRadDSTParser::WriteEPICS(const EPICSData &data) throw(PRadException)
     if(!dst_out.is_open())
         throw PRadException("WRITE DST", "output file is not opened!");
 
+    // pending column data go first to keep the record order
+    beginRowRecord();
+
     // write header
     uint32_t event_info = (PRad_DST_EvHeader << 8) | PRad_DST_Epics;
-    dst_out.write((char*) &event_info, sizeof(event_info));
+    saveData(event_info);
 
-    dst_out.write((char*) &data.event_number, sizeof(data.event_number));
+    saveData(data.event_number);
 
     uint32_t value_size = data.values.size();
-    dst_out.write((char*) &value_size, sizeof(value_size));
+    saveData(value_size);
 
-    for(auto value : data.values)
-        dst_out.write((char*) &value, sizeof(value));
+    saveArray(data.values.data(), value_size);
+
+    saveRecord(PRad_DST_Epics, data.event_number);
 }
 
 void PRadDSTParser::readEPICS(EPICSData &data) throw(PRadException)
@@ -214,15 +918,15 @@ void PRadDSTParser::readEPICS(EPICSData &data) throw(PRadException)
 
     data.clear();
 
-    dst_in.read((char*) &data.event_number, sizeof(data.event_number));
+    in_stream->read((char*) &data.event_number, sizeof(data.event_number));
 
     uint32_t value_size;
-    dst_in.read((char*) &value_size, sizeof(value_size));
+    in_stream->read((char*) &value_size, sizeof(value_size));
 
     for(uint32_t i = 0; i < value_size; ++i)
     {
         float value;
-        dst_in.read((char*) &value, sizeof(value));
+        in_stream->read((char*) &value, sizeof(value));
         data.values.push_back(value);
     }
 }
@@ -232,12 +936,17 @@ void PRadDSTParser::WriteRunInfo() throw(PRadException)
     if(!dst_out.is_open())
         throw PRadException("WRITE DST", "output file is not opened!");
 
+    // pending column data go first to keep the record order
+    beginRowRecord();
+
     // write header
     uint32_t event_info = (PRad_DST_EvHeader << 8) | PRad_DST_Run_Info;
-    dst_out.write((char*) &event_info, sizeof(event_info));
+    saveData(event_info);
 
     auto runInfo = handler->GetRunInfo();
-    dst_out.write((char*) &runInfo, sizeof(runInfo));
+    saveData(runInfo);
+
+    saveRecord(PRad_DST_Run_Info);
 }
 
 void PRadDSTParser::readRunInfo() throw(PRadException)
@@ -247,7 +956,7 @@ void PRadDSTParser::readRunInfo() throw(PRadException)
 
     RunInfo runInfo;
 
-    dst_in.read((char*) &runInfo, sizeof(runInfo));
+    in_stream->read((char*) &runInfo, sizeof(runInfo));
 
     if(!(update_mode & NO_RUN_INFO_UPDATE))
         handler->UpdateRunInfo(runInfo);
@@ -258,24 +967,29 @@ void PRadDSTParser::WriteEPICSMap() throw(PRadException)
     if(!dst_out.is_open())
         throw PRadException("WRITE DST", "output file is not opened!");
 
+    // pending column data go first to keep the record order
+    beginRowRecord();
+
     // write header
     uint32_t event_info = (PRad_DST_EvHeader << 8) | PRad_DST_Epics_Map;
-    dst_out.write((char*) &event_info, sizeof(event_info));
+    saveData(event_info);
 
     vector<epics_ch> epics_channels = handler->GetSortedEPICSList();
 
     uint32_t ch_size = epics_channels.size();
-    dst_out.write((char*) &ch_size, sizeof(ch_size));
+    saveData(ch_size);
 
     for(auto &ch : epics_channels)
     {
         uint32_t str_size = ch.name.size();
-        dst_out.write((char*) &str_size, sizeof(str_size));
+        saveData(str_size);
         for(auto &c : ch.name)
-            dst_out.write((char*) &c, sizeof(c));
-        dst_out.write((char*) &ch.id, sizeof(ch.id));
-        dst_out.write((char*) &ch.value, sizeof(ch.value));
+            saveData(c);
+        saveData(ch.id);
+        saveData(ch.value);
     }
+
+    saveRecord(PRad_DST_Epics_Map);
 }
 
 void PRadDSTParser::readEPICSMap() throw(PRadException)
@@ -287,19 +1001,19 @@ void PRadDSTParser::readEPICSMap() throw(PRadException)
     string str;
     float value;
 
-    dst_in.read((char*) &ch_size, sizeof(ch_size));
+    in_stream->read((char*) &ch_size, sizeof(ch_size));
     for(uint32_t i = 0; i < ch_size; ++i)
     {
         str = "";
-        dst_in.read((char*) &str_size, sizeof(str_size));
+        in_stream->read((char*) &str_size, sizeof(str_size));
         for(uint32_t j = 0; j < str_size; ++j)
         {
             char c;
-            dst_in.read(&c, sizeof(c));
+            in_stream->read(&c, sizeof(c));
             str.push_back(c);
         }
-        dst_in.read((char*) &id, sizeof(id));
-        dst_in.read((char*) &value, sizeof(value));
+        in_stream->read((char*) &id, sizeof(id));
+        in_stream->read((char*) &value, sizeof(value));
 
         if(!(update_mode & NO_EPICS_MAP_UPDATE))
             handler->RegisterEPICS(str, id, value);
@@ -311,26 +1025,31 @@ void PRadDSTParser::WriteHyCalInfo() throw(PRadException)
     if(!dst_out.is_open())
         throw PRadException("WRITE DST", "output file is not opened!");
 
+    // pending column data go first to keep the record order
+    beginRowRecord();
+
     // write header
     uint32_t event_info = (PRad_DST_EvHeader << 8) | PRad_DST_HyCal_Info;
-    dst_out.write((char*) &event_info, sizeof(event_info));
+    saveData(event_info);
 
     uint32_t ch_size = handler->GetChannelList().size();
-    dst_out.write((char*) &ch_size, sizeof(ch_size));
+    saveData(ch_size);
 
     for(auto channel : handler->GetChannelList())
     {
         PRadDAQUnit::Pedestal ped = channel->GetPedestal();
-        dst_out.write((char*) &ped, sizeof(ped));
+        saveData(ped);
 
         PRadDAQUnit::CalibrationConstant cal = channel->GetCalibrationConstant();
         uint32_t gain_size = cal.base_gain.size();
-        dst_out.write((char*) &cal.factor, sizeof(cal.factor));
-        dst_out.write((char*) &cal.base_factor, sizeof(cal.base_factor));
-        dst_out.write((char*) &gain_size, sizeof(gain_size));
+        saveData(cal.factor);
+        saveData(cal.base_factor);
+        saveData(gain_size);
         for(auto &gain : cal.base_gain)
-            dst_out.write((char*) &gain, sizeof(gain));
+            saveData(gain);
     }
+
+    saveRecord(PRad_DST_HyCal_Info);
 }
 
 void PRadDSTParser::readHyCalInfo() throw(PRadException)
@@ -339,26 +1058,26 @@ void PRadDSTParser::readHyCalInfo() throw(PRadException)
         throw PRadException("READ DST", "input file is not opened!");
 
     uint32_t ch_size;
-    dst_in.read((char*) &ch_size, sizeof(ch_size));
+    in_stream->read((char*) &ch_size, sizeof(ch_size));
 
     auto channelList = handler->GetChannelList();
 
     for(uint32_t i = 0; i < ch_size; ++i)
     {
         PRadDAQUnit::Pedestal ped;
-        dst_in.read((char*) &ped, sizeof(ped));
+        in_stream->read((char*) &ped, sizeof(ped));
 
         PRadDAQUnit::CalibrationConstant cal;
-        dst_in.read((char*) &cal.factor, sizeof(cal.factor));
-        dst_in.read((char*) &cal.base_factor, sizeof(cal.base_factor));
+        in_stream->read((char*) &cal.factor, sizeof(cal.factor));
+        in_stream->read((char*) &cal.base_factor, sizeof(cal.base_factor));
 
         double gain;
         uint32_t gain_size;
-        dst_in.read((char*) &gain_size, sizeof(gain_size));
+        in_stream->read((char*) &gain_size, sizeof(gain_size));
 
         for(uint32_t j = 0; j < gain_size; ++j)
         {
-            dst_in.read((char*) &gain, sizeof(gain));
+            in_stream->read((char*) &gain, sizeof(gain));
             cal.base_gain.push_back(gain);
         }
 
@@ -369,6 +1088,8 @@ void PRadDSTParser::readHyCalInfo() throw(PRadException)
                 channelList.at(i)->UpdateCalibrationConstant(cal);
         }
     }
+
+    handler->UpdateSetupVersion();
 }
 
 void PRadDSTParser::WriteGEMInfo() throw(PRadException)
@@ -376,27 +1097,32 @@ void PRadDSTParser::WriteGEMInfo() throw(PRadException)
     if(!dst_out.is_open())
         throw PRadException("WRITE DST", "output file is not opened!");
 
+    // pending column data go first to keep the record order
+    beginRowRecord();
+
     // write header
     uint32_t event_info = (PRad_DST_EvHeader << 8) | PRad_DST_GEM_Info;
-    dst_out.write((char*) &event_info, sizeof(event_info));
+    saveData(event_info);
 
     vector<PRadGEMAPV *> apv_list = handler->GetSRS()->GetAPVList();
 
     uint32_t apv_size = apv_list.size();
-    dst_out.write((char*) &apv_size, sizeof(apv_size));
+    saveData(apv_size);
 
     for(auto apv : apv_list)
     {
         GEMChannelAddress addr = apv->GetAddress();
-        dst_out.write((char*) &addr, sizeof(addr));
+        saveData(addr);
 
         vector<PRadGEMAPV::Pedestal> ped_list = apv->GetPedestalList();
         uint32_t ped_size = ped_list.size();
-        dst_out.write((char*) &ped_size, sizeof(ped_size));
+        saveData(ped_size);
 
         for(auto &ped : ped_list)
-            dst_out.write((char*) &ped, sizeof(ped));
+            saveData(ped);
     }
+
+    saveRecord(PRad_DST_GEM_Info);
 }
 
 void PRadDSTParser::readGEMInfo() throw(PRadException)
@@ -405,27 +1131,57 @@ void PRadDSTParser::readGEMInfo() throw(PRadException)
         throw PRadException("READ DST", "input file is not opened!");
 
     uint32_t apv_size, ped_size;
-    dst_in.read((char*) &apv_size, sizeof(apv_size));
+    in_stream->read((char*) &apv_size, sizeof(apv_size));
 
     for(uint32_t i = 0; i < apv_size; ++i)
     {
         GEMChannelAddress addr;
-        dst_in.read((char*) &addr, sizeof(addr));
+        in_stream->read((char*) &addr, sizeof(addr));
 
         auto apv = handler->GetSRS()->GetAPV(addr);
 
-        dst_in.read((char*) &ped_size, sizeof(ped_size));
+        in_stream->read((char*) &ped_size, sizeof(ped_size));
 
         for(uint32_t j = 0; j < ped_size; ++j)
         {
             PRadGEMAPV::Pedestal ped;
-            dst_in.read((char*) &ped, sizeof(ped));
+            in_stream->read((char*) &ped, sizeof(ped));
             if(apv && !(update_mode & NO_GEM_PED_UPDATE))
                 apv->UpdatePedestal(ped, j);
         }
     }
 }
 
+// copy the events and epics records from another dst file to the output
+// it is used to merge the partial dst files from a parallel replay
+void PRadDSTParser::AppendFile(const string &path) throw(PRadException)
+{
+    if(!dst_out.is_open())
+        throw PRadException("WRITE DST", "output file is not opened!");
+
+    PRadDSTParser part(handler);
+    part.SetMode(DST_UPDATE_NONE);
+    part.OpenInput(path);
+
+    if(!part.dst_in.is_open())
+        throw PRadException("MERGE DST", "cannot open file " + path);
+
+    while(part.Read())
+    {
+        switch(part.EventType())
+        {
+        case PRad_DST_Event:
+            WriteEvent(part.GetEvent());
+            break;
+        case PRad_DST_Epics:
+            WriteEPICS(part.GetEPICSEvent());
+            break;
+        default:
+            break;
+        }
+    }
+}
+
 //============================================================================//
 // Return type:  false. file end or error                                     //
 //               true. successfully read                                      //
@@ -433,10 +1189,17 @@ void PRadDSTParser::readGEMInfo() throw(PRadException)
 bool PRadDSTParser::Read()
 {
     try {
-        if(dst_in.tellg() < input_length && dst_in.tellg() != -1)
+        if(hasRecord())
         {
+            // events from the column chunk
+            if(col_index < col_events) {
+                type = PRad_DST_Event;
+                readColumnEvent(event);
+                return true;
+            }
+
             uint32_t event_info;
-            dst_in.read((char*) &event_info, sizeof(event_info));
+            in_stream->read((char*) &event_info, sizeof(event_info));
 
             if((event_info >> 8) != PRad_DST_EvHeader) {
                 cerr << "DST Parser: Unrecognized event header "
@@ -489,3 +1252,136 @@ bool PRadDSTParser::Read()
         return false;
     }
 }
+
+// read the next event, the epics records are saved in handler so the epics
+// values are available for the events
+bool PRadDSTParser::readRangeEvent()
+{
+    while(Read())
+    {
+        switch(type)
+        {
+        case PRad_DST_Event:
+            return true;
+        case PRad_DST_Epics:
+            handler->GetEPICSData().push_back(epics_event);
+            break;
+        default:
+            break;
+        }
+    }
+
+    return false;
+}
+
+// move to the chunk range, the last epics record before the range is
+// loaded to the handler
+void PRadDSTParser::beginRange(const ChunkRange &range)
+{
+    handler->GetEPICSData().clear();
+
+    for(size_t i = range.first; i > 0; --i)
+    {
+        if(!(chunk_index[i - 1].type_mask & (1 << PRad_DST_Epics)))
+            continue;
+
+        uint32_t mask = read_mask;
+        read_mask = 0;
+        SeekRange(i - 1, i);
+        EPICSData last_epics;
+        while(Read())
+        {
+            if(type == PRad_DST_Epics)
+                last_epics = epics_event;
+        }
+        read_mask = mask;
+
+        handler->GetEPICSData().push_back(last_epics);
+        break;
+    }
+
+    SeekRange(range.first, range.end);
+}
+
+#ifdef MULTI_THREAD
+// split the file into chunk ranges and build the worker handlers
+// return false if the file cannot be processed in parallel
+bool PRadDSTParser::prepareParallel(const string &path, size_t n_threads,
+                                    vector<ChunkRange> &ranges,
+                                    vector<PRadDataHandler *> &workers)
+{
+    // the calling thread also runs the jobs
+    if(n_threads == 0)
+        n_threads = handler->GetThreadPool()->GetThreadNumber() + 1;
+
+    OpenInput(path);
+
+    if(!dst_in.is_open() || chunk_index.size() < 2 || n_threads < 2) {
+        CloseInput();
+        return false;
+    }
+
+    // apply the setup records to this handler first, they are copied to
+    // the worker handlers
+    const uint32_t setup_mask = (1 << PRad_DST_Epics_Map) | (1 << PRad_DST_Run_Info) |
+                                (1 << PRad_DST_HyCal_Info) | (1 << PRad_DST_GEM_Info);
+    uint32_t mask = read_mask;
+    read_mask = 0;
+    for(size_t i = 0; i < chunk_index.size(); ++i)
+    {
+        if(!(chunk_index[i].type_mask & setup_mask))
+            continue;
+        SeekRange(i, i + 1);
+        while(Read()) {;}
+    }
+    read_mask = mask;
+
+    // more ranges than threads to balance the load
+    size_t n_chunks = chunk_index.size();
+    size_t n_ranges = min(n_chunks, 4*n_threads);
+    n_threads = min(n_threads, n_ranges);
+    for(size_t i = 0; i < n_ranges; ++i)
+    {
+        ranges.emplace_back(i*n_chunks/n_ranges, (i + 1)*n_chunks/n_ranges);
+    }
+
+    CloseInput();
+
+    // handlers are built in this thread since histograms are created there
+    for(size_t i = 0; i < n_threads; ++i)
+    {
+        PRadDataHandler *worker = handler->CloneSetup();
+        if(worker == nullptr) {
+            finishParallel(workers);
+            ranges.clear();
+            return false;
+        }
+        workers.push_back(worker);
+    }
+
+    cout << "DST Parser: Processing " << n_chunks << " chunks in "
+         << n_ranges << " ranges with " << n_threads << " threads."
+         << endl;
+
+    return true;
+}
+
+// run the worker jobs in the thread pool of the handler
+void PRadDSTParser::runParallel(const vector<PRadDataHandler *> &workers,
+                                const function<void(PRadDataHandler *)> &job)
+{
+    PRadThreadPool::TaskGroup group(handler->GetThreadPool(), "DST Process");
+    for(auto worker : workers)
+        group.Run([&job, worker] () {job(worker);});
+    group.Wait();
+}
+
+void PRadDSTParser::finishParallel(vector<PRadDataHandler *> &workers)
+{
+    for(auto &worker : workers)
+    {
+        delete worker, worker = nullptr;
+    }
+    workers.clear();
+}
+#endif
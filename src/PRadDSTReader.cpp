@@ -0,0 +1,454 @@
+//============================================================================//
+// Memory mapped DST reader                                                   //
+// The events are provided as views to the data banks in the mapped file, so  //
+// a whole DST file can be iterated without copying or allocating the events  //
+// Compressed chunks are decompressed into buffers that are reused            //
+// The setup records (EPICS map, run, HyCal and GEM info) are only reported   //
+// by their types, use PRadDSTParser to apply them to the data handler        //
+//                                                                            //
+// agent                                                                      //
+// 10/17/2026                                                                 //
+//============================================================================//
+
+#include "PRadDSTReader.h"
+#include "PRadDSTParser.h"
+#include "PRadDAQUnit.h"
+#include "PRadGEMAPV.h"
+#include <iostream>
+#include <iomanip>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+using namespace std;
+
+PRadDSTReader::PRadDSTReader()
+: map_begin(nullptr), map_size(0), version(0), read_mask(DST_READ_ALL),
+  type(PRad_DST_Undefined), file_pos(nullptr), file_end(nullptr),
+  rec_pos(nullptr), rec_end(nullptr), col_events(0), col_index(0)
+{
+    for(int i = 0; i < DST_Column_Size; ++i)
+    {
+        col_pos[i] = nullptr;
+        col_end[i] = nullptr;
+    }
+}
+
+PRadDSTReader::~PRadDSTReader()
+{
+    Close();
+}
+
+bool PRadDSTReader::Open(const string &path)
+{
+    Close();
+
+    int fd = open(path.c_str(), O_RDONLY);
+    if(fd < 0) {
+        cerr << "DST Reader: Cannot open input dst file "
+             << "\"" << path << "\""
+             << ", stop reading!" << endl;
+        return false;
+    }
+
+    struct stat file_stat;
+    if(fstat(fd, &file_stat) < 0 || file_stat.st_size < (off_t)sizeof(uint32_t)) {
+        cerr << "DST Reader: Empty dst file "
+             << "\"" << path << "\""
+             << ", stop reading!" << endl;
+        close(fd);
+        return false;
+    }
+
+    map_size = (size_t)file_stat.st_size;
+    void *mapped = mmap(nullptr, map_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+
+    if(mapped == MAP_FAILED) {
+        cerr << "DST Reader: Cannot map dst file "
+             << "\"" << path << "\""
+             << ", stop reading!" << endl;
+        map_size = 0;
+        return false;
+    }
+
+    madvise(mapped, map_size, MADV_SEQUENTIAL);
+    map_begin = (const char*) mapped;
+
+    uint32_t version_info;
+    memcpy(&version_info, map_begin, sizeof(version_info));
+
+    if((version_info >> 8) != PRad_DST_Header) {
+        cerr << "DST Reader: Unrecognized PRad dst file, stop reading!" << endl;
+        Close();
+        return false;
+    }
+
+    version = version_info & 0xff;
+    file_pos = map_begin + sizeof(version_info);
+    file_end = map_begin + map_size;
+
+    switch(version)
+    {
+    case DST_FILE_VERSION:
+        // the whole file is one block of row records
+        rec_pos = file_pos;
+        rec_end = file_end;
+        file_pos = file_end;
+        break;
+    case DST_FILE_VERSION_V2:
+    case DST_FILE_VERSION_COL:
+    {
+        // chunks end at the footer, a file without the footer is read
+        // until the end
+        uint64_t footer_pos;
+        uint32_t tail_info;
+        if(map_size >= sizeof(version_info) + sizeof(footer_pos) + sizeof(tail_info)) {
+            const char *tail = file_end - sizeof(footer_pos) - sizeof(tail_info);
+            memcpy(&footer_pos, tail, sizeof(footer_pos));
+            memcpy(&tail_info, tail + sizeof(footer_pos), sizeof(tail_info));
+            if(tail_info == (((uint32_t)PRad_DST_Footer << 8) | 0xff) &&
+               footer_pos < (uint64_t)(tail - map_begin))
+                file_end = map_begin + footer_pos;
+        }
+        break;
+    }
+    default:
+        cerr << "DST Reader: Unsupported dst file version "
+             << ((version >> 4) & 0xf) << "." << (version & 0xf)
+             << ", stop reading!" << endl;
+        Close();
+        return false;
+    }
+
+    return true;
+}
+
+void PRadDSTReader::Close()
+{
+    if(map_begin)
+        munmap((void*) map_begin, map_size);
+
+    map_begin = nullptr;
+    map_size = 0;
+    file_pos = file_end = nullptr;
+    rec_pos = rec_end = nullptr;
+    for(int i = 0; i < DST_Column_Size; ++i)
+    {
+        col_pos[i] = nullptr;
+        col_end[i] = nullptr;
+    }
+    col_events = 0;
+    col_index = 0;
+    type = PRad_DST_Undefined;
+}
+
+void PRadDSTReader::checkSize(const char *ptr, const char *end, const size_t &size)
+throw(PRadException)
+{
+    if(ptr == nullptr || (size_t)(end - ptr) < size)
+        throw PRadException("READ DST", "record overrun, probably corrupted file");
+}
+
+// data of a chunk, uncompressed data are used in place
+const char *PRadDSTReader::chunkData(const PRadDSTCodec &c,
+                                     const char *data, const uint32_t &data_size,
+                                     const uint32_t &raw_size,
+                                     vector<char> &buf)
+throw(PRadException)
+{
+    if(data_size == raw_size)
+        return data;
+
+    buf.resize(raw_size);
+    PRadDSTParser::DecompressChunk(c, data, data_size, buf.data(), raw_size);
+    return buf.data();
+}
+
+// move to the next chunk in the file
+bool PRadDSTReader::nextChunk() throw(PRadException)
+{
+    if(file_pos == nullptr || file_end - file_pos < (ptrdiff_t)sizeof(uint32_t))
+        return false;
+
+    uint32_t chunk_info;
+    getData(file_pos, file_end, chunk_info);
+
+    // reached the footer
+    if((chunk_info >> 8) == PRad_DST_Footer) {
+        file_pos = file_end;
+        return false;
+    }
+
+    if((chunk_info >> 8) == PRad_DST_ColumnChunk) {
+        readColumnChunk((PRadDSTCodec)(chunk_info & 0xff));
+        return true;
+    }
+
+    if((chunk_info >> 8) != PRad_DST_ChunkHeader)
+        throw PRadException("READ DST", "unrecognized chunk header, probably corrupted file");
+
+    uint32_t raw_size, data_size, records;
+    int first_event, last_event;
+    getData(file_pos, file_end, raw_size);
+    getData(file_pos, file_end, data_size);
+    getData(file_pos, file_end, records);
+    getData(file_pos, file_end, first_event);
+    getData(file_pos, file_end, last_event);
+    checkSize(file_pos, file_end, data_size);
+
+    rec_pos = chunkData((PRadDSTCodec)(chunk_info & 0xff), file_pos, data_size, raw_size, chunk_buf);
+    rec_end = rec_pos + raw_size;
+    file_pos += data_size;
+
+    return true;
+}
+
+// only the header column and the columns required by the read mask are
+// decompressed
+void PRadDSTReader::readColumnChunk(const PRadDSTCodec &c) throw(PRadException)
+{
+    uint32_t n_cols, events;
+    int first_event, last_event;
+    getData(file_pos, file_end, n_cols);
+    getData(file_pos, file_end, events);
+    getData(file_pos, file_end, first_event);
+    getData(file_pos, file_end, last_event);
+
+    if(n_cols != DST_Column_Size)
+        throw PRadException("READ DST", "unrecognized column chunk, probably corrupted file");
+
+    uint32_t raw_sizes[DST_Column_Size], data_sizes[DST_Column_Size];
+    for(int i = 0; i < DST_Column_Size; ++i)
+    {
+        getData(file_pos, file_end, raw_sizes[i]);
+        getData(file_pos, file_end, data_sizes[i]);
+    }
+
+    const uint32_t required[DST_Column_Size] = {DST_READ_ALL, DST_READ_ADC, DST_READ_TDC,
+                                                DST_READ_GEM, DST_READ_DSC};
+
+    for(int i = 0; i < DST_Column_Size; ++i)
+    {
+        checkSize(file_pos, file_end, data_sizes[i]);
+        if(read_mask & required[i]) {
+            col_pos[i] = chunkData(c, file_pos, data_sizes[i], raw_sizes[i], col_buf[i]);
+            col_end[i] = col_pos[i] + raw_sizes[i];
+        } else {
+            col_pos[i] = col_end[i] = nullptr;
+        }
+        file_pos += data_sizes[i];
+    }
+
+    col_events = events;
+    col_index = 0;
+
+    // no row records in this chunk
+    rec_pos = rec_end = nullptr;
+}
+
+//============================================================================//
+// Return type:  false. file end or error                                     //
+//               true. successfully read                                      //
+//============================================================================//
+bool PRadDSTReader::Read()
+{
+    try {
+        while(true)
+        {
+            // events from the column chunk
+            if(col_index < col_events) {
+                type = PRad_DST_Event;
+                readColumnEvent();
+                return true;
+            }
+
+            if(rec_pos != nullptr && rec_pos < rec_end)
+                break;
+
+            if(!nextChunk())
+                return false;
+        }
+
+        uint32_t event_info;
+        getData(rec_pos, rec_end, event_info);
+
+        if((event_info >> 8) != PRad_DST_EvHeader) {
+            cerr << "DST Reader: Unrecognized event header "
+                 << hex << setw(8) << setfill('0') << event_info
+                 <<" in PRad dst file, probably corrupted file!"
+                 << dec << endl;
+            return false;
+        }
+
+        type = (PRadDSTInfo)(event_info&0xff);
+
+        switch(type)
+        {
+        case PRad_DST_Event:
+            readEvent();
+            break;
+        case PRad_DST_Epics:
+            readEPICS();
+            break;
+        case PRad_DST_Epics_Map:
+        case PRad_DST_Run_Info:
+        case PRad_DST_HyCal_Info:
+        case PRad_DST_GEM_Info:
+            skipRecord();
+            break;
+        default:
+            return false;
+        }
+
+        return true;
+
+    } catch(PRadException &e) {
+        cerr << e.FailureType() << ": "
+             << e.FailureDesc() << endl
+             << "Read from DST Aborted!" << endl;
+        return false;
+    }
+}
+
+// the banks are always walked through since the records are packed, but the
+// unrequested ones are left empty
+void PRadDSTReader::readEvent() throw(PRadException)
+{
+    getData(rec_pos, rec_end, event.event_number);
+    getData(rec_pos, rec_end, event.type);
+    getData(rec_pos, rec_end, event.trigger);
+    getData(rec_pos, rec_end, event.timestamp);
+
+    uint32_t size;
+    getData(rec_pos, rec_end, size);
+    getArray(rec_pos, rec_end, event.adc_data, size);
+    if(!(read_mask & DST_READ_ADC))
+        event.adc_data = ArrayView<ADC_Data>();
+
+    getData(rec_pos, rec_end, size);
+    getArray(rec_pos, rec_end, event.tdc_data, size);
+    if(!(read_mask & DST_READ_TDC))
+        event.tdc_data = ArrayView<TDC_Data>();
+
+    getData(rec_pos, rec_end, size);
+    readGEMHits(rec_pos, rec_end, size);
+    if(!(read_mask & DST_READ_GEM))
+        event.gem_data = GEMHitRange();
+
+    getData(rec_pos, rec_end, size);
+    getArray(rec_pos, rec_end, event.dsc_data, size);
+    if(!(read_mask & DST_READ_DSC))
+        event.dsc_data = ArrayView<DSC_Data>();
+}
+
+void PRadDSTReader::readColumnEvent() throw(PRadException)
+{
+    const char *&header = col_pos[DST_Column_Header];
+    const char *header_end = col_end[DST_Column_Header];
+
+    getData(header, header_end, event.event_number);
+    getData(header, header_end, event.type);
+    getData(header, header_end, event.trigger);
+    getData(header, header_end, event.timestamp);
+
+    uint32_t adc_size, tdc_size, gem_size, dsc_size;
+    getData(header, header_end, adc_size);
+    getData(header, header_end, tdc_size);
+    getData(header, header_end, gem_size);
+    getData(header, header_end, dsc_size);
+
+    event.adc_data = ArrayView<ADC_Data>();
+    event.tdc_data = ArrayView<TDC_Data>();
+    event.gem_data = GEMHitRange();
+    event.dsc_data = ArrayView<DSC_Data>();
+
+    if(col_pos[DST_Column_ADC])
+        getArray(col_pos[DST_Column_ADC], col_end[DST_Column_ADC], event.adc_data, adc_size);
+    if(col_pos[DST_Column_TDC])
+        getArray(col_pos[DST_Column_TDC], col_end[DST_Column_TDC], event.tdc_data, tdc_size);
+    if(col_pos[DST_Column_GEM])
+        readGEMHits(col_pos[DST_Column_GEM], col_end[DST_Column_GEM], gem_size);
+    if(col_pos[DST_Column_DSC])
+        getArray(col_pos[DST_Column_DSC], col_end[DST_Column_DSC], event.dsc_data, dsc_size);
+
+    ++col_index;
+}
+
+// find the range of the packed gem hit records
+void PRadDSTReader::readGEMHits(const char *&ptr, const char *end, const uint32_t &n)
+throw(PRadException)
+{
+    const char *begin = ptr;
+    for(uint32_t i = 0; i < n; ++i)
+    {
+        APVAddress addr;
+        uint32_t value_size;
+        getData(ptr, end, addr);
+        getData(ptr, end, value_size);
+        checkSize(ptr, end, value_size*sizeof(float));
+        ptr += value_size*sizeof(float);
+    }
+
+    event.gem_data = GEMHitRange(begin, ptr, n);
+}
+
+void PRadDSTReader::readEPICS() throw(PRadException)
+{
+    uint32_t value_size;
+    getData(rec_pos, rec_end, epics_event.event_number);
+    getData(rec_pos, rec_end, value_size);
+    getArray(rec_pos, rec_end, epics_event.values, value_size);
+}
+
+// skip the setup records, their layouts follow PRadDSTParser
+void PRadDSTReader::skipRecord() throw(PRadException)
+{
+    uint32_t size, sub_size;
+
+    switch(type)
+    {
+    case PRad_DST_Run_Info:
+        checkSize(rec_pos, rec_end, sizeof(RunInfo));
+        rec_pos += sizeof(RunInfo);
+        break;
+    case PRad_DST_Epics_Map:
+        getData(rec_pos, rec_end, size);
+        for(uint32_t i = 0; i < size; ++i)
+        {
+            // name, id and value
+            getData(rec_pos, rec_end, sub_size);
+            checkSize(rec_pos, rec_end, sub_size + sizeof(uint32_t) + sizeof(float));
+            rec_pos += sub_size + sizeof(uint32_t) + sizeof(float);
+        }
+        break;
+    case PRad_DST_HyCal_Info:
+        getData(rec_pos, rec_end, size);
+        for(uint32_t i = 0; i < size; ++i)
+        {
+            // pedestal, calibration factor, base factor and gains
+            size_t skip = sizeof(PRadDAQUnit::Pedestal) + 2*sizeof(double);
+            checkSize(rec_pos, rec_end, skip);
+            rec_pos += skip;
+            getData(rec_pos, rec_end, sub_size);
+            checkSize(rec_pos, rec_end, sub_size*sizeof(double));
+            rec_pos += sub_size*sizeof(double);
+        }
+        break;
+    case PRad_DST_GEM_Info:
+        getData(rec_pos, rec_end, size);
+        for(uint32_t i = 0; i < size; ++i)
+        {
+            // apv address and pedestals
+            checkSize(rec_pos, rec_end, sizeof(GEMChannelAddress));
+            rec_pos += sizeof(GEMChannelAddress);
+            getData(rec_pos, rec_end, sub_size);
+            checkSize(rec_pos, rec_end, sub_size*sizeof(PRadGEMAPV::Pedestal));
+            rec_pos += sub_size*sizeof(PRadGEMAPV::Pedestal);
+        }
+        break;
+    default:
+        break;
+    }
+}
@@ -9,8 +9,12 @@
 #include <iostream>
 #include <iomanip>
 #include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <cstdio>
 #include "PRadDataHandler.h"
 #include "PRadEvioParser.h"
+#include "PRadEventPipeline.h"
 #include "PRadDSTParser.h"
 #include "PRadHyCalCluster.h"
 #include "PRadSquareCluster.h"
@@ -34,11 +38,23 @@ using namespace std;
 
 PRadDataHandler::PRadDataHandler()
 : parser(new PRadEvioParser(this)),
+  pipeline(nullptr),
   dst_parser(new PRadDSTParser(this)),
-  gem_srs(new PRadGEMSystem()),
+  gem_srs(new PRadGEMSystem()), thread_pool(new PRadThreadPool()), own_pool(true),
   hycal_recon(nullptr), totalE(0), onlineMode(false),
-  replayMode(false), current_event(0)
+  replayMode(false), current_event(0), decode_workers(0), replay_workers(0),
+  setup_version(0)
 {
+#ifdef MULTI_THREAD
+    // use all the cores for decoding by default
+    SetDecodeWorkers(thread::hardware_concurrency());
+#endif
+
+    // the pool size can be changed by the configuration file or environment
+    thread_pool->Resize(PRadThreadPool::GetDefaultSize());
+    end_group = new PRadThreadPool::TaskGroup(thread_pool, "Event Process");
+    gem_srs->SetThreadPool(thread_pool);
+
     // total energy histogram
     energyHist = new TH1D("HyCal Energy", "Total Energy (MeV)", 2500, 0, 2500);
     TagEHist = new TH2I("Tagger E", "Tagger E counter", 2000, 0, 20000, 384, 0, 383);
@@ -54,6 +70,9 @@ PRadDataHandler::PRadDataHandler()
 
 PRadDataHandler::~PRadDataHandler()
 {
+    // the last event is returned to the pool in the process thread
+    WaitEventProcess();
+
     delete energyHist;
     delete TagEHist;
     delete TagTHist;
@@ -74,12 +93,18 @@ PRadDataHandler::~PRadDataHandler()
             delete it.second, it.second = nullptr;
     }
 
+    delete pipeline;
     delete parser;
     delete dst_parser;
     delete gem_srs;
+    delete end_group;
+    if(own_pool)
+        delete thread_pool;
 }
 
-void PRadDataHandler::ReadConfig(const string &path)
+// read configuration file, setup_only only reads the detector setup,
+// it is used to build the independent handlers for parallel replay
+void PRadDataHandler::ReadConfig(const string &path, const bool &setup_only)
 {
     ConfigParser c_parser;
     c_parser.SetSplitters(":,");
@@ -88,6 +113,8 @@ void PRadDataHandler::ReadConfig(const string &path)
         cerr << "Data Handler: Cannot open configuration file "
              << "\"" << path << "\"."
              << endl;
+    } else {
+        config_path = path;
     }
 
     while(c_parser.ParseLine())
@@ -125,6 +152,31 @@ void PRadDataHandler::ReadConfig(const string &path)
             const int var1 = c_parser.TakeFirst().Int();
             ExecuteConfigCommand(&PRadDataHandler::SetRunNumber, var1);
         }
+
+        // the rest are not detector setup
+        if(setup_only)
+            continue;
+
+        if((func_name.find("Decode Workers") != string::npos)) {
+            const int var1 = c_parser.TakeFirst().Int();
+            ExecuteConfigCommand(&PRadDataHandler::SetDecodeWorkers, var1);
+        }
+        if((func_name.find("Replay Workers") != string::npos)) {
+            const int var1 = c_parser.TakeFirst().Int();
+            ExecuteConfigCommand(&PRadDataHandler::SetReplayWorkers, var1);
+        }
+        if((func_name.find("Thread Pool Size") != string::npos)) {
+            const int var1 = c_parser.TakeFirst().Int();
+            // the environment variable has priority over the configuration
+            if(PRadThreadPool::GetEnvironmentSize() < 0)
+                ExecuteConfigCommand(&PRadDataHandler::SetThreadPoolSize, var1);
+        }
+        if((func_name.find("Event Storage") != string::npos)) {
+            const string var1 = c_parser.TakeFirst().String();
+            const int var2 = (c_parser.NbofElements() > 0) ? c_parser.TakeFirst().Int() : 0;
+            const string var3 = (c_parser.NbofElements() > 0) ? c_parser.TakeFirst().String() : "";
+            ExecuteConfigCommand(&PRadDataHandler::SetEventStorage, var1, var2, var3);
+        }
         if((func_name.find("Initialize File") != string::npos)) {
             const string var1 = c_parser.TakeFirst().String();
             ExecuteConfigCommand(&PRadDataHandler::InitializeByData, var1, -1, 2);
@@ -173,6 +225,67 @@ void PRadDataHandler::SetOnlineMode(const bool &mode)
     onlineMode = mode;
 }
 
+// how the decoded events are kept, the stored events are discarded
+// "KeepAll" keeps all the events in memory
+// "Ring" only keeps the last capacity events, the event index starts from
+// the oldest event in the window
+// "Spill" keeps the last capacity events in memory, and pages the older
+// events out to a temporary DST file in spill_dir
+void PRadDataHandler::SetEventStorage(const string &mode, const int &capacity, const string &spill_dir)
+{
+    size_t cap = (capacity > 0) ? capacity : 0;
+
+    if(mode == "KeepAll") {
+        energyData.SetStorage(Storage_KeepAll);
+    } else if(mode == "Ring") {
+        energyData.SetStorage(Storage_Ring, cap);
+    } else if(mode == "Spill") {
+        energyData.SetStorage(Storage_Spill, cap, spill_dir);
+    } else {
+        cerr << "Data Handler: Unknown event storage mode " << mode
+             << ", available modes are KeepAll, Ring and Spill." << endl;
+    }
+}
+
+// number of events that are decoded in parallel for file reading, the
+// decoding runs in the thread pool, and the events are still processed in
+// their original order
+// 0 or 1 means the events are decoded one by one in the reading thread
+void PRadDataHandler::SetDecodeWorkers(const int &n)
+{
+    decode_workers = (n > 1) ? n : 0;
+
+    // the pipeline will be rebuilt with the new number of workers
+    if(pipeline && pipeline->GetWorkerNumber() != (size_t)decode_workers) {
+        delete pipeline, pipeline = nullptr;
+    }
+}
+
+// number of split files that are replayed in parallel
+// 0 or 1 means the split files are replayed one by one
+void PRadDataHandler::SetReplayWorkers(const int &n)
+{
+    replay_workers = (n > 1) ? n : 0;
+}
+
+// number of threads in the pool shared by the event decoding, GEM processing
+// and parallel replay, 0 means all the jobs run in the calling thread
+// environment variable PRAD_THREAD_POOL_SIZE overrides the configuration
+void PRadDataHandler::SetThreadPoolSize(const int &n)
+{
+    if(!own_pool) {
+        cerr << "Data Handler: Cannot resize the thread pool shared from "
+             << "another handler." << endl;
+        return;
+    }
+
+    // the pool should be idle
+    WaitEventProcess();
+    delete pipeline, pipeline = nullptr;
+
+    thread_pool->Resize((n > 0) ? n : 0);
+}
+
 // add DAQ channels
 void PRadDataHandler::AddChannel(PRadDAQUnit *channel)
 {
@@ -227,6 +340,11 @@ void PRadDataHandler::AddTDCGroup(PRadTDCGroup *group)
 
     map_name_tdc[group->GetName()] = group;
     map_daq_tdc[group->GetAddress()] = group;
+    if(!table_daq_tdc.Set(group->GetAddress(), group)) {
+        cerr << "Data Handler: TDC group " << group->GetName()
+             << " has an address out of the lookup table range, "
+             << "its data will not be decoded." << endl;
+    }
 }
 
 void PRadDataHandler::BuildChannelMap()
@@ -239,13 +357,26 @@ void PRadDataHandler::BuildChannelMap()
     // DAQ configuration map
     for(auto &channel : channelList)
         map_daq[channel->GetDAQInfo()] = channel;
+
+    // DAQ lookup table for decoding
+    table_daq.Clear();
+    for(auto &channel : channelList)
+    {
+        if(!table_daq.Set(channel->GetDAQInfo(), channel)) {
+            cerr << "Data Handler: Channel " << channel->GetName()
+                 << " has an address out of the lookup table range, "
+                 << "its data will not be decoded." << endl;
+        }
+    }
+
+    UpdateSetupVersion();
 }
 
 // erase the data container
 void PRadDataHandler::Clear()
 {
     // used memory won't be released, but it can be used again for new data file
-    energyData = deque<EventData>();
+    energyData.Clear();
     epicsData = deque<EPICSData>();
     runInfo.clear();
 
@@ -279,16 +410,16 @@ void PRadDataHandler::ResetChannelHists()
     }
 }
 
-void PRadDataHandler::UpdateTrgType(const unsigned char &trg)
+void PRadDataHandler::UpdateTrgType(const unsigned char &trg, EventData &event)
 {
-    if(newEvent->trigger && (newEvent->trigger != trg)) {
+    if(event.trigger && (event.trigger != trg)) {
         cerr << "ERROR: Trigger type mismatch at event "
-             << parser->GetEventNumber()
-             << ", was " << (int) newEvent->trigger
+             << event.event_number
+             << ", was " << (int) event.trigger
              << " now " << (int) trg
              << endl;
     }
-    newEvent->trigger = trg;
+    event.trigger = trg;
 }
 
 void PRadDataHandler::UpdateEPICS(const string &name, const float &value)
@@ -364,10 +495,10 @@ float PRadDataHandler::GetEPICSValue(const string &name)
 
 float PRadDataHandler::GetEPICSValue(const string &name, const int &index)
 {
-    if((unsigned int)index >= energyData.size())
+    if((unsigned int)index >= energyData.Size())
         return GetEPICSValue(name);
 
-    return GetEPICSValue(name, energyData.at(index));
+    return GetEPICSValue(name, energyData.At(index));
 }
 
 float PRadDataHandler::GetEPICSValue(const string &name, const EventData &event)
@@ -395,77 +526,70 @@ float PRadDataHandler::GetEPICSValue(const string &name, const EventData &event)
     return result;
 }
 
-void PRadDataHandler::FeedData(JLabTIData &tiData)
+void PRadDataHandler::FeedData(JLabTIData &tiData, EventData &event)
 {
-    newEvent->timestamp = tiData.time_high;
-    newEvent->timestamp <<= 32;
-    newEvent->timestamp |= tiData.time_low;
+    event.timestamp = tiData.time_high;
+    event.timestamp <<= 32;
+    event.timestamp |= tiData.time_low;
 }
 
-void PRadDataHandler::FeedData(JLabDSCData &dscData)
+void PRadDataHandler::FeedData(JLabDSCData &dscData, EventData &event)
 {
     for(uint32_t i = 0; i < dscData.size; ++i)
     {
-        newEvent->dsc_data.emplace_back(dscData.gated_buf[i], dscData.ungated_buf[i]);
+        event.dsc_data.emplace_back(dscData.gated_buf[i], dscData.ungated_buf[i]);
     }
 }
 
 // feed ADC1881M data
-void PRadDataHandler::FeedData(ADC1881MData &adcData)
+void PRadDataHandler::FeedData(ADC1881MData &adcData, EventData &event)
 {
     // find the channel with this DAQ configuration
-    auto it = map_daq.find(adcData.config);
+    PRadDAQUnit *channel = table_daq.Get(adcData.config);
 
     // did not find any channel
-    if(it == map_daq.end())
+    if(channel == nullptr)
         return;
 
-    // get the channel
-    PRadDAQUnit *channel = it->second;
-
-    if(newEvent->is_physics_event()) {
+    if(event.is_physics_event()) {
         if(channel->Sparsification(adcData.val)) {
-            newEvent->add_adc(ADC_Data(channel->GetID(), adcData.val)); // store this data word
+            event.add_adc(ADC_Data(channel->GetID(), adcData.val)); // store this data word
         }
-    } else if (newEvent->is_monitor_event()) {
-        newEvent->add_adc(ADC_Data(channel->GetID(), adcData.val));
+    } else if (event.is_monitor_event()) {
+        event.add_adc(ADC_Data(channel->GetID(), adcData.val));
     }
 
 }
 
-void PRadDataHandler::FeedData(TDCV767Data &tdcData)
+void PRadDataHandler::FeedData(TDCV767Data &tdcData, EventData &event)
 {
-    auto it = map_daq_tdc.find(tdcData.config);
-    if(it == map_daq_tdc.end())
+    PRadTDCGroup *tdc = table_daq_tdc.Get(tdcData.config);
+    if(tdc == nullptr)
         return;
 
-    PRadTDCGroup *tdc = it->second;
-
-    newEvent->tdc_data.push_back(TDC_Data(tdc->GetID(), tdcData.val));
+    event.tdc_data.push_back(TDC_Data(tdc->GetID(), tdcData.val));
 }
 
-void PRadDataHandler::FeedData(TDCV1190Data &tdcData)
+void PRadDataHandler::FeedData(TDCV1190Data &tdcData, EventData &event)
 {
     if(tdcData.config.crate == PRadTS) {
-        auto it = map_daq_tdc.find(tdcData.config);
-        if(it == map_daq_tdc.end()) {
+        PRadTDCGroup *tdc = table_daq_tdc.Get(tdcData.config);
+        if(tdc == nullptr)
             return;
-        }
 
-        PRadTDCGroup *tdc = it->second;
-        newEvent->add_tdc(TDC_Data(tdc->GetID(), tdcData.val));
+        event.add_tdc(TDC_Data(tdc->GetID(), tdcData.val));
     } else {
-        FeedTaggerHits(tdcData);
+        FeedTaggerHits(tdcData, event);
     }
 }
 
-void PRadDataHandler::FeedTaggerHits(TDCV1190Data &tdcData)
+void PRadDataHandler::FeedTaggerHits(TDCV1190Data &tdcData, EventData &event)
 {
     if(tdcData.config.slot == 3 || tdcData.config.slot == 5 || tdcData.config.slot == 7)
     {
         int e_ch = tdcData.config.channel + (tdcData.config.slot - 3)*64 + TAGGER_CHANID;
         // E Channel 30000 + channel
-        newEvent->add_tdc(TDC_Data(e_ch, tdcData.val));
+        event.add_tdc(TDC_Data(e_ch, tdcData.val));
     }
     if(tdcData.config.slot == 14)
     {
@@ -476,28 +600,41 @@ void PRadDataHandler::FeedTaggerHits(TDCV1190Data &tdcData)
         else
             t_ch = (t_ch + 16)%32;
         t_ch += t_lr*64;
-        newEvent->add_tdc(TDC_Data(t_ch + TAGGER_CHANID + TAGGER_T_CHANID, tdcData.val));
+        event.add_tdc(TDC_Data(t_ch + TAGGER_CHANID + TAGGER_T_CHANID, tdcData.val));
     }
 }
 
 // feed GEM data
-void PRadDataHandler::FeedData(GEMRawData &gemData)
+void PRadDataHandler::FeedData(vector<GEMRawData> &gemData, EventData &event)
 {
-    gem_srs->FillRawData(gemData, newEvent->gem_data, newEvent->is_monitor_event());
+    gem_srs->FillRawData(gemData, event.gem_data, event.is_monitor_event());
 }
 
 // feed GEM data which has been zero-suppressed
-void PRadDataHandler::FeedData(vector<GEMZeroSupData> &gemData)
+void PRadDataHandler::FeedData(vector<GEMZeroSupData> &gemData, EventData &event)
 {
-    gem_srs->FillZeroSupData(gemData, newEvent->gem_data);
+    gem_srs->FillZeroSupData(gemData, event.gem_data);
 }
 
+// the event data and the event view from the mapped DST share the same
+// histogram filling and event choosing code
 void PRadDataHandler::FillHistograms(EventData &data)
+{
+    fillHistograms(data);
+}
+
+void PRadDataHandler::FillHistograms(const EventView &data)
+{
+    fillHistograms(data);
+}
+
+template<typename T>
+void PRadDataHandler::fillHistograms(const T &data)
 {
     double energy = 0.;
 
     // for all types of events
-    for(auto &adc : data.adc_data)
+    for(const auto &adc : data.adc_data)
     {
         if(adc.channel_id >= channelList.size())
             continue;
@@ -512,7 +649,7 @@ void PRadDataHandler::FillHistograms(EventData &data)
     // for only physics events
     energyHist->Fill(energy);
 
-    for(auto &tdc : data.tdc_data)
+    for(const auto &tdc : data.tdc_data)
     {
         if(tdc.channel_id < tdcList.size()) {
             tdcList[tdc.channel_id]->FillHist(tdc.value);
@@ -527,71 +664,81 @@ void PRadDataHandler::FillHistograms(EventData &data)
 }
 
 // signal of new event
-void PRadDataHandler::StartofNewEvent(const unsigned char &tag)
+EventData *PRadDataHandler::StartofNewEvent(const unsigned char &tag)
 {
-    newEvent = new EventData(tag);
+    // recycled event container, its data banks are already allocated
+    newEvent = eventPool.Get(tag);
+    return newEvent;
 }
 
 // signal of event end, save event or discard event in online mode
 void PRadDataHandler::EndofThisEvent(const unsigned int &ev)
 {
     newEvent->event_number = ev;
-    // wait for the process thread
+    // wait for the last event process
     WaitEventProcess();
 
-    end_thread = thread(&PRadDataHandler::EndProcess, this, newEvent);
+    EventData *data = newEvent;
+    end_group->Run([this, data] () {EndProcess(data);});
 }
 
 void PRadDataHandler::WaitEventProcess()
 {
-    if(end_thread.joinable())
-        end_thread.join();
+    end_group->Wait();
 }
 
 void PRadDataHandler::EndProcess(EventData *data)
 {
-    if(data->type == EPICS_Info) {
+    CommitEvent(*data);
+
+    eventPool.Put(data); // the event is recycled for the next one
+}
+
+// save the decoded event, the events should be committed in order
+// the data banks are copied to the event store, so the event container can
+// be reused
+void PRadDataHandler::CommitEvent(EventData &data)
+{
+    if(data.type == EPICS_Info) {
 
         if(onlineMode && epicsData.size())
             epicsData.pop_front();
 
         if(replayMode)
-            dst_parser->WriteEPICS(EPICSData(data->event_number, epics_values));
+            dst_parser->WriteEPICS(EPICSData(data.event_number, epics_values));
         else
-            epicsData.emplace_back(data->event_number, epics_values);
+            epicsData.emplace_back(data.event_number, epics_values);
 
     } else { // event or sync event
 
-        FillHistograms(*data);
+        FillHistograms(data);
 
-        if(data->type == CODA_Sync) {
-            AccumulateBeamCharge(*data);
-            UpdateLiveTimeScaler(*data);
+        if(data.type == CODA_Sync) {
+            AccumulateBeamCharge(data);
+            UpdateLiveTimeScaler(data);
             if(onlineMode)
-                UpdateOnlineInfo(*data);
+                UpdateOnlineInfo(data);
         }
 
-        if(onlineMode && energyData.size()) // online mode only saves the last event, to reduce usage of memory
-            energyData.pop_front();
+        if(onlineMode && energyData.Size()) // online mode only saves the last event, to reduce usage of memory
+            energyData.Reset(); // the arenas are reused by the next event
 
         if(replayMode)
-            dst_parser->WriteEvent(*data);
+            dst_parser->WriteEvent(data);
         else
-            energyData.emplace_back(move(*data)); // save event
+            energyData.Add(data); // save event, it is packed in the event store
 
     }
-
-    delete data; // new data memory is released here
 }
 
 // show the event to event viewer
 void PRadDataHandler::ChooseEvent(const int &idx)
 {
-    if (energyData.size()) { // offline mode, pick the event given by console
-        if((unsigned int) idx >= energyData.size())
-            ChooseEvent(energyData.back());
+    if (energyData.Size()) { // offline mode, pick the event given by console
+        if((unsigned int) idx >= energyData.Size())
+            ChooseEvent(energyData.Back());
         else
-            ChooseEvent(energyData.at(idx));
+            ChooseEvent(energyData.At(idx));
     } else if(!onlineMode) {
         cout << "Data Handler: Data bank is empty, no event is chosen." << endl;
         return;
@@ -599,6 +746,17 @@ void PRadDataHandler::ChooseEvent(const int &idx)
 }
 
 void PRadDataHandler::ChooseEvent(const EventData &event)
+{
+    chooseEvent(event);
+}
+
+void PRadDataHandler::ChooseEvent(const EventView &event)
+{
+    chooseEvent(event);
+}
+
+template<typename T>
+void PRadDataHandler::chooseEvent(const T &event)
 {
     totalE = 0;
     // != avoids operator definition for non-standard map
@@ -612,7 +770,7 @@ void PRadDataHandler::ChooseEvent(const EventData &event)
         tdc_ch->ClearTimeMeasure();
     }
 
-    for(auto &adc : event.adc_data)
+    for(const auto &adc : event.adc_data)
     {
         if(adc.channel_id >= channelList.size())
             continue;
@@ -621,7 +779,7 @@ void PRadDataHandler::ChooseEvent(const EventData &event)
         totalE += channelList[adc.channel_id]->GetEnergy();
     }
 
-    for(auto &tdc : event.tdc_data)
+    for(const auto &tdc : event.tdc_data)
     {
         if(tdc.channel_id >= tdcList.size())
             continue;
@@ -633,9 +791,20 @@ void PRadDataHandler::ChooseEvent(const EventData &event)
 }
 
 double PRadDataHandler::GetEnergy(const EventData &event)
+{
+    return getEnergy(event);
+}
+
+double PRadDataHandler::GetEnergy(const EventView &event)
+{
+    return getEnergy(event);
+}
+
+template<typename T>
+double PRadDataHandler::getEnergy(const T &event)
 {
     double energy = 0.;
-    for(auto &adc : event.adc_data)
+    for(const auto &adc : event.adc_data)
     {
         if(adc.channel_id >= channelList.size())
             continue;
@@ -801,12 +970,14 @@ void PRadDataHandler::SaveHistograms(const string &path)
     delete f;
 }
 
-EventData &PRadDataHandler::GetEvent(const unsigned int &index)
+// the event is a copy of the stored one, the last event is returned if the
+// index is out of range
+EventData PRadDataHandler::GetEvent(const unsigned int &index)
 {
-    if(index >= energyData.size()) {
-        return energyData.back();
+    if(index >= energyData.Size()) {
+        return energyData.Back();
     } else {
-        return energyData.at(index);
+        return energyData.At(index);
     }
 }
 
@@ -888,6 +1059,8 @@ void PRadDataHandler::FitPedestal()
 
         channel->UpdatePedestal(p0, p1);
     }
+
+    UpdateSetupVersion();
 }
 
 void PRadDataHandler::CorrectGainFactor(const int &ref)
@@ -1001,6 +1174,8 @@ void PRadDataHandler::CorrectGainFactor(const int &ref)
             }
         }
     }
+
+    UpdateSetupVersion();
 }
 
 void PRadDataHandler::ReadGEMConfiguration(const string &path)
@@ -1140,6 +1315,7 @@ void PRadDataHandler::ReadPedestalFile(const string &path)
     }
 
     c_parser.CloseFile();
+    UpdateSetupVersion();
 };
 
 void PRadDataHandler::ReadGEMPedestalFile(const string &path)
@@ -1181,6 +1357,7 @@ void PRadDataHandler::ReadCalibrationFile(const string &path)
     }
 
     c_parser.CloseFile();
+    UpdateSetupVersion();
 }
 
 void PRadDataHandler::ReadGainFactor(const string &path, const int &ref)
@@ -1220,6 +1397,7 @@ void PRadDataHandler::ReadGainFactor(const string &path, const int &ref)
     }
 
     c_parser.CloseFile();
+    UpdateSetupVersion();
 }
 
 // Refill energy hist after correct gain factos
@@ -1227,13 +1405,15 @@ void PRadDataHandler::RefillEnergyHist()
 {
     energyHist->Reset();
 
-    for(auto &event : energyData)
+    // the packed events are read in place without unpacking
+    for(size_t i = 0; i < energyData.Size(); ++i)
     {
+        const EventView event = energyData.View(i);
         if(!event.is_physics_event())
             continue;
 
         double ene = 0.;
-        for(auto &adc : event.adc_data)
+        for(const auto &adc : event.adc_data)
         {
             if(adc.channel_id >= channelList.size())
                 continue;
@@ -1247,7 +1427,39 @@ void PRadDataHandler::RefillEnergyHist()
 
 void PRadDataHandler::ReadFromEvio(const string &path, const int &evt, const bool &verbose)
 {
-    parser->ReadEvioFile(path.c_str(), evt, verbose);
+    if(decode_workers > 1) {
+        WaitEventProcess();
+
+        if(!pipeline)
+            pipeline = new PRadEventPipeline(this, thread_pool, decode_workers);
+
+        // event number continues from the last file
+        pipeline->SetEventNumber(parser->GetEventNumber());
+        parser->SetPipeline(pipeline);
+        parser->ReadEvioFile(path.c_str(), evt, verbose);
+        parser->SetPipeline(nullptr);
+        parser->SetEventNumber(pipeline->GetEventNumber());
+    } else {
+        parser->ReadEvioFile(path.c_str(), evt, verbose);
+    }
+
+    WaitEventProcess();
+
+    if(verbose) {
+        cout << "Data Handler: Event pool hits " << eventPool.GetHits()
+             << ", misses " << eventPool.GetMisses()
+             << ", dropped " << eventPool.GetDropped()
+             << endl;
+    }
+}
+
+// read the events with event number in [first, last] from evio file
+// the events are located by the event index, so there is no need to decode
+// the events before them
+void PRadDataHandler::ReadRangeFromEvio(const string &path, const int &first, const int &last)
+{
+    parser->ReadRange(path.c_str(), first, last);
+
     WaitEventProcess();
 }
 
@@ -1281,7 +1493,7 @@ void PRadDataHandler::InitializeByData(const string &path, int run, int ref)
 
         gem_srs->SetPedestalMode(true);
 
-        parser->ReadEvioFile(path.c_str(), 20000);
+        ReadFromEvio(path, 20000);
     }
 
     cout << "Data Handler: Fitting Pedestal for HyCal." << endl;
@@ -1345,47 +1557,17 @@ void PRadDataHandler::GetRunNumberFromFileName(const string &name, const size_t
 // otherwise this function will not work properly
 int PRadDataHandler::FindEventIndex(const int &ev)
 {
-    int result = -1;
-
     if(ev < 0) {
         cout << "Data Handler: Cannot find event with negative event number!" << endl;
-        return result;
+        return -1;
     }
 
-    if(!energyData.size()) {
+    if(!energyData.Size()) {
         cout << "Data Handler: No event found since data bank is empty." << endl;
-        return result;
-    }
-
-    int data_begin = 0;
-    int data_end = (int)energyData.size() - 1;
-
-    int first_event = energyData.at(0).event_number;
-
-    if(ev > first_event) {
-        int index = ev - first_event;
-        if(index >= data_end)
-            index = data_end;
-        int diff = energyData.at(index).event_number - ev;
-        while(diff > 0)
-        {
-            index -= diff;
-            if(index <= 0) {
-                index = 0;
-                break;
-            }
-            diff = energyData.at(index).event_number - ev;
-        }
-
-        data_begin = index;
+        return -1;
     }
 
-    for(int i = data_begin; i < data_end; ++i) {
-        if(energyData.at(i) == ev)
-            return i;
-    }
-
-    return result;
+    return energyData.Find(ev);
 }
 
 void PRadDataHandler::AddHyCalClusterMethod(PRadHyCalCluster *r,
@@ -1437,7 +1619,8 @@ void PRadDataHandler::ListHyCalClusterMethods()
 
 void PRadDataHandler::HyCalReconstruct(const int &event_index)
 {
-    return HyCalReconstruct(GetEvent(event_index));
+    EventData event = GetEvent(event_index);
+    return HyCalReconstruct(event);
 }
 
 void PRadDataHandler::HyCalReconstruct(EventData &event)
@@ -1446,6 +1629,131 @@ void PRadDataHandler::HyCalReconstruct(EventData &event)
         return hycal_recon->Reconstruct(event);
 }
 
+void PRadDataHandler::HyCalReconstruct(const EventView &event)
+{
+    if(hycal_recon)
+        return hycal_recon->Reconstruct(event);
+}
+
+// clusters of the events reconstructed by a job, packed in event order
+struct HyCalJobOutput
+{
+    std::vector<HyCalHit> clusters;
+    std::vector<HyCalBlock> blocks;
+    std::vector<size_t> cluster_end;
+    std::vector<size_t> block_end;
+
+    void clear()
+    {
+        clusters.clear();
+        blocks.clear();
+        cluster_end.clear();
+        block_end.clear();
+    }
+};
+
+// reconstruct the events from index first to index last (both included) in
+// the thread pool, every running job takes a copy of the current clustering
+// method, the callback is called in this thread in the event order
+void PRadDataHandler::HyCalReconstructRange(const int &first,
+                                            const int &last,
+                                            const HyCalCallback &callback)
+{
+    if(hycal_recon == nullptr)
+        return;
+
+    int begin = max(first, 0);
+    int end = min(last + 1, (int)energyData.Size());
+    if(begin >= end)
+        return;
+
+    // the calling thread also runs the jobs, more jobs than threads to
+    // balance the load, the events of a batch are copied out of the storage
+    // first since the paged events are not kept in memory
+    size_t n_workers = thread_pool->GetThreadNumber() + 1;
+    size_t n_jobs = (n_workers > 1) ? 4*n_workers : 1;
+    size_t batch_size = n_jobs*HYCAL_RECON_JOB_EVENTS;
+
+    vector<EventData> batch(min(batch_size, (size_t)(end - begin)));
+    vector<HyCalJobOutput> outputs(n_jobs);
+    vector<PRadHyCalCluster*> methods;
+    mutex method_lock;
+
+    auto job = [&] (const size_t &ev_begin, const size_t &ev_end, HyCalJobOutput &out)
+               {
+                   PRadHyCalCluster *method = nullptr;
+                   {
+                       lock_guard<mutex> lock(method_lock);
+                       if(methods.empty()) {
+                           method = hycal_recon->Clone();
+                       } else {
+                           method = methods.back();
+                           methods.pop_back();
+                       }
+                   }
+
+                   out.clear();
+                   for(size_t i = ev_begin; i < ev_end; ++i)
+                   {
+                       method->Reconstruct(batch[i]);
+                       auto clusters = method->GetClusters();
+                       auto blocks = method->GetBlocks();
+                       out.clusters.insert(out.clusters.end(), clusters.begin(), clusters.end());
+                       out.blocks.insert(out.blocks.end(), blocks.begin(), blocks.end());
+                       out.cluster_end.push_back(out.clusters.size());
+                       out.block_end.push_back(out.blocks.size());
+                   }
+
+                   lock_guard<mutex> lock(method_lock);
+                   methods.push_back(method);
+               };
+
+    try {
+        for(int batch_begin = begin; batch_begin < end; batch_begin += batch_size)
+        {
+            size_t n = min(batch_size, (size_t)(end - batch_begin));
+            for(size_t i = 0; i < n; ++i)
+                energyData.View(batch_begin + i).copy_to(batch[i]);
+
+            PRadThreadPool::TaskGroup group(thread_pool, "HyCal Reconstruct");
+            for(size_t j = 0; j < n_jobs; ++j)
+            {
+                size_t ev_begin = j*n/n_jobs, ev_end = (j + 1)*n/n_jobs;
+                HyCalJobOutput *out = &outputs[j];
+                group.Run([&job, ev_begin, ev_end, out] () {job(ev_begin, ev_end, *out);});
+            }
+            group.Wait();
+
+            for(size_t j = 0; j < n_jobs; ++j)
+            {
+                const HyCalJobOutput &out = outputs[j];
+                size_t ev_begin = j*n/n_jobs;
+                size_t cl_begin = 0, bl_begin = 0;
+                for(size_t k = 0; k < out.cluster_end.size(); ++k)
+                {
+                    callback(batch[ev_begin + k],
+                             ArraySpan<HyCalHit>(out.clusters, cl_begin, out.cluster_end[k] - cl_begin),
+                             ArraySpan<HyCalBlock>(out.blocks, bl_begin, out.block_end[k] - bl_begin));
+                    cl_begin = out.cluster_end[k];
+                    bl_begin = out.block_end[k];
+                }
+            }
+        }
+    } catch(...) {
+        for(auto &method : methods)
+            delete method;
+        throw;
+    }
+
+    for(auto &method : methods)
+        delete method;
+}
+
+void PRadDataHandler::HyCalReconstructAll(const HyCalCallback &callback)
+{
+    HyCalReconstructRange(0, (int)energyData.Size() - 1, callback);
+}
+
 HyCalHit *PRadDataHandler::GetHyCalCluster(int &size)
 {
     if(hycal_recon) {
@@ -1455,27 +1763,29 @@ HyCalHit *PRadDataHandler::GetHyCalCluster(int &size)
     return nullptr;
 }
 
-// a slower version, it re-packs the hycalhits into a vector and return it
-vector<HyCalHit> PRadDataHandler::GetHyCalCluster()
+// the clusters are not copied, the span is valid until next reconstruction
+ArraySpan<HyCalHit> PRadDataHandler::GetHyCalCluster()
 {
-    vector<HyCalHit> hits;
-    if(hycal_recon) {
-        HyCalHit* hitp = hycal_recon->GetCluster();
-        int Nhits = hycal_recon->GetNClusters();
-        for(int i = 0; i < Nhits; ++i)
-            hits.push_back(hitp[i]);
-    }
-    return hits;
+    if(hycal_recon)
+        return hycal_recon->GetClusters();
+    return ArraySpan<HyCalHit>();
+}
+
+// modules of the cluster from the current reconstruction method
+ArraySpan<HyCalBlock> PRadDataHandler::GetHyCalClusterBlocks(const HyCalHit &hit)
+{
+    if(hycal_recon)
+        return hycal_recon->GetClusterBlocks(hit);
+    return ArraySpan<HyCalBlock>();
 }
 
 void PRadDataHandler::Replay(const string &r_path, const int &split, const string &w_path)
 {
-    if(w_path.empty()) {
-        string file = "prad_" + to_string(runInfo.run_number) + ".dst";
-        dst_parser->OpenOutput(file);
-    } else {
-        dst_parser->OpenOutput(w_path);
-    }
+    string file = w_path;
+    if(file.empty())
+        file = "prad_" + to_string(runInfo.run_number) + ".dst";
+
+    dst_parser->OpenOutput(file);
 
     cout << "Replay started!" << endl;
     PRadBenchMark timer;
@@ -1486,7 +1796,11 @@ void PRadDataHandler::Replay(const string &r_path, const int &split, const strin
 
     replayMode = true;
 
-    ReadFromSplitEvio(r_path, split);
+    if(split > 0 && replay_workers > 1 && !config_path.empty()) {
+        replaySplitParallel(r_path, split, file);
+    } else {
+        ReadFromSplitEvio(r_path, split);
+    }
 
     dst_parser->WriteRunInfo();
 
@@ -1496,6 +1810,246 @@ void PRadDataHandler::Replay(const string &r_path, const int &split, const strin
     dst_parser->CloseOutput();
 }
 
+// replay the split files in parallel, each split file is decoded by an
+// independent handler and saved to a partial dst file
+// the partial files are merged in the split order afterwards, so the output
+// is the same as the one from serial replay
+void PRadDataHandler::replaySplitParallel(const string &r_path, const int &split, const string &w_path)
+{
+    int n_workers = min(replay_workers, split + 1);
+
+    cout << "Data Handler: Replay " << split + 1 << " split files with "
+         << n_workers << " workers." << endl;
+
+    // handlers are built in this thread since histograms are created there
+    vector<PRadDataHandler *> workers;
+    for(int i = 0; i < n_workers; ++i)
+    {
+        workers.push_back(CloneSetup());
+    }
+
+    // a split starts with the epics values at the end of the previous splits,
+    // and the epics events do not always carry all the channels, so the
+    // epics events of the splits are scanned first, the channels updated in
+    // each split are recorded in the order of their channel ids, so the new
+    // channels are registered in the same order as the serial replay
+    vector<vector<pair<string, float>>> split_updates(split);
+    atomic<int> next_scan(0);
+    auto scan_splits = [&] (PRadDataHandler *worker)
+                       {
+                           int idx;
+                           while((idx = next_scan++) < split)
+                           {
+                               const float undefined = EPICS_UNDEFINED_VALUE;
+                               worker->epics_map = epics_map;
+                               worker->epics_values.assign(epics_values.size(), undefined);
+                               worker->parser->ReadEPICS((r_path + "." + to_string(idx)).c_str());
+
+                               vector<string> names(worker->epics_values.size());
+                               for(auto &ch : worker->epics_map)
+                                   names.at(ch.second) = ch.first;
+                               for(size_t id = 0; id < names.size(); ++id)
+                               {
+                                   if(worker->epics_values[id] != undefined)
+                                       split_updates[idx].emplace_back(names[id], worker->epics_values[id]);
+                               }
+                           }
+                       };
+
+    // information from each split, they are combined in order
+    vector<RunInfo> split_info(split + 1);
+    unordered_map<string, uint32_t> last_epics_map;
+    vector<float> last_epics;
+    vector<int> split_event(split + 1, 0);
+
+    atomic<int> next_split(0);
+    auto replay_splits = [&] (PRadDataHandler *worker)
+                         {
+                             int idx;
+                             while((idx = next_split++) <= split)
+                             {
+                                 worker->epics_map = epics_map;
+                                 worker->epics_values = epics_values;
+                                 for(int i = 0; i < idx; ++i)
+                                     for(auto &update : split_updates[i])
+                                         worker->UpdateEPICS(update.first, update.second);
+
+                                 worker->runInfo.clear();
+                                 worker->replaySplit(r_path + "." + to_string(idx),
+                                                     w_path + ".part" + to_string(idx));
+                                 split_info[idx] = worker->runInfo;
+                                 split_event[idx] = worker->parser->GetEventNumber();
+                                 if(idx == split) {
+                                     last_epics_map = worker->epics_map;
+                                     last_epics = worker->epics_values;
+                                 }
+                             }
+                         };
+
+    // the workers run in the thread pool, the split files are claimed one by
+    // one, so a smaller pool only reduces the number of active workers
+    PRadThreadPool::TaskGroup scan_group(thread_pool, "Scan Split EPICS");
+    for(auto worker : workers)
+        scan_group.Run([&scan_splits, worker] () {scan_splits(worker);});
+    scan_group.Wait();
+
+    PRadThreadPool::TaskGroup group(thread_pool, "Replay Split");
+    for(auto worker : workers)
+        group.Run([&replay_splits, worker] () {replay_splits(worker);});
+    group.Wait();
+
+    // merge the partial dst files in split order
+    for(int i = 0; i <= split; ++i)
+    {
+        string part = w_path + ".part" + to_string(i);
+        try {
+            dst_parser->AppendFile(part);
+        } catch(PRadException &e) {
+            cerr << e.FailureType() << ": "
+                 << e.FailureDesc() << endl
+                 << "Data Handler: Skipped partial replay file "
+                 << "\"" << part << "\"" << endl;
+        }
+        remove(part.c_str());
+
+        runInfo.beam_charge += split_info[i].beam_charge;
+        runInfo.dead_count += split_info[i].dead_count;
+        runInfo.ungated_count += split_info[i].ungated_count;
+    }
+
+    // the epics values and event number continue from the last split
+    if(last_epics.size() >= epics_values.size()) {
+        epics_map = last_epics_map;
+        epics_values = last_epics;
+    }
+    parser->SetEventNumber(split_event[split]);
+
+    // combine the histograms
+    for(auto worker : workers)
+    {
+        mergeHistograms(*worker);
+        delete worker;
+    }
+}
+
+// replay one split file into a partial dst file, it only has the events
+void PRadDataHandler::replaySplit(const string &r_path, const string &w_path)
+{
+    // partial files are merged record by record, no need to compress them
+    dst_parser->SetOutputVersion(1);
+    dst_parser->OpenOutput(w_path);
+
+    replayMode = true;
+    ReadFromEvio(r_path, -1, true);
+    replayMode = false;
+
+    dst_parser->CloseOutput();
+}
+
+// copy the pedestal, calibration and epics information from another handler,
+// the channels are expected to be built from the same configuration
+// create an independent handler with the same detector setup and HyCal
+// clustering methods, it is used by the parallel processing workers
+// the configuration file is needed to build the detector setup
+PRadDataHandler *PRadDataHandler::CloneSetup()
+{
+    if(config_path.empty()) {
+        cerr << "Data Handler: Cannot clone the setup without configuration file."
+             << endl;
+        return nullptr;
+    }
+
+    PRadDataHandler *worker = new PRadDataHandler();
+    worker->ReadConfig(config_path, true);
+    worker->SetDecodeWorkers(0);
+    worker->shareThreadPool(thread_pool);
+    worker->copySetup(*this);
+
+    for(auto &it : hycal_recon_map)
+    {
+        PRadHyCalCluster *method = it.second->Clone();
+        method->SetHandler(worker);
+        worker->hycal_recon_map[it.first] = method;
+        if(hycal_recon == it.second)
+            worker->hycal_recon = method;
+    }
+
+    return worker;
+}
+
+// use the thread pool from another handler instead of its own threads
+void PRadDataHandler::shareThreadPool(PRadThreadPool *pool)
+{
+    WaitEventProcess();
+    delete end_group;
+    delete pipeline, pipeline = nullptr;
+
+    if(own_pool)
+        delete thread_pool;
+
+    thread_pool = pool;
+    own_pool = false;
+    end_group = new PRadThreadPool::TaskGroup(thread_pool, "Event Process");
+    gem_srs->SetThreadPool(thread_pool);
+}
+
+void PRadDataHandler::copySetup(const PRadDataHandler &other)
+{
+    runInfo.run_number = other.runInfo.run_number;
+
+    if(channelList.size() != other.channelList.size()) {
+        cerr << "Data Handler: Channel list size mismatch in copying setup, "
+             << "expected " << other.channelList.size()
+             << ", but has " << channelList.size()
+             << endl;
+    }
+
+    for(auto channel : other.channelList)
+    {
+        PRadDAQUnit *ch = GetChannel(channel->GetDAQInfo());
+        if(ch == nullptr)
+            continue;
+        ch->UpdatePedestal(channel->GetPedestal());
+        ch->UpdateCalibrationConstant(channel->GetCalibrationConstant());
+    }
+    UpdateSetupVersion();
+
+    for(auto apv : other.gem_srs->GetAPVList())
+    {
+        PRadGEMAPV *my_apv = gem_srs->GetAPV(apv->GetAddress());
+        if(my_apv == nullptr)
+            continue;
+        vector<PRadGEMAPV::Pedestal> peds = apv->GetPedestalList();
+        my_apv->UpdatePedestal(peds);
+    }
+
+    epics_map = other.epics_map;
+    epics_values = other.epics_values;
+}
+
+// add the histograms from another handler with the same setup
+void PRadDataHandler::mergeHistograms(const PRadDataHandler &other)
+{
+    energyHist->Add(other.energyHist);
+    TagEHist->Add(other.TagEHist);
+    TagTHist->Add(other.TagTHist);
+
+    for(auto channel : other.channelList)
+    {
+        PRadDAQUnit *ch = GetChannel(channel->GetDAQInfo());
+        if(ch == nullptr)
+            continue;
+
+        vector<TH1*> hists = ch->GetHistList();
+        vector<TH1*> other_hists = channel->GetHistList();
+        for(size_t i = 0; i < hists.size() && i < other_hists.size(); ++i)
+            hists[i]->Add(other_hists[i]);
+    }
+
+    for(size_t i = 0; i < tdcList.size() && i < other.tdcList.size(); ++i)
+        tdcList[i]->GetHist()->Add(other.tdcList[i]->GetHist());
+}
+
 void PRadDataHandler::ReadFromDST(const string &path, const uint32_t &mode)
 {
     try {
@@ -1513,7 +2067,7 @@ void PRadDataHandler::ReadFromDST(const string &path, const uint32_t &mode)
             {
             case PRad_DST_Event:
                 FillHistograms(dst_parser->GetEvent());
-                energyData.push_back(dst_parser->GetEvent());
+                energyData.Add(dst_parser->GetEvent());
                 break;
             case PRad_DST_Epics:
                 epicsData.push_back(dst_parser->GetEPICSEvent());
@@ -1552,9 +2106,9 @@ void PRadDataHandler::WriteToDST(const string &path)
             dst_parser->WriteEPICS(epics);
         }
 
-        for(auto &event : energyData)
+        for(size_t i = 0; i < energyData.Size(); ++i)
         {
-            dst_parser->WriteEvent(event);
+            dst_parser->WriteEvent(energyData.At(i));
         }
 
         dst_parser->WriteRunInfo();
@@ -25,6 +25,7 @@ void PRadDetMatch::Clear()
 {
     fNHyCalClusters = 0;
     fHyCalClusters = nullptr;
+    fGEMMatchPool.clear();
     fGEM1DClusters.clear();
     map<int, vector<GEMDetCluster> >::iterator it;
     for (it = fGEM2DClusters.begin(); it != fGEM2DClusters.end(); it++) { (it->second).clear(); }
@@ -116,6 +117,9 @@ void PRadDetMatch::DetectorMatch()
         }
     }
 
+    //the matched ids of all the HyCal clusters are in one pool
+    fGEMMatchPool.clear();
+
     //for each HyCal cluster, find GEM cluster that may be able to match the coordinate
     //The matching is probably better to be done on a common plane, say coincide with
     //the second GEM, because the cut may be different depending how far the plane is
@@ -145,7 +149,7 @@ void PRadDetMatch::DetectorMatch()
                     //if match mode is 0, save all hits within range
                     //if match mode is 1, save the cloest one
 
-                    if (fHyCalGEMMatchMode == 0) { fHyCalClusters[i].add_gem_clusterID(j, k); }
+                    if (fHyCalGEMMatchMode == 0) { fHyCalClusters[i].add_gem_clusterID(fGEMMatchPool, j, k); }
                     else{
                         rSave = thisR;
                         idSave = k;
@@ -154,7 +158,7 @@ void PRadDetMatch::DetectorMatch()
             }
             if (fHyCalGEMMatchMode !=0 && idSave < cl.size()){
                 assert(fHyCalClusters[i].gemNClusters[j] == 0); //should be empty before
-                fHyCalClusters[i].add_gem_clusterID(j, idSave);
+                fHyCalClusters[i].add_gem_clusterID(fGEMMatchPool, j, idSave);
                 fHyCalClusters[i].x_gem = fGEM2DClusters[j].at(idSave).x;
                 fHyCalClusters[i].y_gem = fGEM2DClusters[j].at(idSave).y;
                 fHyCalClusters[i].z_gem = fGEMZ[j];
@@ -182,7 +186,8 @@ void PRadDetMatch::MatchProcessing()
 
             if (fHyCalClusters[i].gemNClusters[0] == 1 && fHyCalClusters[i].gemNClusters[1] == 1){
                 //project every thing to the second GEM for analysis
-                int   index[NGEM] = { fHyCalClusters[i].gemClusterID[0][0], fHyCalClusters[i].gemClusterID[1][0]};
+                int   index[NGEM] = { fGEMMatchPool[fHyCalClusters[i].gemOffset[0]],
+                                      fGEMMatchPool[fHyCalClusters[i].gemOffset[1]] };
                 float hycalX = fHyCalClusters[i].x_log;
                 float hycalY = fHyCalClusters[i].y_log;
                 float GEM1X  =  fGEM2DClusters[0].at(index[0]).x;
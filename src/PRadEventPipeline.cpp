@@ -0,0 +1,118 @@
+//============================================================================//
+// Event decoding pipeline                                                    //
+// The reader stage submits event buffers, the events are decoded as jobs in  //
+// the thread pool, each event slot has its own parser and event container    //
+// Decoded events are committed to the data handler in their original order   //
+//                                                                            //
+// agent                                                                      //
+// 10/17/2026                                                                 //
+//============================================================================//
+
+#include "PRadEventPipeline.h"
+#include "PRadEvioParser.h"
+#include "PRadDataHandler.h"
+#include <iostream>
+
+using namespace std;
+
+PRadEventPipeline::PRadEventPipeline(PRadDataHandler *h, PRadThreadPool *pool, const size_t &n)
+: handler(h), group(new PRadThreadPool::TaskGroup(pool, "Event Decode")),
+  event_number(0), next_seq(0), next_commit(0)
+{
+    for(size_t i = 0; i < n; ++i)
+    {
+        Slot *slot = new Slot();
+        slot->parser = new PRadEvioParser(handler);
+        slots.push_back(slot);
+    }
+}
+
+PRadEventPipeline::~PRadEventPipeline()
+{
+    Wait();
+    delete group;
+
+    for(auto &slot : slots)
+    {
+        delete slot->parser;
+        delete slot, slot = nullptr;
+    }
+}
+
+// submit an event to the decoding jobs
+// it blocks if all the event slots are in use
+void PRadEventPipeline::Submit(PRadEventHeader *header)
+{
+    {
+        unique_lock<mutex> lock(commit_lock);
+        space_cond.wait(lock, [this] {return next_seq - next_commit < slots.size();});
+    }
+
+    // the slot is free since its last event is committed
+    uint64_t seq = next_seq++;
+    slots[seq%slots.size()]->header = header;
+
+    group->Run([this, seq] () {decode(seq);});
+}
+
+// wait until all the submitted events are committed
+// it should be called from the thread that submits the events
+void PRadEventPipeline::Wait()
+{
+    group->Wait();
+}
+
+void PRadEventPipeline::decode(const uint64_t &seq)
+{
+    Slot *slot = slots[seq%slots.size()];
+
+    // epics event updates the epics values in handler
+    // thus it is decoded in the ordered commit stage
+    if(slot->header->tag != EPICS_Info)
+        slot->valid = slot->parser->DecodeEvent(slot->header, slot->event);
+
+    unique_lock<mutex> lock(commit_lock);
+    slot->ready = true;
+
+    // commit the decoded events in order, an event that is decoded before
+    // the earlier ones is committed by the job that finishes the last of them
+    while(true)
+    {
+        Slot *next = slots[next_commit%slots.size()];
+        if(!next->ready)
+            break;
+
+        if(next->header->tag == EPICS_Info)
+            next->valid = next->parser->DecodeEvent(next->header, next->event);
+
+        if(next->valid)
+            commit(next);
+
+        next->ready = false;
+        ++next_commit;
+    }
+
+    lock.unlock();
+    space_cond.notify_one();
+}
+
+// commit the event in slot, commit lock should be held
+void PRadEventPipeline::commit(Slot *slot)
+{
+    EventData &event = slot->event;
+
+    // events without info bank take the last event number
+    if(event.event_number < 0)
+        event.event_number = event_number;
+    else
+        event_number = event.event_number;
+
+    try {
+        handler->CommitEvent(event);
+    } catch(PRadException &e) {
+        cerr << e.FailureType() << ": "
+             << e.FailureDesc() << endl
+             << "Event Pipeline: Failed to commit event "
+             << event.event_number << endl;
+    }
+}
@@ -0,0 +1,137 @@
+//============================================================================//
+// Recycling pool of event data containers for the decoding path              //
+// The returned events are cleared but their data banks keep the capacity,    //
+// so a recycled event does not allocate memory again in most cases           //
+// The pool is a lock-free bounded queue, events can be taken and returned    //
+// from different threads, a thread preempted in the middle of an operation   //
+// may let the others see the pool empty or full for a while, which only      //
+// ends up with a miss or a dropped event                                     //
+//                                                                            //
+// agent                                                                      //
+// 10/17/2026                                                                 //
+//============================================================================//
+
+#include "PRadEventPool.h"
+
+using namespace std;
+
+PRadEventPool::PRadEventPool(const size_t &size)
+: push_pos(0), pop_pos(0), hits(0), misses(0), dropped(0)
+{
+    // the capacity is rounded up to a power of 2
+    size_t capacity = 2;
+    while(capacity < size)
+        capacity <<= 1;
+
+    cells = new Cell[capacity];
+    mask = capacity - 1;
+
+    for(size_t i = 0; i < capacity; ++i)
+    {
+        cells[i].sequence.store(i, memory_order_relaxed);
+        cells[i].data = nullptr;
+    }
+}
+
+PRadEventPool::~PRadEventPool()
+{
+    EventData *data;
+    while(pop(data))
+        delete data;
+
+    delete [] cells;
+}
+
+// take an event from the pool, a new event is created if the pool is empty
+EventData *PRadEventPool::Get(const unsigned char &tag)
+{
+    EventData *data;
+    if(pop(data)) {
+        ++hits;
+        data->type = tag;
+        return data;
+    }
+
+    ++misses;
+    return new EventData(tag);
+}
+
+// return an event to the pool, it is deleted if the pool is full
+void PRadEventPool::Put(EventData *data)
+{
+    if(!data)
+        return;
+
+    data->clear();
+
+    if(!push(data)) {
+        ++dropped;
+        delete data;
+    }
+}
+
+void PRadEventPool::ResetCounters()
+{
+    hits = 0;
+    misses = 0;
+    dropped = 0;
+}
+
+bool PRadEventPool::push(EventData *data)
+{
+    size_t pos = push_pos.load(memory_order_relaxed);
+    Cell *cell;
+
+    while(true)
+    {
+        cell = &cells[pos & mask];
+        size_t seq = cell->sequence.load(memory_order_acquire);
+        intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+
+        if(diff == 0) {
+            // the cell is free, claim the position
+            if(push_pos.compare_exchange_weak(pos, pos + 1, memory_order_relaxed))
+                break;
+        } else if(diff < 0) {
+            // full
+            return false;
+        } else {
+            // taken by another thread
+            pos = push_pos.load(memory_order_relaxed);
+        }
+    }
+
+    cell->data = data;
+    cell->sequence.store(pos + 1, memory_order_release);
+    return true;
+}
+
+bool PRadEventPool::pop(EventData *&data)
+{
+    size_t pos = pop_pos.load(memory_order_relaxed);
+    Cell *cell;
+
+    while(true)
+    {
+        cell = &cells[pos & mask];
+        size_t seq = cell->sequence.load(memory_order_acquire);
+        intptr_t diff = (intptr_t)seq - (intptr_t)(pos + 1);
+
+        if(diff == 0) {
+            // the cell is filled, claim the position
+            if(pop_pos.compare_exchange_weak(pos, pos + 1, memory_order_relaxed))
+                break;
+        } else if(diff < 0) {
+            // empty
+            return false;
+        } else {
+            // taken by another thread
+            pos = pop_pos.load(memory_order_relaxed);
+        }
+    }
+
+    data = cell->data;
+    // the cell can be written again after one round
+    cell->sequence.store(pos + mask + 1, memory_order_release);
+    return true;
+}
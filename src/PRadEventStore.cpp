@@ -0,0 +1,448 @@
+//============================================================================//
+// Storage of the decoded events in the data handler                          //
+// The events are packed in blocks, each block has contiguous arenas for the  //
+// ADC, TDC, GEM and DSC banks, and the events only keep their positions in   //
+// the arenas. It keeps all the events, a ring window of the last N events,   //
+// or the last N events in memory with the older blocks paged out to a        //
+// temporary DST file, the spilled events are paged back when accessed        //
+//                                                                            //
+// agent                                                                      //
+// 10/17/2026                                                                 //
+//============================================================================//
+
+#include "PRadEventStore.h"
+#include "PRadDSTParser.h"
+#include <iostream>
+#include <algorithm>
+#include <cstdlib>
+#include <cstdio>
+#include <unistd.h>
+
+#define STORE_BLOCK_EVENTS 4096
+#define SPILL_FILE_NAME "prad_events_XXXXXX"
+
+using namespace std;
+
+//============================================================================//
+// Event Block                                                                //
+//============================================================================//
+
+void PRadEventStore::Block::Add(const EventData &event)
+{
+    Record rec;
+    rec.event_number = event.event_number;
+    rec.type = event.type;
+    rec.trigger = event.trigger;
+    rec.timestamp = event.timestamp;
+
+    rec.adc_begin = adc_arena.size();
+    rec.adc_size = event.adc_data.size();
+    adc_arena.insert(adc_arena.end(), event.adc_data.begin(), event.adc_data.end());
+
+    rec.tdc_begin = tdc_arena.size();
+    rec.tdc_size = event.tdc_data.size();
+    tdc_arena.insert(tdc_arena.end(), event.tdc_data.begin(), event.tdc_data.end());
+
+    rec.gem_begin = gem_arena.size();
+    rec.gem_size = event.gem_data.size();
+    for(auto &gem : event.gem_data)
+    {
+        uint32_t hit_size = gem.values.size();
+        const char *addr = (const char*) &gem.addr;
+        const char *size = (const char*) &hit_size;
+        const char *values = (const char*) gem.values.data();
+        gem_arena.insert(gem_arena.end(), addr, addr + sizeof(gem.addr));
+        gem_arena.insert(gem_arena.end(), size, size + sizeof(hit_size));
+        gem_arena.insert(gem_arena.end(), values, values + hit_size*sizeof(float));
+    }
+    rec.gem_end = gem_arena.size();
+
+    rec.dsc_begin = dsc_arena.size();
+    rec.dsc_size = event.dsc_data.size();
+    dsc_arena.insert(dsc_arena.end(), event.dsc_data.begin(), event.dsc_data.end());
+
+    records.push_back(rec);
+}
+
+// the view is valid until the block is changed
+EventView PRadEventStore::Block::View(const size_t &i) const
+{
+    const Record &rec = records.at(i);
+
+    EventView view;
+    view.event_number = rec.event_number;
+    view.type = rec.type;
+    view.trigger = rec.trigger;
+    view.timestamp = rec.timestamp;
+    view.adc_data = ArrayView<ADC_Data>(adc_arena.data() + rec.adc_begin, rec.adc_size);
+    view.tdc_data = ArrayView<TDC_Data>(tdc_arena.data() + rec.tdc_begin, rec.tdc_size);
+    view.gem_data = GEMHitRange(gem_arena.data() + rec.gem_begin,
+                                gem_arena.data() + rec.gem_end,
+                                rec.gem_size);
+    view.dsc_data = ArrayView<DSC_Data>(dsc_arena.data() + rec.dsc_begin, rec.dsc_size);
+
+    return view;
+}
+
+void PRadEventStore::Block::Clear()
+{
+    records.clear();
+    adc_arena.clear();
+    tdc_arena.clear();
+    gem_arena.clear();
+    dsc_arena.clear();
+}
+
+size_t PRadEventStore::Block::Bytes() const
+{
+    return records.capacity()*sizeof(Record)
+           + adc_arena.capacity()*sizeof(ADC_Data)
+           + tdc_arena.capacity()*sizeof(TDC_Data)
+           + gem_arena.capacity()
+           + dsc_arena.capacity()*sizeof(DSC_Data);
+}
+
+//============================================================================//
+// Event Store                                                                //
+//============================================================================//
+
+PRadEventStore::PRadEventStore()
+: storage(Storage_KeepAll), capacity(0), block_events(STORE_BLOCK_EVENTS),
+  resident(0), front(0), spill_out(nullptr), spill_in(nullptr), cached_page(0)
+{
+}
+
+PRadEventStore::~PRadEventStore()
+{
+    Clear();
+}
+
+// change the storage mode, the stored events are discarded
+// capacity is the number of events kept in memory for ring and spill mode
+// the temporary file for spill mode is created in spill_dir, it is the
+// TMPDIR or /tmp if not specified
+void PRadEventStore::SetStorage(const PRadEventStorage &mode,
+                                const size_t &cap,
+                                const string &dir)
+{
+    Clear();
+
+    storage = mode;
+    capacity = cap;
+    spill_dir = dir;
+    block_events = STORE_BLOCK_EVENTS;
+
+    if(storage == Storage_KeepAll)
+        return;
+
+    if(capacity == 0) {
+        cerr << "Event Store: The number of events in memory is not specified, "
+             << "all the events will be kept." << endl;
+        storage = Storage_KeepAll;
+        return;
+    }
+
+    // smaller blocks for a small window, so the memory usage is at most
+    // one block more than the capacity
+    block_events = min((size_t)STORE_BLOCK_EVENTS, max((size_t)1, capacity/2));
+}
+
+// discard all the events, the temporary file is removed
+void PRadEventStore::Clear()
+{
+    clearBlocks();
+    closeSpill();
+}
+
+// discard all the events but keep the last block and its arenas, so the
+// next events are packed without allocating a new block
+void PRadEventStore::Reset()
+{
+    if(blocks.empty())
+        return Clear();
+
+    while(blocks.size() > 1)
+    {
+        delete blocks.front();
+        blocks.pop_front();
+    }
+    blocks.back()->Clear();
+
+    resident = 0;
+    front = 0;
+    closeSpill();
+}
+
+void PRadEventStore::clearBlocks()
+{
+    for(auto &block : blocks)
+        delete block;
+    blocks.clear();
+
+    resident = 0;
+    front = 0;
+}
+
+void PRadEventStore::Add(const EventData &event)
+{
+    if(blocks.empty() || blocks.back()->Size() >= block_events) {
+        Block *block = new Block();
+        block->records.reserve(block_events);
+        // reserve the arenas by the size of the previous block
+        if(!blocks.empty()) {
+            const Block *last = blocks.back();
+            block->adc_arena.reserve(last->adc_arena.size());
+            block->tdc_arena.reserve(last->tdc_arena.size());
+            block->gem_arena.reserve(last->gem_arena.size());
+            block->dsc_arena.reserve(last->dsc_arena.size());
+        }
+        blocks.push_back(block);
+    }
+
+    blocks.back()->Add(event);
+    ++resident;
+
+    makeRoom();
+}
+
+// the index is counted from the first event that is still available, it is
+// the first event in the ring window for ring mode
+// the view is valid until the next event is added or the next access to the
+// spilled events
+EventView PRadEventStore::View(const size_t &index)
+{
+    size_t pos = index + front;
+    size_t spilled = GetSpilledCount();
+
+    // the events that cannot be read back are empty
+    if(pos < spilled) {
+        if(!loadPage(pos/block_events) && pos%block_events >= page_cache.Size())
+            return EventView();
+        return page_cache.View(pos%block_events);
+    }
+
+    pos -= spilled;
+    return blocks.at(pos/block_events)->View(pos%block_events);
+}
+
+// the event is unpacked to a copy, changing it does not change the store,
+// use View to read the event without copying
+EventData PRadEventStore::At(const size_t &index)
+{
+    EventData event;
+    View(index).copy_to(event);
+    return event;
+}
+
+// an empty event if there is no event in memory
+EventData PRadEventStore::Back()
+{
+    EventData event;
+    if(!blocks.empty() && blocks.back()->Size())
+        blocks.back()->View(blocks.back()->Size() - 1).copy_to(event);
+    return event;
+}
+
+// find event by its event number, the events are assumed in order
+// return -1 if not found
+int PRadEventStore::Find(const int &ev)
+{
+    // the spilled pages are only loaded if it may contain the event
+    for(size_t i = 0; i < pages.size(); ++i)
+    {
+        if(ev < pages[i].first_event || ev > pages[i].last_event)
+            continue;
+
+        loadPage(i);
+        const Block &page = page_cache;
+        for(size_t j = 0; j < page.Size(); ++j)
+        {
+            if(page.records[j].event_number == ev)
+                return i*block_events + j;
+        }
+    }
+
+    // the event records in memory, skip the blocks by their event range
+    size_t pos = GetSpilledCount();
+    for(size_t i = 0; i < blocks.size(); ++i)
+    {
+        const vector<Record> &records = blocks[i]->records;
+        size_t first = (i == 0) ? front : 0;
+
+        if(records.size() > first &&
+           ev >= records[first].event_number &&
+           ev <= records.back().event_number) {
+            for(size_t j = first; j < records.size(); ++j)
+            {
+                if(records[j].event_number == ev)
+                    return pos + j - first;
+            }
+        }
+
+        pos += records.size() - first;
+    }
+
+    return -1;
+}
+
+// memory used by the event blocks
+size_t PRadEventStore::GetMemoryUsage() const
+{
+    size_t bytes = page_cache.Bytes();
+    for(auto &block : blocks)
+        bytes += block->Bytes();
+    return bytes;
+}
+
+// keep the number of events in memory within the capacity
+void PRadEventStore::makeRoom()
+{
+    switch(storage)
+    {
+    case Storage_Ring:
+        while(resident - front > capacity)
+        {
+            if(++front == block_events) {
+                delete blocks.front();
+                blocks.pop_front();
+                resident -= block_events;
+                front = 0;
+            }
+        }
+        break;
+    case Storage_Spill:
+        // stop if the block cannot be spilled, the storage falls back to
+        // keeping all the events in that case
+        while(resident > capacity && blocks.size() > 1)
+        {
+            if(!spillBlock())
+                break;
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+// write the oldest block of events to the temporary file
+// return false if the temporary file cannot be created
+bool PRadEventStore::spillBlock()
+{
+    if(!spill_out) {
+        string dir = spill_dir;
+        if(dir.empty()) {
+            const char *tmp = getenv("TMPDIR");
+            dir = tmp ? tmp : "/tmp";
+        }
+
+        string path = dir + "/" + SPILL_FILE_NAME;
+        int fd = mkstemp(&path[0]);
+        if(fd < 0) {
+            cerr << "Event Store: Cannot create temporary file in " << dir
+                 << ", the events will be kept in memory." << endl;
+            storage = Storage_KeepAll;
+            return false;
+        }
+        close(fd);
+
+        spill_path = path;
+        spill_out = new PRadDSTParser(nullptr);
+        spill_out->SetOutputVersion(1);
+        spill_out->OpenOutput(spill_path);
+    }
+
+    Block *block = blocks.front();
+
+    Page page;
+    page.begin = spill_out->GetBytesWritten();
+    page.first_event = block->records.front().event_number;
+    page.last_event = page.first_event;
+
+    EventData event;
+    for(size_t i = 0; i < block->Size(); ++i)
+    {
+        block->View(i).copy_to(event);
+        spill_out->WriteEvent(event);
+        page.first_event = min(page.first_event, event.event_number);
+        page.last_event = max(page.last_event, event.event_number);
+    }
+
+    // the page can be read back once it is flushed
+    spill_out->FlushOutput();
+    page.end = spill_out->GetBytesWritten();
+    pages.push_back(page);
+
+    resident -= block->Size();
+    delete block;
+    blocks.pop_front();
+    return true;
+}
+
+// read a spilled block back to the cache
+// return false if the page cannot be fully read, the cache keeps the events
+// that were read and the page is read again at the next access
+bool PRadEventStore::loadPage(const size_t &idx)
+{
+    if(idx == cached_page && page_cache.Size() == block_events)
+        return true;
+
+    page_cache.Clear();
+    cached_page = idx;
+
+    // the file may be removed by a tmp cleaner, try to open it at every
+    // access until it is opened
+    if(!spill_in) {
+        spill_in = new PRadDSTParser(nullptr);
+    }
+    if(!spill_in->IsInputOpen()) {
+        spill_in->OpenInput(spill_path);
+        if(!spill_in->IsInputOpen()) {
+            cerr << "Event Store: Cannot open spilled events file " << spill_path
+                 << endl;
+            return false;
+        }
+    }
+
+    if(idx >= pages.size() ||
+       !spill_in->SeekPosition(pages[idx].begin, pages[idx].end)) {
+        cerr << "Event Store: Cannot read spilled events from " << spill_path
+             << endl;
+        return false;
+    }
+
+    try {
+        while(spill_in->Read())
+        {
+            if(spill_in->EventType() == PRad_DST_Event)
+                page_cache.Add(spill_in->GetEvent());
+        }
+    } catch(PRadException &e) {
+        cerr << e.FailureType() << ": " << e.FailureDesc() << endl;
+    }
+
+    if(page_cache.Size() != block_events) {
+        cerr << "Event Store: Only read " << page_cache.Size() << " of "
+             << block_events << " spilled events from " << spill_path
+             << endl;
+        return false;
+    }
+
+    return true;
+}
+
+void PRadEventStore::closeSpill()
+{
+    delete spill_in;
+    delete spill_out;
+    spill_in = nullptr;
+    spill_out = nullptr;
+
+    if(!spill_path.empty()) {
+        remove(spill_path.c_str());
+        spill_path.clear();
+    }
+
+    pages.clear();
+    page_cache = Block();
+    cached_page = 0;
+}
@@ -1388,14 +1388,14 @@ void PRadEventViewer::reconCurrentEvent()
         HyCal->AddHyCalHits(h);
 
         if (!fUseIsland) continue;
-        for (int nhit=0; nhit<thisHit[i].nblocks; nhit++){
-            auto it = thisMap.find(thisHit[i].moduleID[nhit]);
+        for (auto &block : handler->GetHyCalClusterBlocks(thisHit[i])){
+            auto it = thisMap.find(block.id);
             if (it == thisMap.end()){
                std::vector<pair<int, QString> > thisVector;
-               thisVector.push_back(pair<int, QString>(i, QString::number(thisHit[i].moduleE[nhit])));
-               thisMap[thisHit[i].moduleID[nhit]] = thisVector;
+               thisVector.push_back(pair<int, QString>(i, QString::number(block.E)));
+               thisMap[block.id] = thisVector;
             }else{
-               (it->second).push_back(pair<int, QString>(i, QString::number(thisHit[i].moduleE[nhit]) ));
+               (it->second).push_back(pair<int, QString>(i, QString::number(block.E) ));
             }
 
         }
@@ -1439,8 +1439,7 @@ void PRadEventViewer::reconCurrentEvent()
     }else{
         for (int i=0; i<nHyCalHits; i++){
             for (unsigned int j=0; j<gemClusters.size(); j++){
-                for (int k=0; k<thisHit[i].gemNClusters[j]; k++){
-                    int index = thisHit[i].gemClusterID[j][k];
+                for (auto &index : fDetMatch->GetMatchedGEMClusters(thisHit[i], j)){
                     QPointF h(gemClusters[j][index].x - HYCAL_SHIFT, -1.*gemClusters[j][index].y);
                     HyCal->AddGEMHits(j, h);
                 }
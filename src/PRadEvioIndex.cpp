@@ -0,0 +1,272 @@
+//============================================================================//
+// Event index of evio file, it maps event number to the file offset          //
+// The index is built by scanning the CODA block headers and event info banks //
+// once, and it is saved in a sidecar file next to the evio file              //
+//                                                                            //
+// agent                                                                      //
+// 10/17/2026                                                                 //
+//============================================================================//
+
+#include "PRadEvioIndex.h"
+#include "datastruct.h"
+#include <iostream>
+#include <fstream>
+#include <algorithm>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define CODA_BLOCK_SIZE 8
+#define INDEX_FILE_MAGIC 0x50494458 // "PIDX"
+#define INDEX_FILE_VERSION 1
+
+using namespace std;
+
+PRadEvioIndex::PRadEvioIndex()
+: file_size(0)
+{
+}
+
+PRadEvioIndex::~PRadEvioIndex()
+{
+}
+
+void PRadEvioIndex::Clear()
+{
+    file_path.clear();
+    file_size = 0;
+    entries.clear();
+}
+
+string PRadEvioIndex::SidecarPath(const string &evio_path)
+{
+    return evio_path + ".idx";
+}
+
+// get the index for evio file, read it from the sidecar file if it is there
+// and up to date, otherwise build it and save it if required
+bool PRadEvioIndex::Open(const string &evio_path, const bool &save)
+{
+    struct stat file_stat;
+    if(stat(evio_path.c_str(), &file_stat) < 0) {
+        cerr << "Evio Index: Cannot find evio file " << evio_path << endl;
+        return false;
+    }
+
+    // already opened
+    if(file_path == evio_path && file_size == (uint64_t)file_stat.st_size)
+        return true;
+
+    string sidecar = SidecarPath(evio_path);
+    if(Load(sidecar) && file_size == (uint64_t)file_stat.st_size) {
+        file_path = evio_path;
+        return true;
+    }
+
+    if(!Build(evio_path))
+        return false;
+
+    if(save && !Save(sidecar)) {
+        cerr << "Evio Index: Cannot save index to " << sidecar
+             << ", the index is only kept in memory." << endl;
+    }
+
+    return true;
+}
+
+// scan the evio file and record the position of all the interested events
+bool PRadEvioIndex::Build(const string &evio_path)
+{
+    Clear();
+
+    int fd = open(evio_path.c_str(), O_RDONLY);
+    if(fd < 0) {
+        cerr << "Evio Index: Cannot open evio file " << evio_path << endl;
+        return false;
+    }
+
+    struct stat file_stat;
+    if(fstat(fd, &file_stat) < 0 || file_stat.st_size <= 0) {
+        close(fd);
+        return false;
+    }
+
+    size_t length = (size_t)file_stat.st_size;
+    void *mapped = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+
+    if(mapped == MAP_FAILED) {
+        cerr << "Evio Index: Cannot map evio file " << evio_path << endl;
+        return false;
+    }
+
+    madvise(mapped, length, MADV_SEQUENTIAL);
+
+    const uint32_t *buf = (const uint32_t*) mapped;
+    size_t total_words = length/sizeof(uint32_t);
+    size_t block = 0;
+    int last_event = 0;
+
+    while(block < total_words)
+    {
+        size_t block_size = buf[block];
+        if(block_size < CODA_BLOCK_SIZE || block + block_size > total_words) {
+            cerr << "Evio Index: Corrupted block at word " << block
+                 << " in " << evio_path << ", stop indexing." << endl;
+            break;
+        }
+
+        size_t index = block + CODA_BLOCK_SIZE;
+        size_t block_end = block + block_size;
+
+        while(index < block_end)
+        {
+            const PRadEventHeader *header = (const PRadEventHeader*) &buf[index];
+            size_t event_end = index + header->length + 1;
+            if(event_end > block_end)
+                break;
+
+            switch(header->tag)
+            {
+            case CODA_Event:
+            case CODA_Sync:
+            {
+                // look for the event info bank in the roc banks
+                size_t bank = index + 2;
+                while(bank < event_end)
+                {
+                    const PRadEventHeader *roc = (const PRadEventHeader*) &buf[bank];
+                    if(roc->tag == EVINFO_BANK && bank + 2 < event_end) {
+                        last_event = buf[bank + 2];
+                        break;
+                    }
+                    bank += roc->length + 1;
+                }
+            }
+            // fall through
+            case EPICS_Info:
+                entries.emplace_back(last_event, header->tag, (uint64_t)index*sizeof(uint32_t));
+                break;
+            default:
+                break;
+            }
+
+            index = event_end;
+        }
+
+        block = block_end;
+    }
+
+    munmap(mapped, length);
+
+    file_path = evio_path;
+    file_size = length;
+    return true;
+}
+
+bool PRadEvioIndex::Save(const string &path)
+{
+    ofstream out(path, ios::out | ios::binary);
+    if(!out.is_open())
+        return false;
+
+    uint32_t magic = INDEX_FILE_MAGIC, version = INDEX_FILE_VERSION;
+    uint64_t size = entries.size();
+
+    out.write((char*) &magic, sizeof(magic));
+    out.write((char*) &version, sizeof(version));
+    out.write((char*) &file_size, sizeof(file_size));
+    out.write((char*) &size, sizeof(size));
+
+    for(auto &entry : entries)
+    {
+        out.write((char*) &entry.event_number, sizeof(entry.event_number));
+        out.write((char*) &entry.tag, sizeof(entry.tag));
+        out.write((char*) &entry.offset, sizeof(entry.offset));
+    }
+
+    return out.good();
+}
+
+bool PRadEvioIndex::Load(const string &path)
+{
+    Clear();
+
+    ifstream in(path, ios::in | ios::binary);
+    if(!in.is_open())
+        return false;
+
+    uint32_t magic = 0, version = 0;
+    uint64_t size = 0;
+
+    in.read((char*) &magic, sizeof(magic));
+    in.read((char*) &version, sizeof(version));
+    if(magic != INDEX_FILE_MAGIC || version != INDEX_FILE_VERSION) {
+        cerr << "Evio Index: Unrecognized index file " << path << endl;
+        return false;
+    }
+
+    in.read((char*) &file_size, sizeof(file_size));
+    in.read((char*) &size, sizeof(size));
+
+    // check the number of entries with the file length before allocating,
+    // a corrupted count would otherwise request a huge vector
+    const uint64_t header_bytes = sizeof(magic) + sizeof(version)
+                                  + sizeof(file_size) + sizeof(size);
+    const uint64_t entry_bytes = sizeof(int) + sizeof(unsigned short)
+                                 + sizeof(uint64_t);
+    in.seekg(0, ios::end);
+    uint64_t length = in.tellg();
+    in.seekg(header_bytes, ios::beg);
+    if(!in.good() || length < header_bytes ||
+       size != (length - header_bytes)/entry_bytes) {
+        cerr << "Evio Index: Index file " << path
+             << " does not match its number of entries" << endl;
+        Clear();
+        return false;
+    }
+
+    entries.resize(size);
+    for(auto &entry : entries)
+    {
+        in.read((char*) &entry.event_number, sizeof(entry.event_number));
+        in.read((char*) &entry.tag, sizeof(entry.tag));
+        in.read((char*) &entry.offset, sizeof(entry.offset));
+    }
+
+    if(!in.good()) {
+        cerr << "Evio Index: Incomplete index file " << path << endl;
+        Clear();
+        return false;
+    }
+
+    return true;
+}
+
+// the first entry that has event number not less than the given one
+// event numbers are increasing in the file
+int PRadEvioIndex::LowerBound(const int &event_number) const
+{
+    auto it = lower_bound(entries.begin(), entries.end(), event_number,
+                          [] (const Entry &e, const int &ev)
+                          {
+                              return e.event_number < ev;
+                          });
+    return it - entries.begin();
+}
+
+// find the physics or sync event with the event number
+// return -1 if not found
+int PRadEvioIndex::FindEntry(const int &event_number) const
+{
+    for(size_t i = LowerBound(event_number); i < entries.size(); ++i)
+    {
+        if(entries[i].event_number != event_number)
+            break;
+        if(entries[i].tag != EPICS_Info)
+            return i;
+    }
+
+    return -1;
+}
@@ -1,7 +1,8 @@
 //============================================================================//
 // A class to parse data buffer from file or ET                               //
 // Make sure the endianness is correct or change the code befire using it     //
-// Multi-thread can be disabled in PRadDataHandler.h                          //
+// The raw GEM frames of an event are collected and processed in parallel     //
+// by the data handler at the end of the event                                //
 //                                                                            //
 // Chao Peng                                                                  //
 // 02/27/2016                                                                 //
@@ -9,33 +10,110 @@
 
 #include "PRadEvioParser.h"
 #include "PRadDataHandler.h"
+#include "PRadEventPipeline.h"
+#include "PRadEvioIndex.h"
 #include "ConfigParser.h"
 #include <sstream>
 #include <iostream>
 #include <iomanip>
-
-#ifdef MULTI_THREAD
-#include <thread>
-#endif
+#include <cstdio>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 #define HEADER_SIZE 2
 #define MAX_BUFFER_SIZE 100000
-#define ROC_THREAD_THRES 5000
 
 using namespace std;
 
 PRadEvioParser::PRadEvioParser(PRadDataHandler *handler)
-: myHandler(handler), c_parser(new ConfigParser()), event_number(0)
+: myHandler(handler), c_parser(new ConfigParser()), pipeline(nullptr),
+  index(new PRadEvioIndex()), event_data(nullptr), event_number(0), mmap_mode(true)
 {
 }
 
 PRadEvioParser::~PRadEvioParser()
 {
     delete c_parser;
+    delete index;
 }
 
-// Simple binary reading for evio format files
+// read evio format files, memory mapped reading is preferred and the stream
+// reading is used as a fallback when the file cannot be mapped
 void PRadEvioParser::ReadEvioFile(const char *filepath, const int &evt, const bool &verbose)
+{
+    if(mmap_mode && readEvioMMap(filepath, evt, verbose))
+        return;
+
+    readEvioStream(filepath, evt, verbose);
+}
+
+// map the whole file into memory and walk through the blocks in place
+// there is no copy of the data and no limit on the block size
+// return false if the file cannot be mapped
+bool PRadEvioParser::readEvioMMap(const char *filepath, const int &evt, const bool &verbose)
+{
+    int fd = open(filepath, O_RDONLY);
+
+    if(fd < 0)
+        return false;
+
+    struct stat file_stat;
+    if(fstat(fd, &file_stat) < 0 || file_stat.st_size <= 0) {
+        close(fd);
+        return false;
+    }
+
+    size_t length = (size_t)file_stat.st_size;
+    void *mapped = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    // the mapping stays valid after the file descriptor is closed
+    close(fd);
+
+    if(mapped == MAP_FAILED)
+        return false;
+
+    // blocks are accessed sequentially, let the kernel read ahead aggressively
+    madvise(mapped, length, MADV_SEQUENTIAL);
+
+    if(verbose) {
+        cout << "Reading evio file " << filepath
+             << " (memory mapped)" << endl;
+    }
+
+    const uint32_t *buffer = (const uint32_t*) mapped;
+    size_t total_words = length/sizeof(uint32_t);
+    size_t index = 0;
+    int count = 0;
+
+    while(index < total_words)
+    {
+        try {
+            count += parseEvioBlock(&buffer[index], total_words - index);
+        } catch (PRadException &e) {
+            cerr << e.FailureType() << ": "
+                 << e.FailureDesc() << endl;
+            cerr << "Abort reading from file " << filepath << endl;
+            break;
+        }
+
+        index += buffer[index];
+
+        if(evt > 0 && count >= evt)
+            break;
+    }
+
+    // events in the pipeline are still pointing to the mapped memory
+    if(pipeline)
+        pipeline->Wait();
+
+    munmap(mapped, length);
+
+    return true;
+}
+
+// Simple binary reading for evio format files
+void PRadEvioParser::readEvioStream(const char *filepath, const int &evt, const bool &verbose)
 {
     ifstream evio_in(filepath, ios::binary | ios::in);
 
@@ -67,21 +145,163 @@ void PRadEvioParser::ReadEvioFile(const char *filepath, const int &evt, const bo
             break;
         }
 
+        // the buffer will be reused for the next block
+        if(pipeline)
+            pipeline->Wait();
+
         if(evt > 0 && count >= evt)
             break;
     }
 
+    if(pipeline)
+        pipeline->Wait();
+
     delete [] buffer;
 
     evio_in.close();
 }
 
-int PRadEvioParser::getEvioBlock(ifstream &in, uint32_t *buf) throw(PRadException)
+// read the event with event number ev from evio file
+// the file position is found from the event index, which is loaded from the
+// sidecar file or built by scanning the file at the first access, an index
+// that does not match the file is rebuilt once
+// return the number of events read
+int PRadEvioParser::ReadEvent(const char *filepath, const int &ev)
 {
-#define CODA_BLOCK_SIZE 8
+    int count = 0;
+    for(int attempt = 0; attempt < 2; ++attempt)
+    {
+        if(!index->Open(filepath))
+            return 0;
+
+        int entry = index->FindEntry(ev);
+        if(entry < 0) {
+            cerr << "Cannot find event " << ev << " in evio file " << filepath << endl;
+            return 0;
+        }
+
+        if(readIndexedEvents(filepath, entry, entry + 1, count) || count > 0)
+            break;
+    }
+
+    return count;
+}
+
+// read all the events (including epics events) with event number in
+// [first, last] from evio file, return the number of events read
+int PRadEvioParser::ReadRange(const char *filepath, const int &first, const int &last)
+{
+    int count = 0;
+    for(int attempt = 0; attempt < 2; ++attempt)
+    {
+        if(!index->Open(filepath))
+            return 0;
+
+        size_t begin = index->LowerBound(first);
+        size_t end = index->LowerBound(last + 1);
+
+        // only retry if no event was parsed with the outdated index
+        if(readIndexedEvents(filepath, begin, end, count) || count > 0)
+            break;
+    }
+
+    return count;
+}
+
+// only update the epics values of the handler from the epics events in evio
+// file, the other events are skipped with the event index and the handler is
+// not informed of any event
+// return the number of epics events read
+int PRadEvioParser::ReadEPICS(const char *filepath)
+{
+    int count = 0;
+    for(int attempt = 0; attempt < 2; ++attempt)
+    {
+        // the index is not saved, the file is only scanned once
+        if(!index->Open(filepath, false))
+            return 0;
+
+        if(readIndexedEvents(filepath, 0, index->GetSize(), count, true) || count > 0)
+            break;
+    }
+
+    return count;
+}
+
+// read the events in index entries [begin, end), count is the number of
+// events read, only the epics banks of the epics events are read if
+// epics_only is true
+// every entry is checked against the file before it is parsed, if one does
+// not match, the index and its sidecar file are discarded so the next Open
+// rebuilds it, and false is returned
+bool PRadEvioParser::readIndexedEvents(const char *filepath,
+                                       const size_t &begin,
+                                       const size_t &end,
+                                       int &count,
+                                       const bool &epics_only)
+{
+    count = 0;
+    ifstream evio_in(filepath, ios::binary | ios::in);
+
+    if(!evio_in.is_open()) {
+        cerr << "Cannot open evio file " << filepath << endl;
+        return true;
+    }
+
+    const vector<PRadEvioIndex::Entry> &entries = index->GetEntries();
+    uint64_t file_size = index->GetFileSize();
+    vector<uint32_t> buffer;
+
+    for(size_t i = begin; i < end && i < entries.size(); ++i)
+    {
+        if(epics_only && entries[i].tag != EPICS_Info)
+            continue;
 
+        uint64_t offset = entries[i].offset;
+        uint32_t length = 0;
+        evio_in.seekg(offset);
+        evio_in.read((char*) &length, sizeof(length));
+
+        // the event should be in the file and have the indexed tag
+        bool valid = evio_in.good() &&
+                     evio_in.gcount() == sizeof(length) &&
+                     offset + ((uint64_t)length + 1)*sizeof(uint32_t) <= file_size &&
+                     length >= 1;
+
+        if(valid) {
+            buffer.resize(length + 1);
+            buffer[0] = length;
+            evio_in.read((char*) &buffer[1], length*sizeof(uint32_t));
+            valid = evio_in.good() &&
+                    ((PRadEventHeader *) &buffer[0])->tag == entries[i].tag;
+        }
+
+        if(!valid) {
+            cerr << "Event at offset " << offset << " does not match the index of "
+                 << filepath << ", the index is outdated and will be rebuilt." << endl;
+            index->Clear();
+            remove(PRadEvioIndex::SidecarPath(filepath).c_str());
+            return false;
+        }
+
+        if(epics_only) {
+            parseEPICSEvent((PRadEventHeader *) &buffer[0]);
+            ++count;
+            continue;
+        }
+
+        // epics event does not have event number
+        event_number = entries[i].event_number;
+        ParseEventByHeader((PRadEventHeader *) &buffer[0]);
+        ++count;
+    }
+
+    return true;
+}
+
+int PRadEvioParser::getEvioBlock(ifstream &in, uint32_t *buf) throw(PRadException)
+{
     streamsize buf_size = sizeof(uint32_t);
-    int buffer_cnt = 0;
 
     // read the block size
     in.read((char*) &buf[0], buf_size);
@@ -94,11 +314,32 @@ int PRadEvioParser::getEvioBlock(ifstream &in, uint32_t *buf) throw(PRadExceptio
     // read the whole block in
     in.read((char*) &buf[1], buf_size * (buf[0] - 1));
 
+    return parseEvioBlock(buf, buf[0]);
+}
+
+// parse all the events in a CODA block, max_size is the number of words
+// that are available in the buffer
+int PRadEvioParser::parseEvioBlock(const uint32_t *buf, const size_t &max_size) throw(PRadException)
+{
+#define CODA_BLOCK_SIZE 8
+
+    if(buf[0] < CODA_BLOCK_SIZE || buf[0] > max_size)
+    {
+        throw PRadException("Read Evio Block", "corrupted block with size " + to_string(buf[0])
+                            + ", while " + to_string(max_size) + " words are available");
+    }
+
+    int buffer_cnt = 0;
     size_t index = CODA_BLOCK_SIZE; // strip off block header
 
     while(index < buf[0])
     {
-        ParseEventByHeader((PRadEventHeader *) &buf[index]);
+        if(index + buf[index] + 1 > buf[0])
+        {
+            throw PRadException("Read Evio Block", "event (size " + to_string(buf[index])
+                                + ") exceeds the block boundary");
+        }
+        dispatchEvent((PRadEventHeader *) &buf[index]);
         index += buf[index] + 1;
         buffer_cnt++;
     }
@@ -106,6 +347,15 @@ int PRadEvioParser::getEvioBlock(ifstream &in, uint32_t *buf) throw(PRadExceptio
     return  buffer_cnt;
 }
 
+// send the event to the decoding pipeline if there is one
+void PRadEvioParser::dispatchEvent(PRadEventHeader *header)
+{
+    if(pipeline)
+        pipeline->Submit(header);
+    else
+        ParseEventByHeader(header);
+}
+
 void PRadEvioParser::ParseEventByHeader(PRadEventHeader *header)
 {
     // first check event type
@@ -122,34 +372,56 @@ void PRadEvioParser::ParseEventByHeader(PRadEventHeader *header)
         return; // not interested event type
     }
 
-    myHandler->StartofNewEvent(header->tag);
+    event_data = myHandler->StartofNewEvent(header->tag);
 
     uint32_t buf_size = header->length - 1;
     uint32_t *buf = (uint32_t*) &header[1]; // skip current header
     uint32_t index = 0;
 
-#ifdef MULTI_THREAD
-    vector<thread> roc_threads;
-#endif
-
     while(index < buf_size)
     {
-#ifdef MULTI_THREAD
-        if(buf[index] > ROC_THREAD_THRES)
-            roc_threads.emplace_back(&PRadEvioParser::parseROCBank, this, (PRadEventHeader *)&buf[index]);
-        else
-#endif
         parseROCBank((PRadEventHeader *)&buf[index]);
         index += buf[index] + 1;
     }
 
-#ifdef MULTI_THREAD
-    for(auto &roc : roc_threads)
+    feedGEMFrames();
+    myHandler->EndofThisEvent(event_number); // inform handler the end of event
+}
+
+// decode the event into the given container, used by the decoding pipeline
+// it does not inform the handler about the event start and end, and all the
+// banks are parsed in the calling thread
+// the event number is set to -1 if the event does not have the info bank
+// return false if it is not an interested event type
+bool PRadEvioParser::DecodeEvent(PRadEventHeader *header, EventData &data)
+{
+    switch(header->tag)
+    {
+    case CODA_Event:
+    case CODA_Sync:
+    case EPICS_Info:
+        break;
+    default:
+        return false;
+    }
+
+    data.initialize(header->tag);
+    data.event_number = -1;
+    data.timestamp = 0;
+    event_data = &data;
+
+    uint32_t buf_size = header->length - 1;
+    uint32_t *buf = (uint32_t*) &header[1];
+    uint32_t index = 0;
+
+    while(index < buf_size)
     {
-        if(roc.joinable()) roc.join();
+        parseROCBank((PRadEventHeader *)&buf[index]);
+        index += buf[index] + 1;
     }
-#endif
-    myHandler->EndofThisEvent(event_number); // inform handler the end of event
+
+    feedGEMFrames();
+    return true;
 }
 
 void PRadEvioParser::parseROCBank(PRadEventHeader *roc_header)
@@ -169,6 +441,7 @@ void PRadEvioParser::parseROCBank(PRadEventHeader *roc_header)
         break; // Interested in ROCs, to next header
     case EVINFO_BANK: // special bank
         event_number = buf[0]; // then skip
+        event_data->event_number = buf[0];
     default: // unrecognized ROC, skip
         return;
     }
@@ -249,7 +522,7 @@ void PRadEvioParser::parseADC1881M(const uint32_t *data)
             if(((data[index]>>27)&0x1F) == (unsigned int)adcData.config.slot) {
                 adcData.config.channel = (data[index]>>17)&0x3F;
                 adcData.val = data[index]&0x3FFF;
-                myHandler->FeedData(adcData); // feed data to handler
+                myHandler->FeedData(adcData, *event_data); // feed data to handler
             } else { // show the error message
                 cerr << "*** MISMATCHED CRATE ADDRESS ***" << endl;
                 cerr << "GEOGRAPHICAL ADDRESS = "
@@ -291,7 +564,8 @@ void PRadEvioParser::parseGEMData(const uint32_t *data, const size_t &size,  con
             gemData.buf = &data[i+2];
             gemData.size = getAPVDataSize(gemData.buf);
 
-            myHandler->FeedData(gemData);
+            // the frames are processed together at the end of event
+            gem_frames.push_back(gemData);
 
             i += gemData.size;
         } else {
@@ -300,6 +574,17 @@ void PRadEvioParser::parseGEMData(const uint32_t *data, const size_t &size,  con
     }
 }
 
+// feed the raw GEM frames collected from the event, the handler processes
+// the frames from different FECs in parallel
+void PRadEvioParser::feedGEMFrames()
+{
+    if(gem_frames.empty())
+        return;
+
+    myHandler->FeedData(gem_frames, *event_data);
+    gem_frames.clear();
+}
+
 void PRadEvioParser::parseGEMZeroSupData(const uint32_t *data, const size_t &size)
 {
     // hit structure (32 bit word)
@@ -332,7 +617,7 @@ void PRadEvioParser::parseGEMZeroSupData(const uint32_t *data, const size_t &siz
         gemDataPack.push_back(gemData);
     }
 
-    myHandler->FeedData(gemDataPack);
+    myHandler->FeedData(gemDataPack, *event_data);
 }
 
 size_t PRadEvioParser::getAPVDataSize(const uint32_t *data)
@@ -380,7 +665,7 @@ void PRadEvioParser::parseTDCV767(const uint32_t *data, const size_t &size, cons
         }
         tdcData.config.channel = (data[i]>>24)&0x7f;
         tdcData.val = data[i]&0xfffff;
-        myHandler->FeedData(tdcData);
+        myHandler->FeedData(tdcData, *event_data);
     }
 }
 
@@ -404,7 +689,7 @@ void PRadEvioParser::parseTDCV1190(const uint32_t *data, const size_t &size, con
         case V1190_TDC_MEASURE:
             tdcData.config.channel = (data[i]>>19)&0x7f;
             tdcData.val = (data[i]&0x7ffff);
-            myHandler->FeedData(tdcData);
+            myHandler->FeedData(tdcData, *event_data);
             break;
         case V1190_TDC_ERROR:
 /*
@@ -438,13 +723,13 @@ void PRadEvioParser::parseDSCData(const uint32_t *data, const size_t &size)
     dscData.gated_buf = &data[GATED_TRG_GROUP];
     dscData.ungated_buf = &data[UNGATED_TRG_GROUP];
 
-    myHandler->FeedData(dscData);
+    myHandler->FeedData(dscData, *event_data);
 }
 
 void PRadEvioParser::parseTIData(const uint32_t *data, const size_t &size, const int &roc_id)
 {
     // update trigger type
-    myHandler->UpdateTrgType(bit_to_trigger(data[2]>>24));
+    myHandler->UpdateTrgType(bit_to_trigger(data[2]>>24), *event_data);
 
     if(roc_id == PRadTS) {// we will be more interested in the TI-master
         // check block header first
@@ -465,7 +750,30 @@ void PRadEvioParser::parseTIData(const uint32_t *data, const size_t &size, const
         tiData.time_high = data[5] & 0xffff;
         tiData.latch_word = data[6] & 0xff;
         tiData.lms_phase = (data[8] >> 16) & 0xff;
-        myHandler->FeedData(tiData);
+        myHandler->FeedData(tiData, *event_data);
+    }
+}
+
+// read the epics banks in the epics event without starting a new event
+void PRadEvioParser::parseEPICSEvent(PRadEventHeader *header)
+{
+    uint32_t buf_size = header->length - 1;
+    uint32_t *buf = (uint32_t*) &header[1]; // skip current header
+
+    for(uint32_t index = 0; index < buf_size; index += buf[index] + 1)
+    {
+        PRadEventHeader *roc_header = (PRadEventHeader *) &buf[index];
+        if(roc_header->tag != EPICS_IOC)
+            continue;
+
+        uint32_t roc_size = roc_header->length - 1;
+        uint32_t *roc_buf = (uint32_t*) &roc_header[1];
+        for(uint32_t j = 0; j < roc_size; j += roc_buf[j] + 1)
+        {
+            PRadEventHeader *data_header = (PRadEventHeader *) &roc_buf[j];
+            if(data_header->tag == EPICS_BANK)
+                parseEPICS((const uint32_t*) &data_header[1]);
+        }
     }
 }
 
@@ -9,6 +9,7 @@
 
 #include <iostream>
 #include <iomanip>
+#include <cmath>
 #include "PRadGEMPlane.h"
 #include "PRadGEMAPV.h"
 #include "TF1.h"
@@ -22,8 +23,12 @@ PRadGEMAPV::PRadGEMAPV(const int &f,
                        const int &hl,
                        const std::string &s)
 : plane(nullptr), fec_id(f), adc_ch(ch), orientation(o),
-  plane_index(idx), header_level(hl), status(s)
+  plane_index(idx), header_level(hl), status(s),
+  common_thres(20.), zerosup_thres(5.)
 {
+    static_assert(TIME_SAMPLE_SIZE == APV_KERNEL_CHANNELS,
+                  "APV kernel must have the same number of channels as APV");
+
 #define DEFAULT_MAX_CHANNEL 550
     // initialize
     buffer_size = DEFAULT_MAX_CHANNEL;
@@ -42,6 +47,7 @@ PRadGEMAPV::PRadGEMAPV(const int &f,
         split = false;
 
     ClearData();
+    updateKernelTables();
 }
 
 PRadGEMAPV::~PRadGEMAPV()
@@ -135,12 +141,16 @@ void PRadGEMAPV::ClearPedestal()
 {
     for(size_t i = 0; i < TIME_SAMPLE_SIZE; ++i)
         pedestal[i] = Pedestal(0, 0);
+
+    updateKernelTables();
 }
 
 void PRadGEMAPV::UpdatePedestal(std::vector<Pedestal> &ped)
 {
     for(size_t i = 0; (i < ped.size()) && (i < TIME_SAMPLE_SIZE); ++i)
         pedestal[i] = ped[i];
+
+    updateKernelTables();
 }
 
 void PRadGEMAPV::UpdatePedestal(const Pedestal &ped, const size_t &index)
@@ -149,6 +159,8 @@ void PRadGEMAPV::UpdatePedestal(const Pedestal &ped, const size_t &index)
         return;
 
     pedestal[index] = ped;
+
+    updateKernelTables();
 }
 
 void PRadGEMAPV::UpdatePedestal(const float &offset, const float &noise, const size_t &index)
@@ -158,6 +170,8 @@ void PRadGEMAPV::UpdatePedestal(const float &offset, const float &noise, const s
 
     pedestal[index].offset = offset;
     pedestal[index].noise = noise;
+
+    updateKernelTables();
 }
 
 void PRadGEMAPV::FillRawData(const uint32_t *buf, const size_t &size)
@@ -169,10 +183,8 @@ void PRadGEMAPV::FillRawData(const uint32_t *buf, const size_t &size)
         return;
     }
 
-    for(size_t i = 0; i < size; ++i)
-    {
-        SplitData(buf[i], raw_data[2*i], raw_data[2*i+1]);
-    }
+    // vectorized, same as SplitData for each word
+    PRadAPVKernel::SplitData(buf, size, raw_data);
 
     ts_index = GetTimeSampleStart();
 }
@@ -195,7 +207,7 @@ void PRadGEMAPV::FillZeroSupData(const size_t &ch, const size_t &ts, const unsig
     raw_data[idx] = val;
 }
 
-void PRadGEMAPV::FillZeroSupData(const size_t &ch, const std::vector<float> &vals)
+void PRadGEMAPV::FillZeroSupData(const size_t &ch, const ArrayView<float> &vals)
 {
     if(vals.size() != time_samples || ch >= TIME_SAMPLE_SIZE)
     {
@@ -302,15 +314,13 @@ void PRadGEMAPV::FitPedestal()
     }
 }
 
+// the time samples start after the header, which begins with 3 consecutive
+// samples below the header level
 size_t PRadGEMAPV::GetTimeSampleStart()
 {
-    for(size_t i = 2; i < buffer_size; ++i)
-    { 
-        if( (raw_data[i]   < header_level) &&
-            (raw_data[i-1] < header_level) &&
-            (raw_data[i-2] < header_level) )
-            return i + 10;
-    }
+    size_t i = PRadAPVKernel::FindHeader(raw_data, buffer_size, header_level);
+    if(i < buffer_size)
+        return i + 10;
 
     return buffer_size;
 }
@@ -336,29 +346,14 @@ void PRadGEMAPV::ZeroSuppression()
         return;
     }
 
-    // common mode correction
-    for(size_t ts = 0; ts < time_samples; ++ts)
-    {
-        if(split)
-            CommonModeCorrection_Split(&raw_data[ts_index + ts*TIME_SAMPLE_DIFF], TIME_SAMPLE_SIZE);
-        else
-            CommonModeCorrection(&raw_data[ts_index + ts*TIME_SAMPLE_DIFF], TIME_SAMPLE_SIZE);
-    }
-
-    for(size_t i = 0; i < TIME_SAMPLE_SIZE; ++i)
-    {
-        float average = 0.;
-        for(size_t j = 0; j < time_samples; ++j)
-        {
-            average += raw_data[i + ts_index + j*TIME_SAMPLE_DIFF];
-        }
-        average /= time_samples;
-
-        if(average > pedestal[i].noise * zerosup_thres)
-            hit_pos[i] = true;
-        else
-            hit_pos[i] = false;
-    }
+    // common mode correction and zero suppression, it is vectorized and gives
+    // the same results as CommonModeCorrection(_Split) and the threshold on
+    // the time sample average
+    PRadAPVKernel::ZeroSuppression(kernel_tables,
+                                   &raw_data[ts_index],
+                                   TIME_SAMPLE_DIFF,
+                                   time_samples,
+                                   hit_pos);
 }
 
 void PRadGEMAPV::CollectZeroSupHits(std::vector<GEM_Data> &hits)
@@ -368,12 +363,13 @@ void PRadGEMAPV::CollectZeroSupHits(std::vector<GEM_Data> &hits)
         if(hit_pos[i] == false)
             continue;
 
-        GEM_Data hit(fec_id, adc_ch, i);
+        // fill the hit in place, the samples are stored inline
+        hits.emplace_back(fec_id, adc_ch, i);
+        GEM_Data &hit = hits.back();
         for(size_t j = 0; j < time_samples; ++j)
         {
             hit.values.emplace_back(raw_data[i + ts_index + j*TIME_SAMPLE_DIFF]);
         }
-        hits.emplace_back(hit);
     }
 }
 
@@ -387,7 +383,7 @@ void PRadGEMAPV::CollectZeroSupHits()
         if(hit_pos[i] == false)
             continue;
 
-        std::vector<float> charges;
+        GEMSamples charges;
         for(size_t j = 0; j < time_samples; ++j)
         {
             charges.push_back(raw_data[i + ts_index + j*TIME_SAMPLE_DIFF]);
@@ -464,6 +460,38 @@ void PRadGEMAPV::BuildStripMap()
     {
         strip_map[i] = MapStrip(i);
     }
+
+    // split mode groups the channels by the local strip number
+    updateKernelTables();
+}
+
+// the pedestal and thresholds in structure of arrays for the zero suppression
+// kernel, they are the same values compared in the scalar common mode
+// correction and zero suppression
+void PRadGEMAPV::updateKernelTables()
+{
+    kernel_tables.split = split;
+
+    for(size_t i = 0; i < TIME_SAMPLE_SIZE; ++i)
+    {
+        kernel_tables.offset[i] = pedestal[i].offset;
+        kernel_tables.zs_thres[i] = pedestal[i].noise * zerosup_thres;
+
+        // the first group in split mode is compared with a 10 times higher
+        // threshold in double precision, use the smallest float not less than
+        // the double threshold so the float comparison gives the same result
+        if(split && plane != nullptr && strip_map[i].local < 16) {
+            double thres = pedestal[i].noise * common_thres * 10.;
+            float fthres = (float)thres;
+            if(fthres < thres)
+                fthres = std::nextafter(fthres, INFINITY);
+            kernel_tables.cm_thres[i] = fthres;
+            kernel_tables.group[i] = -1;
+        } else {
+            kernel_tables.cm_thres[i] = pedestal[i].noise * common_thres;
+            kernel_tables.group[i] = 0;
+        }
+    }
 }
 
 int PRadGEMAPV::GetLocalStripNb(const size_t &ch)
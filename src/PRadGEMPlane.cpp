@@ -116,17 +116,17 @@ double PRadGEMPlane::GetStripPosition(const int &plane_strip)
         return -0.5*(size - pitch) + pitch*plane_strip;
 }
 
-double PRadGEMPlane::GetMaxCharge(const std::vector<float> &charges)
+double PRadGEMPlane::GetMaxCharge(const ArrayView<float> &charges)
 {
     if(!charges.size())
         return 0.;
 
-    double result = charges.at(0);
+    double result = charges[0];
 
     for(size_t i = 1; i < charges.size(); ++i)
     {
-        if(result < charges.at(i))
-            result = charges.at(i);
+        if(result < charges[i])
+            result = charges[i];
     }
 
     return result;
@@ -147,7 +147,7 @@ void PRadGEMPlane::ClearPlaneHits()
     hit_list.clear();
 }
 
-void PRadGEMPlane::AddPlaneHit(const int &plane_strip, const std::vector<float> &charges)
+void PRadGEMPlane::AddPlaneHit(const int &plane_strip, const ArrayView<float> &charges)
 {
     // X plane needs to remove 16 strips at both ends
     // This is a special setup for PRad GEMs, so not configurable
@@ -23,6 +23,7 @@
 using namespace std;
 
 PRadGEMSystem::PRadGEMSystem(const std::string &config_file)
+: PedestalMode(false), thread_pool(nullptr)
 {
     if(!config_file.empty())
         LoadConfiguration(config_file);
@@ -51,6 +52,7 @@ void PRadGEMSystem::Clear()
     fec_list.clear();
     fec_map.clear();
     apv_map.clear();
+    apv_table.Clear();
 }
 
 void PRadGEMSystem::LoadConfiguration(const string &path) throw(PRadException)
@@ -263,11 +265,13 @@ void PRadGEMSystem::RegisterAPV(const string &plane_name, PRadGEMAPV *apv)
     fec->AddAPV(apv);
 
     apv_map[apv->GetAddress()] = apv;
+    apv_table.Set(apv->GetAddress(), apv);
 }
 
 void PRadGEMSystem::BuildAPVMap()
 {
     apv_map.clear();
+    apv_table.Clear();
 
     for(auto &fec : fec_list)
     {
@@ -275,6 +279,7 @@ void PRadGEMSystem::BuildAPVMap()
         for(auto &apv : apv_list)
         {
             apv_map[apv->GetAddress()] = apv;
+            apv_table.Set(apv->GetAddress(), apv);
         }
     }
 }
@@ -325,13 +330,12 @@ PRadGEMAPV *PRadGEMSystem::GetAPV(const int &fec_id, const int &apv_id)
 
 PRadGEMAPV *PRadGEMSystem::GetAPV(const GEMChannelAddress &addr)
 {
-    auto it = apv_map.find(addr);
-    if(it == apv_map.end()) {
+    PRadGEMAPV *apv = apv_table.Get(addr);
+    if(apv == nullptr) {
         cerr << "GEM System: Cannot find APV with id " << addr.adc_ch
              << " in FEC " << addr.fec_id << endl;
-        return nullptr;
     }
-    return it->second;
+    return apv;
 }
 
 void PRadGEMSystem::ClearAPVData()
@@ -344,10 +348,13 @@ void PRadGEMSystem::ClearAPVData()
 
 void PRadGEMSystem::FillRawData(GEMRawData &raw, vector<GEM_Data> &container, const bool &fill_hist)
 {
-    auto it = apv_map.find(raw.addr);
-    if(it != apv_map.end())
+    PRadGEMAPV *apv = apv_table.Get(raw.addr);
+    if(apv != nullptr)
     {
-        PRadGEMAPV *apv = it->second;
+#ifdef MULTI_THREAD
+        // the same apv may be filled by events decoded in parallel
+        std::lock_guard<std::mutex> apv_lock(apv->GetLocker());
+#endif
         apv->FillRawData(raw.buf, raw.size);
 
         if(fill_hist) {
@@ -355,17 +362,75 @@ void PRadGEMSystem::FillRawData(GEMRawData &raw, vector<GEM_Data> &container, co
                 apv->FillPedHist();
         } else {
             apv->ZeroSuppression();
-#ifdef MULTI_THREAD
-            locker.lock();
-#endif
             apv->CollectZeroSupHits(container);
-#ifdef MULTI_THREAD
-            locker.unlock();
-#endif
         }
     }
 }
 
+// fill the raw APV frames of an event
+// the frames are grouped by FEC and the groups are processed by the thread
+// pool, each group writes its hits to its own buffer, and the buffers are
+// appended to the container in the frame order after all groups are done,
+// so the container needs no lock and the hit order does not depend on threads
+void PRadGEMSystem::FillRawData(vector<GEMRawData> &frames,
+                                vector<GEM_Data> &container,
+                                const bool &fill_hist)
+{
+    if(frames.empty())
+        return;
+
+    // buffers are kept between events to avoid re-allocation
+    static thread_local vector<size_t> group_begin;
+    static thread_local vector<vector<GEM_Data>> group_hits;
+    // the tasks run in other threads, refer to the buffers of this thread
+    vector<size_t> &begin = group_begin;
+    vector<vector<GEM_Data>> &hits = group_hits;
+
+    // frames from the same FEC are consecutive in the raw bank
+    begin.clear();
+    for(size_t i = 0; i < frames.size(); ++i)
+    {
+        if(i == 0 || frames[i].addr.fec_id != frames[i - 1].addr.fec_id)
+            begin.push_back(i);
+    }
+    begin.push_back(frames.size());
+
+    size_t n_groups = begin.size() - 1;
+    if(hits.size() < n_groups)
+        hits.resize(n_groups);
+
+    auto fill_group = [&] (const size_t &g)
+    {
+        vector<GEM_Data> &buffer = hits[g];
+        buffer.clear();
+        buffer.reserve((begin[g + 1] - begin[g])*TIME_SAMPLE_SIZE);
+        for(size_t i = begin[g]; i < begin[g + 1]; ++i)
+            FillRawData(frames[i], buffer, fill_hist);
+    };
+
+    if(thread_pool) {
+        thread_pool->ParallelFor(n_groups, fill_group, "GEM FEC");
+    } else {
+        for(size_t g = 0; g < n_groups; ++g)
+            fill_group(g);
+    }
+
+    if(fill_hist)
+        return;
+
+    // merge the hits
+    size_t total = container.size();
+    for(size_t g = 0; g < n_groups; ++g)
+        total += hits[g].size();
+    container.reserve(total);
+
+    for(size_t g = 0; g < n_groups; ++g)
+    {
+        for(auto &hit : hits[g])
+            container.emplace_back(move(hit));
+    }
+}
+
 void PRadGEMSystem::FillZeroSupData(std::vector<GEMZeroSupData> &data_pack,
                                     std::vector<GEM_Data> &container)
 {
@@ -388,13 +453,26 @@ void PRadGEMSystem::FillZeroSupData(std::vector<GEMZeroSupData> &data_pack,
 
 void PRadGEMSystem::FillZeroSupData(GEMZeroSupData &data)
 {
-    auto it = apv_map.find(data.addr);
-    if(it != apv_map.end()) {
-        it->second->FillZeroSupData(data.channel, data.time_sample, data.adc_value);
+    PRadGEMAPV *apv = apv_table.Get(data.addr);
+    if(apv != nullptr) {
+        apv->FillZeroSupData(data.channel, data.time_sample, data.adc_value);
     }
 }
 
+// the event data and the event view from the mapped DST share the same
+// reconstruction code
 void PRadGEMSystem::ChooseEvent(const EventData &data)
+{
+    chooseEvent(data);
+}
+
+void PRadGEMSystem::ChooseEvent(const EventView &data)
+{
+    chooseEvent(data);
+}
+
+template<typename T>
+void PRadGEMSystem::chooseEvent(const T &data)
 {
     // clear all the APVs' hits
     for(auto &fec : fec_list)
@@ -402,7 +480,7 @@ void PRadGEMSystem::ChooseEvent(const EventData &data)
         fec->ClearAPVData();
     }
 
-    for(auto &hit : data.gem_data)
+    for(const auto &hit : data.gem_data)
     {
         auto apv = GetAPV(hit.addr.fec, hit.addr.adc);
         if(apv)
@@ -411,6 +489,17 @@ void PRadGEMSystem::ChooseEvent(const EventData &data)
 }
 
 void PRadGEMSystem::Reconstruct(const EventData &data)
+{
+    reconstruct(data);
+}
+
+void PRadGEMSystem::Reconstruct(const EventView &data)
+{
+    reconstruct(data);
+}
+
+template<typename T>
+void PRadGEMSystem::reconstruct(const T &data)
 {
     // only reconstruct physics event
     if(!data.is_physics_event())
@@ -436,7 +525,7 @@ void PRadGEMSystem::Reconstruct(const EventData &data)
     }
 
     // add the hits from event data
-    for(auto &hit : data.gem_data)
+    for(const auto &hit : data.gem_data)
     {
         auto apv = GetAPV(hit.addr.fec, hit.addr.adc);
         if(apv == nullptr)
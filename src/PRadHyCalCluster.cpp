@@ -9,12 +9,13 @@
 #include <cmath>
 #include <iostream>
 #include <iomanip>
+#include <algorithm>
 #include "PRadHyCalCluster.h"
 
 using namespace std;
 
 PRadHyCalCluster::PRadHyCalCluster(PRadDataHandler *h)
-: fHandler(h), fNHyCalClusters(0)
+: fHandler(h), fTableVersion(0), fNHyCalClusters(0)
 {
 }
 
@@ -25,11 +26,69 @@ PRadHyCalCluster::~PRadHyCalCluster()
 void PRadHyCalCluster::Clear()
 {
     fNHyCalClusters = 0;
+    fBlockPool.clear();
 }
 
 void PRadHyCalCluster::SetHandler(PRadDataHandler *h)
 {
     fHandler = h;
+    // the table is copied again from the new handler
+    fModuleTable.clear();
+}
+
+// copy the channel constants from handler, it is called before reconstructing
+// an event if the setup version of handler has changed
+void PRadHyCalCluster::UpdateModuleTable()
+{
+    fModuleTable.clear();
+    fModuleGrid.Clear();
+    if(fHandler == nullptr)
+        return;
+
+    size_t tdc_size = 0;
+    for(auto &channel : fHandler->GetChannelList())
+    {
+        ModuleInfo info;
+        info.hycal = channel->IsHyCalModule();
+        info.primex_id = channel->GetPrimexID();
+        info.tdc_id = (channel->GetTDCGroup() == nullptr) ? -1 : channel->GetTDCGroup()->GetID();
+        info.pedestal = channel->GetPedestal().mean;
+        info.factor = channel->GetCalibrationFactor();
+        info.geometry = channel->GetGeometry();
+        fModuleTable.push_back(info);
+
+        if(info.tdc_id >= 0)
+            tdc_size = max(tdc_size, (size_t)info.tdc_id + 1);
+    }
+
+    vector<PRadDAQUnit::Geometry> geometry;
+    for(auto &info : fModuleTable)
+        geometry.push_back(info.geometry);
+    fModuleGrid.Build(geometry);
+
+    fTimeMeasure.clear();
+    fTimeMeasure.resize(tdc_size);
+    fFiredTDC.clear();
+    fTableVersion = fHandler->GetSetupVersion();
+}
+
+// copy the table again if the channels in handler have changed
+void PRadHyCalCluster::checkModuleTable()
+{
+    if(fModuleTable.size() != fHandler->GetChannelList().size() ||
+       fTableVersion != fHandler->GetSetupVersion())
+        UpdateModuleTable();
+}
+
+// time measures of the tdc group in current event
+const vector<unsigned short> &PRadHyCalCluster::GetTimeMeasure(const int &tdc_id) const
+{
+    static const vector<unsigned short> no_time;
+
+    if(tdc_id < 0 || tdc_id >= (int)fTimeMeasure.size())
+        return no_time;
+
+    return fTimeMeasure[tdc_id];
 }
 
 void PRadHyCalCluster::ReadConfigFile(const string &path)
@@ -71,12 +130,98 @@ ConfigValue PRadHyCalCluster::GetConfigValue(const string &name,
     return it->second;
 }
 
+// copy of the method with its configuration, it is used by the independent
+// handlers in parallel processing
+PRadHyCalCluster *PRadHyCalCluster::Clone()
+{
+    return new PRadHyCalCluster(*this);
+}
+
 void PRadHyCalCluster::Configure(const string & /*path*/)
 {
     // to be implemented by methods
 }
 
-void PRadHyCalCluster::Reconstruct(EventData & /*event*/)
+// the fired modules are loaded from the event data, so the methods only need
+// to implement ReconstructModules(), the channels in handler are not changed
+// so the clones of a method can reconstruct events at the same time
+void PRadHyCalCluster::Reconstruct(EventData &event)
+{
+    Clear(); // clear all the saved buffer before analyzing the next event
+
+    // do no reconstruction for non-physics event
+    // otherwise there will be some mess from LMS events
+    if(!event.is_physics_event())
+        return;
+
+    loadEvent(event);
+    ReconstructModules();
+}
+
+void PRadHyCalCluster::Reconstruct(const EventView &event)
+{
+    Clear();
+
+    if(!event.is_physics_event())
+        return;
+
+    loadEvent(event);
+    ReconstructModules();
+}
+
+// build the hit list from the adc data, the energy is the same as
+// PRadDAQUnit::Calibration()
+template<typename T>
+void PRadHyCalCluster::loadEvent(const T &event)
+{
+    checkModuleTable();
+
+    fModuleHits.clear();
+    for(const auto &adc : event.adc_data)
+    {
+        if(adc.channel_id >= fModuleTable.size())
+            continue;
+
+        const ModuleInfo &info = fModuleTable[adc.channel_id];
+        if(!info.hycal)
+            continue;
+
+        double sub_adc = (double)adc.value - info.pedestal;
+        if(sub_adc <= 0. || sub_adc*info.factor <= 0.)
+            continue;
+
+        ModuleHit hit;
+        hit.id = adc.channel_id;
+        hit.primex_id = info.primex_id;
+        hit.tdc_id = info.tdc_id;
+        hit.energy = sub_adc*info.factor;
+        hit.x = info.geometry.x;
+        hit.y = info.geometry.y;
+        hit.type = info.geometry.type;
+        fModuleHits.push_back(hit);
+    }
+
+    // same order as the channel list
+    sort(fModuleHits.begin(), fModuleHits.end(),
+         [] (const ModuleHit &a, const ModuleHit &b) {return a.id < b.id;});
+
+    // only the groups fired in last event are cleared
+    for(auto &tdc_id : fFiredTDC)
+        fTimeMeasure[tdc_id].clear();
+    fFiredTDC.clear();
+
+    for(const auto &tdc : event.tdc_data)
+    {
+        if(tdc.channel_id >= fTimeMeasure.size())
+            continue;
+
+        if(fTimeMeasure[tdc.channel_id].empty())
+            fFiredTDC.push_back(tdc.channel_id);
+        fTimeMeasure[tdc.channel_id].push_back(tdc.value);
+    }
+}
+
+void PRadHyCalCluster::ReconstructModules()
 {
     // to be implemented by methods
 }
@@ -17,6 +17,11 @@ PRadIslandCluster::PRadIslandCluster(PRadDataHandler *h)
     fE0[0] = 2.84e-3; fE0[1] = 1.1e-3;
 }
 //________________________________________________________________
+PRadHyCalCluster *PRadIslandCluster::Clone()
+{
+    return new PRadIslandCluster(*this);
+}
+//________________________________________________________________
 void PRadIslandCluster::Configure(const std::string &c_path)
 {
     ReadConfigFile(c_path);
@@ -34,6 +39,7 @@ void PRadIslandCluster::Configure(const std::string &c_path)
     fZHyCal        = GetConfigValue("Z_HYCAL", "581.7").Float();
     fCutOffThr     = GetConfigValue("CUT_OFF_THRESHOLD", "0.01").Float();
     f2ExpFreeWeight= GetConfigValue("DOUBLE_EXP_FREE_WEIGHT", "0.4").Float();
+    BuildWeightTable();
 
     path = GetConfigValue("BLOCK_INFO_FILE", "config/blockinfo.dat");
     LoadBlockInfo(path);
@@ -49,16 +55,12 @@ void PRadIslandCluster::Configure(const std::string &c_path)
 //________________________________________________________________
 void PRadIslandCluster::LoadCrystalProfile(const std::string &path)
 {
-    char c_path[256];
-    strcpy(c_path, path.c_str());
-    load_pwo_prof_(c_path, strlen(c_path));
+    fIsland.LoadProfile(0, path);
 }
 //________________________________________________________________
 void PRadIslandCluster::LoadLeadGlassProfile(const std::string &path)
 {
-    char c_path[256];
-    strcpy(c_path, path.c_str());
-    load_lg_prof_(c_path, strlen(c_path));
+    fIsland.LoadProfile(1, path);
 }
 void PRadIslandCluster::LoadNonLinearity(const std::string &path)
 {
@@ -112,6 +114,8 @@ void PRadIslandCluster::LoadBlockInfo(const std::string &path)
 
     fclose(fp);
 
+    FindTransitionBlocks();
+
     // initialize module table
     for(int k = 0; k <= 4; ++k)
         for(int i = 1; i <= MCOL; ++i)
@@ -148,23 +152,17 @@ void PRadIslandCluster::Clear()
 {
     fNHyCalClusters = 0;
     fNClusterBlocks = 0;
+    fBlockPool.clear();
 }
 //_______________________________________________________________
-void PRadIslandCluster::Reconstruct(EventData &event)
+void PRadIslandCluster::ReconstructModules()
 {
-    //clear and get ready for the new event
-    Clear();
-
     //main function of the hycal reconstruction
+    //the event is cleared and the fired modules are loaded by PRadHyCalCluster
 
     //first load data to the hit array and ech array
     //the second array is used in the fortran island code
-
-    //if not physics event, don't reconstruct it
-    if(!event.is_physics_event())
-        return;
-
-    LoadModuleData(event);
+    LoadModuleData();
 
     //call island reconstruction of each sectors
     //HyCal has 5 sectors, 4 for lead glass one for crystal
@@ -182,70 +180,49 @@ void PRadIslandCluster::Reconstruct(EventData &event)
     FinalProcessing();
 }
 //_______________________________________________________________
-void PRadIslandCluster::LoadModuleData(EventData& event)
+void PRadIslandCluster::LoadModuleData()
 {
     //load data to hycalhit array and ech array
-    fHandler->ChooseEvent(event);
-    std::vector<PRadDAQUnit*> moduleList = fHandler->GetChannelList();
-
-    for(unsigned int i = 0; i < moduleList.size(); ++i)
+    //only the fired HyCal modules are in the hit list
+    for(auto &hit : fModuleHits)
     {
-        PRadDAQUnit* thisModule = moduleList.at(i);
-        if(!thisModule->IsHyCalModule())
-            continue;
-        if(thisModule->GetEnergy()*1e-3 < fMinHitE)
+        if(hit.energy*1e-3 < fMinHitE)
             continue;
 
-        fClusterBlock[fNClusterBlocks].e = thisModule->GetEnergy()*1e-3; //to GeV
-        fClusterBlock[fNClusterBlocks].id = thisModule->GetPrimexID();
+        fClusterBlock[fNClusterBlocks].e = hit.energy*1e-3; //to GeV
+        fClusterBlock[fNClusterBlocks].id = hit.primex_id;
         fNClusterBlocks++;
     }
 }
 //________________________________________________________________
 void PRadIslandCluster::CallIsland(int isect)
 {
-    //float xsize, ysize;
-    SET_EMIN  = fMinClusterE;   // banks->CONFIG->config->CLUSTER_ENERGY_MIN;
-    SET_EMAX  = 9.9;    // banks->CONFIG->config->CLUSTER_ENERGY_MAX;
-    SET_HMIN  = 1;      // banks->CONFIG->config->CLUSTER_MIN_HITS_NUMBER;
-    SET_MINM  = 0.01;   // banks->CONFIG->config->CLUSTER_MAX_CELL_MIN_ENERGY;
-    ZHYCAL    = fZHyCal;   // ALignment[1].al.z;
-    ISECT     = isect;
-
-    for(int icol = 1; icol <= MCOL; ++icol)
-    {
-        for(int irow = 1; irow <= MROW; ++irow)
-        {
-            ECH(icol,irow) = 0;
-            STAT_CH(icol,irow) = fModuleStatus[isect][icol-1][irow-1];
-        }
-    }
-
-    int coloffset = 0, rowoffset = 0;
+    int ncol, nrow, coloffset = 0, rowoffset = 0;
+    float xsize, ysize;
     switch(isect)
     {
     case 0:
-        NCOL = 34; NROW = 34;
-        SET_XSIZE = CRYS_SIZE_X; SET_YSIZE = CRYS_SIZE_Y;
+        ncol = 34; nrow = 34;
+        xsize = CRYS_SIZE_X; ysize = CRYS_SIZE_Y;
         break;
     case 1:
-        NCOL = 24; NROW =  6;
-        SET_XSIZE = GLASS_SIZE; SET_YSIZE = GLASS_SIZE;
+        ncol = 24; nrow =  6;
+        xsize = GLASS_SIZE; ysize = GLASS_SIZE;
         coloffset = 0, rowoffset = 0;
         break;
     case 2:
-        NCOL =  6; NROW =  24;
-        SET_XSIZE = GLASS_SIZE; SET_YSIZE = GLASS_SIZE;
+        ncol =  6; nrow =  24;
+        xsize = GLASS_SIZE; ysize = GLASS_SIZE;
         coloffset = 24, rowoffset = 0;
         break;
     case 3:
-        NCOL = 24; NROW =  6;
-        SET_XSIZE = GLASS_SIZE; SET_YSIZE = GLASS_SIZE;
+        ncol = 24; nrow =  6;
+        xsize = GLASS_SIZE; ysize = GLASS_SIZE;
         coloffset =  6, rowoffset = 24;
         break;
     case 4:
-        NCOL =  6; NROW = 24;
-        SET_XSIZE = GLASS_SIZE; SET_YSIZE = GLASS_SIZE;
+        ncol =  6; nrow = 24;
+        xsize = GLASS_SIZE; ysize = GLASS_SIZE;
         coloffset = 0, rowoffset = 6;
         break;
     default:
@@ -253,6 +230,17 @@ void PRadIslandCluster::CallIsland(int isect)
         exit(1);
     }
 
+    // the island data are in this instance, no lock is needed
+    fIsland.SetSector(isect, ncol, nrow, xsize, ysize);
+
+    for(int icol = 1; icol <= MCOL; ++icol)
+    {
+        for(int irow = 1; irow <= MROW; ++irow)
+        {
+            fIsland.SetStatus(icol, irow, fModuleStatus[isect][icol-1][irow-1]);
+        }
+    }
+
     for(int i = 0; i < fNClusterBlocks; ++i)
     {
         int id  = fClusterBlock[i].id;
@@ -265,21 +253,22 @@ void PRadIslandCluster::CallIsland(int isect)
 
         int column, row;
         if(id > 1000) {
-            column = (id-1001)%NCOL+1;
-            row    = (id-1001)/NROW+1;
+            column = (id-1001)%ncol+1;
+            row    = (id-1001)/nrow+1;
         } else {
-            column = (id-1)%(NCOL+NROW)+1-coloffset;
-            row    = (id-1)/(NCOL+NROW)+1-rowoffset;
+            column = (id-1)%(ncol+nrow)+1-coloffset;
+            row    = (id-1)/(ncol+nrow)+1-rowoffset;
         }
 
-        ECH(column,row) = int(e*1.e4+0.5);
+        fIsland.SetEnergy(column, row, int(e*1.e4+0.5));
         ich[column-1][row-1] = id;
     }
 
-    main_island_();
+    int ngamma = fIsland.Reconstruct();
 
-    for(int k = 0; k < adcgam_cbk_.nadcgam; ++k)
+    for(int k = 0; k < ngamma; ++k)
     {
+        const PRadIslandKernel::Gamma &gamma = fIsland.GetGamma(k);
         int n = fNHyCalClusters;
 
         if(fNHyCalClusters == MAX_HCLUSTERS)
@@ -288,16 +277,16 @@ void PRadIslandCluster::CallIsland(int isect)
             return;
         }
 
-        float e     = adcgam_cbk_.u.fadcgam[k][0];
-        float x     = adcgam_cbk_.u.fadcgam[k][1];
-        float y     = adcgam_cbk_.u.fadcgam[k][2];
-        float xc    = adcgam_cbk_.u.fadcgam[k][4];
-        float yc    = adcgam_cbk_.u.fadcgam[k][5];
+        float e     = gamma.energy;
+        float x     = gamma.x;
+        float y     = gamma.y;
+        float xc    = gamma.xc;
+        float yc    = gamma.yc;
 
-        float chi2  = adcgam_cbk_.u.fadcgam[k][6];
-        int  type   = adcgam_cbk_.u.iadcgam[k][7];
-        int  dime   = adcgam_cbk_.u.iadcgam[k][8];
-        int  status = adcgam_cbk_.u.iadcgam[k][10];
+        float chi2  = gamma.chi2;
+        int  type   = gamma.type;
+        int  dime   = gamma.dime;
+        int  status = gamma.status;
         if(type >= 90)
         {
             printf("island warning: cluster with type 90+ truncated\n");
@@ -325,12 +314,12 @@ void PRadIslandCluster::CallIsland(int isect)
 
         for(int j = 0; j < (dime>MAX_CC ? MAX_CC : dime); ++j)
         {
-            int id = ICL_INDEX(k,j);
+            int id = gamma.icl_index[j];
             int kx = (id/100), ky = id%100;
             id = ich[kx-1][ky-1];
             fClusterStorage[n].id[j] = id;
 
-            float ecell = 1.e-4*(float)ICL_IENER(k,j);
+            float ecell = 1.e-4*(float)gamma.icl_iener[j];
             float xcell = fBlockINFO[id-1].x;
             float ycell = fBlockINFO[id-1].y;
 
@@ -375,7 +364,7 @@ void PRadIslandCluster::CallIsland(int isect)
                 }else{
                     fHyCalCluster[n].dz = GetShowerDepth(1,e);
                 }
-                zk = 1. / (1. + fHyCalCluster[n].dz/ZHYCAL);
+                zk = 1. / (1. + fHyCalCluster[n].dz/fZHyCal);
             }
             fHyCalCluster[n].x_log = zk*xpos/sW;
             fHyCalCluster[n].y_log = zk*ypos/sW;
@@ -395,119 +384,134 @@ void PRadIslandCluster::CallIsland(int isect)
 }
 
 //_____________________________________________________________________________
-void PRadIslandCluster::GlueTransitionClusters()
+// key of the spatial hash bin at (x, y), the bins are as large as the glue
+// range, so the cells that can be glued are in the neighboring bins
+#define GLUE_BIN_STRIDE 256
+inline int glue_bin_key(const float &x, const float &y)
 {
-
-    // find adjacent clusters and glue
-    int ngroup = 0, group_number[MAX_HCLUSTERS], group_size[MAX_HCLUSTERS],
-        group_member_list[MAX_HCLUSTERS][MAX_HCLUSTERS];
-
-    for(int i = 0; i < MAX_HCLUSTERS; ++i)
-        group_number[i] = 0;
-
-    for(int i = 0; i < fNHyCalClusters; ++i)
+    int ix = (int)floor(x/ISLAND_GLUE_RANGE) + GLUE_BIN_STRIDE/2;
+    int iy = (int)floor(y/ISLAND_GLUE_RANGE) + GLUE_BIN_STRIDE/2;
+    return ix*GLUE_BIN_STRIDE + iy;
+}
+//_____________________________________________________________________________
+void PRadIslandCluster::FindTransitionBlocks()
+{
+    //a cluster can only be glued to a cluster in another sector through the
+    //blocks close to that sector, they are found once from the block info
+    for(int i = 0; i < T_BLOCKS; ++i)
     {
-        int idi = fHyCalCluster[i].cid;
-        //float xi = fBlockINFO[idi-1].x;
-        //float yi = fBlockINFO[idi-1].y;
+        fTransitionBlock[i] = false;
+        if(fBlockINFO[i].id != i+1 || fBlockINFO[i].sector < 0 || fBlockINFO[i].sector >= MSECT)
+            continue;
 
-        for(int j = i+1; j < fNHyCalClusters; ++j)
+        for(int j = 0; j < T_BLOCKS; ++j)
         {
-            int idj = fHyCalCluster[j].cid;
-            if(fBlockINFO[idi-1].sector == fBlockINFO[idj-1].sector)
-                 continue;
-            //float xj = fBlockINFO[idj-1].x;
-            //float yj = fBlockINFO[idj-1].y;
-
-            if(ClustersMinDist(i,j))
+            if(fBlockINFO[j].id != j+1 || fBlockINFO[j].sector < 0 || fBlockINFO[j].sector >= MSECT)
                 continue;
-
-            int igr = group_number[i];
-            int jgr = group_number[j];
-
-            // create new group and put theese two clusters into it
-            if(!igr && !jgr)
-            {
-                ++ngroup;
-                group_number[i] = ngroup; group_number[j] = ngroup;
-                group_member_list[ngroup][0] = i;
-                group_member_list[ngroup][1] = j;
-                group_size[ngroup] = 2;
+            if(fBlockINFO[j].sector == fBlockINFO[i].sector)
                 continue;
-            }
-            // add jth cluster into group which ith cluster belongs to
-            if(igr && !jgr)
+
+            if(fabs(fBlockINFO[i].x - fBlockINFO[j].x) <= ISLAND_GLUE_RANGE &&
+               fabs(fBlockINFO[i].y - fBlockINFO[j].y) <= ISLAND_GLUE_RANGE)
             {
-                group_number[j] = igr;
-                group_member_list[igr][group_size[igr]] = j;
-                group_size[igr] += 1;
-                continue;
+                fTransitionBlock[i] = true;
+                break;
             }
-            // add ith cluster into group which jth cluster belongs to
-            if(!igr && jgr)
-            {
-                group_number[i] = jgr;
-                group_member_list[jgr][group_size[jgr]] = i;
-                group_size[jgr] += 1;
+        }
+    }
+}
+//_____________________________________________________________________________
+int PRadIslandCluster::GlueGroupRoot(int i)
+{
+    while(fGlueParent[i] != i)
+    {
+        fGlueParent[i] = fGlueParent[fGlueParent[i]];
+        i = fGlueParent[i];
+    }
+    return i;
+}
+//_____________________________________________________________________________
+void PRadIslandCluster::GlueTransitionClusters()
+{
+    // find adjacent clusters and glue
+    // only the cells on the transition blocks are hashed, and two clusters
+    // are compared only if they have cells in the neighboring bins
+    fGlueCells.clear();
+    for(int i = 0; i < fNHyCalClusters; ++i)
+    {
+        int dime = fHyCalCluster[i].nblocks;
+        for(int k = 0; k < (dime>MAX_CC ? MAX_CC : dime); ++k)
+        {
+            if(fClusterStorage[i].E[k] <= 0. ||
+               !fTransitionBlock[fClusterStorage[i].id[k]-1])
                 continue;
-            }
-            // add jth group to ith than discard
-            if(igr && jgr)
-            {
-                if(igr == jgr)
-                    continue; // nothing to do
 
-                int ni = group_size[igr];
-                int nj = group_size[jgr];
-
-                for(int k = 0; k < nj; ++k)
-                {
-                    group_member_list[igr][ni+k] = group_member_list[jgr][k];
-                    group_number[group_member_list[jgr][k]] = igr;
-                }
+            int key = glue_bin_key(fClusterStorage[i].x[k], fClusterStorage[i].y[k]);
+            fGlueCells.emplace_back(key, i);
+        }
+    }
+    std::sort(fGlueCells.begin(), fGlueCells.end());
+    fGlueCells.erase(std::unique(fGlueCells.begin(), fGlueCells.end()), fGlueCells.end());
+
+    // candidate pairs of clusters in different sectors, the bins before this
+    // one are not checked since the pairs there are found from the other side
+    const int bin_offsets[5] = {0, 1, GLUE_BIN_STRIDE - 1, GLUE_BIN_STRIDE, GLUE_BIN_STRIDE + 1};
+    fGluePairs.clear();
+    for(auto &cell : fGlueCells)
+    {
+        int i = cell.second;
+        int seci = fBlockINFO[fHyCalCluster[i].cid-1].sector;
 
-                group_size[igr] += nj;
-                group_size[jgr]  = 0;
-                continue;
+        for(auto &offset : bin_offsets)
+        {
+            auto it = std::lower_bound(fGlueCells.begin(), fGlueCells.end(),
+                                       std::make_pair(cell.first + offset, 0));
+            for(; it != fGlueCells.end() && it->first == cell.first + offset; ++it)
+            {
+                int j = it->second;
+                if(fBlockINFO[fHyCalCluster[j].cid-1].sector == seci)
+                    continue;
+                fGluePairs.emplace_back(std::min(i, j), std::max(i, j));
             }
         }
     }
+    std::sort(fGluePairs.begin(), fGluePairs.end());
+    fGluePairs.erase(std::unique(fGluePairs.begin(), fGluePairs.end()), fGluePairs.end());
 
-    for(int igr = 1; igr <= ngroup; ++igr)
+    // group the clusters, the root of a group is its first cluster
+    fGlueParent.resize(fNHyCalClusters);
+    for(int i = 0; i < fNHyCalClusters; ++i)
+        fGlueParent[i] = i;
+
+    for(auto &pair : fGluePairs)
     {
-        if(group_size[igr]<=0)
+        int igr = GlueGroupRoot(pair.first);
+        int jgr = GlueGroupRoot(pair.second);
+        if(igr == jgr || ClustersMinDist(pair.first, pair.second))
             continue;
-        // sort in increasing cluster number order:
-
-        int list[MAX_HCLUSTERS];
-        for(int i = 0; i < group_size[igr]; ++i)
-            list[i] = i;
 
-        for(int i = 0; i < group_size[igr]; ++i)
-            for(int j = i+1; j < group_size[igr]; ++j)
-                if(group_member_list[igr][list[j]] < group_member_list[igr][list[i]])
-                {
-                    int l   = list[i];
-                    list[i] = list[j];
-                    list[j] = l;
-                }
+        if(igr < jgr)
+            fGlueParent[jgr] = igr;
+        else
+            fGlueParent[igr] = jgr;
+    }
 
-        int i0 = group_member_list[igr][list[0]];
-        if(fHyCalCluster[i0].status == -1)
+    // glue the clusters to the first cluster of their group, in increasing
+    // cluster number order
+    for(int k0 = 0; k0 < fNHyCalClusters; ++k0)
+    {
+        int i0 = GlueGroupRoot(k0);
+        if(i0 == k0 || fHyCalCluster[i0].status == -1)
             continue;
 
-        for(int k = 1; k < group_size[igr]; ++k)
+        if(fHyCalCluster[k0].status == -1)
         {
-            int k0 = group_member_list[igr][list[k]];
-            if(fHyCalCluster[k0].status == -1)
-            {
-                printf("glue island warning neg. status\n");
-                continue;
-            }
-
-            MergeClusters(i0,k0);
-            fHyCalCluster[k0].status = -1;
+            printf("glue island warning neg. status\n");
+            continue;
         }
+
+        MergeClusters(i0,k0);
+        fHyCalCluster[k0].status = -1;
     }
 
     // apply energy nonlin corr.:
@@ -518,33 +522,25 @@ void PRadIslandCluster::GlueTransitionClusters()
         fHyCalCluster[i].E = EnergyCorrect(olde, central_id);
     }
 
-    int ifdiscarded;
-
     // discrard clusters merged with others:
-    do
+    int nkept = 0;
+    for(int i = 0; i < fNHyCalClusters; ++i)
     {
-        ifdiscarded = 0;
-        for(int i = 0; i < fNHyCalClusters; ++i)
-        {
-            if(fHyCalCluster[i].status == -1 ||
-               fHyCalCluster[i].E       < SET_EMIN ||
-               fHyCalCluster[i].E       > SET_EMAX ||
-               fHyCalCluster[i].nblocks < SET_HMIN ||
-               fHyCalCluster[i].sigma_E < SET_MINM)
-            {
-                fNHyCalClusters -= 1;
-                int nrest = fNHyCalClusters - i;
+        if(fHyCalCluster[i].status == -1 ||
+           fHyCalCluster[i].E       < fMinClusterE ||
+           fHyCalCluster[i].E       > ISLAND_MAX_CLUSTER_E ||
+           fHyCalCluster[i].nblocks < ISLAND_MIN_CLUSTER_HITS ||
+           fHyCalCluster[i].sigma_E < ISLAND_MIN_MAX_CELL_E)
+            continue;
 
-                if(nrest)
-                {
-                    memmove((&fHyCalCluster[0]+i), (&fHyCalCluster[0]+i+1), nrest*sizeof(HyCalHit));
-                    memmove((&fClusterStorage[0]+i), (&fClusterStorage[0]+i+1), nrest*sizeof(cluster_t));
-                    ifdiscarded = 1;
-                }
-            }
+        if(nkept != i)
+        {
+            fHyCalCluster[nkept] = fHyCalCluster[i];
+            fClusterStorage[nkept] = fClusterStorage[i];
         }
-    } while(ifdiscarded);
-
+        ++nkept;
+    }
+    fNHyCalClusters = nkept;
 }
 //________________________________________________________________________
 int  PRadIslandCluster::ClustersMinDist(int i,int j)
@@ -840,22 +836,20 @@ void PRadIslandCluster::FinalProcessing()
         fHyCalCluster[i].dz *= 10.; //cm to mm
 
 
-        PRadDAQUnit *module =
-        fHandler->GetChannel(PRadDAQUnit::NameFromPrimExID(fHyCalCluster[i].cid));
-
-        PRadTDCGroup *tdc = fHandler->GetTDCGroup(module->GetTDCName());
+        //time from the tdc group of the center module
+        int cid = fHyCalCluster[i].cid;
+        auto center = std::find_if(fModuleHits.begin(), fModuleHits.end(),
+                                   [cid] (const ModuleHit &hit) {return hit.primex_id == cid;});
 
         fHyCalCluster[i].clear_time();
-        fHyCalCluster[i].set_time(tdc->GetTimeMeasure());
-        //copy the module info the cluster has
-
-#ifdef RECON_DISPLAY
+        if(center != fModuleHits.end())
+            fHyCalCluster[i].set_time(GetTimeMeasure(center->tdc_id));
+        //copy the module info the cluster has to the block pool
         int dime   = fHyCalCluster[i].nblocks;
-        for(int k = 0; k < (dime>MAX_CC ? MAX_CC : dime); ++k){
-            fHyCalCluster[i].moduleID[k] = fClusterStorage[i].id[k];
-            fHyCalCluster[i].moduleE[k] = 1000.*fClusterStorage[i].E[k];
-        }
-#endif
+        fHyCalCluster[i].block_offset = fBlockPool.size();
+        fHyCalCluster[i].block_size = (dime > MAX_CC) ? MAX_CC : dime;
+        for(int k = 0; k < fHyCalCluster[i].block_size; ++k)
+            fBlockPool.emplace_back(fClusterStorage[i].id[k], 1000.*fClusterStorage[i].E[k]);
     }
 }
 //_______________________________________________________________________________
@@ -873,7 +867,41 @@ inline float PRadIslandCluster::GetShowerDepth(int type, float & E)
 float PRadIslandCluster::GetDoubleExpWeight(float& e, float& E)
 {
     float y = e/E;
-    return std::max(0.,1.-Finv(y) /Finv(fCutOffThr))/(1.-Finv(1.)/Finv(fCutOffThr));
+    float finv;
+
+    if(fFinvTable.empty() || y >= 1.) {
+        finv = Finv(y);
+    } else if(y <= fCutOffThr) {
+        // Finv(y) >= Finv(fCutOffThr), no weight below the cut off
+        return 0.;
+    } else {
+        // linear interpolation in log(y)
+        float u = (log(y) - fFinvLogMin)/fFinvLogStep;
+        int i = std::min((int)u, ISLAND_FINV_TABLE_SIZE - 2);
+        float w = u - i;
+        finv = fFinvTable[i]*(1. - w) + fFinvTable[i+1]*w;
+    }
+
+    return std::max(0.,1.-finv/fFinvCutOff)/(1.-fFinvOne/fFinvCutOff);
+}
+//_________________________________________________________________________________
+void PRadIslandCluster::BuildWeightTable()
+{
+    //Finv is solved by bisection, it costs tens of exp for every cell, so it is
+    //tabulated here once the parameters are read
+    fFinvCutOff = Finv(fCutOffThr);
+    fFinvOne = Finv(1.);
+    fFinvTable.clear();
+
+    //Finv(y) behaves like log(y) for small y, so the points are even in log(y)
+    if(fCutOffThr <= 0. || fCutOffThr >= 1.)
+        return;
+
+    fFinvLogMin = log(fCutOffThr);
+    fFinvLogStep = -fFinvLogMin/(ISLAND_FINV_TABLE_SIZE - 1);
+    fFinvTable.resize(ISLAND_FINV_TABLE_SIZE);
+    for(int i = 0; i < ISLAND_FINV_TABLE_SIZE; ++i)
+        fFinvTable[i] = Finv(exp(fFinvLogMin + i*fFinvLogStep));
 }
 //_________________________________________________________________________________
 inline float PRadIslandCluster::Finv(float y)
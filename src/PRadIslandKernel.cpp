@@ -0,0 +1,986 @@
+//============================================================================//
+// C++ port of the PrimEx island reconstruction in island.F                   //
+// The routines are translated one by one with the same single precision      //
+// arithmetic, so the results are the same as the fortran code. The common    //
+// blocks are replaced by the members, so the instances are independent.      //
+// The two-gamma separation (tgamma_hyc) is not ported since gamma_hyc in     //
+// island.F always returns before it.                                         //
+//                                                                            //
+// agent                                                                      //
+// 10/17/2026                                                                 //
+//============================================================================//
+
+#include "PRadIslandKernel.h"
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <algorithm>
+
+#define ISLAND_MAX_HITS (ISLAND_MAX_COL*ISLAND_MAX_ROW)
+
+using namespace std;
+
+// fortran nint
+inline int nint(const float &a)
+{
+    return (int) lroundf(a);
+}
+
+PRadIslandKernel::PRadIslandKernel()
+: profile(new Profile()), xsize(0.), ysize(0.), ncol(ISLAND_MAX_COL),
+  nrow(ISLAND_MAX_ROW), isect(0), sig2_d2c(0.), sig2_ped(0.), sig2_scale(1.),
+  nadcgam(0)
+{
+    sect_profile = profile->point[0];
+    memset(ech, 0, sizeof(ech));
+    memset(stat_ch, 0, sizeof(stat_ch));
+    memset(gammas, 0, sizeof(gammas));
+
+    // index 0 is not used, so the indexes are the same as in island.F
+    ia.resize(ISLAND_MAX_HITS + 1);
+    id.resize(ISLAND_MAX_HITS + 1);
+    lencl.resize(ISLAND_MAX_CLUSTERS + 1);
+    iaz.resize(8*ISLAND_MAX_HITS + 1);
+    // columns 0 to 12 as iwrk(10800,0:12) in gams_hyc
+    work_i.resize(13*(ISLAND_MAX_HITS + 1));
+    work_f.resize(13*(ISLAND_MAX_HITS + 1));
+}
+
+// load the profile of crystal (type 0) or lead glass (type 1), same as
+// load_pwo_prof and load_lg_prof
+bool PRadIslandKernel::LoadProfile(const int &type, const string &path)
+{
+    if(type < 0 || type > 1) {
+        cerr << "Island Kernel: Unknown profile type " << type << endl;
+        return false;
+    }
+
+    ifstream in(path);
+    if(!in.is_open()) {
+        cerr << "Island Kernel: Cannot open profile file "
+             << "\"" << path << "\""
+             << endl;
+        return false;
+    }
+
+    // do not change the tables used by the other copies
+    if(profile.use_count() > 1)
+        profile = make_shared<Profile>(*profile);
+
+    // format (i3,1x,i3,2(1x,e20.10)), the tables are symmetric
+    string line;
+    for(int i1 = 0; i1 < ISLAND_PROFILE_SIZE; ++i1)
+    {
+        for(int i2 = 0; i2 <= i1; ++i2)
+        {
+            if(!getline(in, line) || line.size() < 29) {
+                cerr << "Island Kernel: Incomplete profile file "
+                     << "\"" << path << "\""
+                     << endl;
+                return false;
+            }
+
+            ProfilePoint point;
+            point.cell = strtof(line.substr(8, 20).c_str(), nullptr);
+            point.d2c = strtof(line.substr(29, 20).c_str(), nullptr);
+            profile->point[type][i1][i2] = point;
+            profile->point[type][i2][i1] = point;
+        }
+    }
+
+    sect_profile = profile->point[min(1, isect)];
+    return true;
+}
+
+// set the sector and clear the energies, same as filling set_common
+void PRadIslandKernel::SetSector(const int &s, const int &nc, const int &nr,
+                                 const float &xs, const float &ys)
+{
+    isect = s;
+    ncol = nc;
+    nrow = nr;
+    xsize = xs;
+    ysize = ys;
+    memset(ech, 0, sizeof(ech));
+    // crystal profile for sector 0, lead glass for the others
+    sect_profile = profile->point[min(1, isect)];
+}
+
+// col and row start from 1
+void PRadIslandKernel::SetStatus(const int &col, const int &row, const int &status)
+{
+    stat_ch[col - 1][row - 1] = status;
+}
+
+// energy in 0.1 MeV
+void PRadIslandKernel::SetEnergy(const int &col, const int &row, const int &energy)
+{
+    ech[col - 1][row - 1] = energy;
+}
+
+// main_island, returns the number of gammas
+int PRadIslandKernel::Reconstruct()
+{
+    int nw, ncl;
+    nadcgam = 0;
+
+    dataHyc(nw);
+
+    if(nw > 0) {
+        clusHyc(nw, ncl);
+
+        int ipncl = 1;
+        for(int icl = 1; icl <= ncl; ++icl)
+        {
+            gamsHyc(lencl[icl], &ia[ipncl - 1], &id[ipncl - 1]);
+
+            if(nadcgam > ISLAND_MAX_GAMMAS) {
+                nadcgam = ISLAND_MAX_GAMMAS;
+                break;
+            }
+            ipncl += lencl[icl];
+        }
+    }
+
+    outHyc();
+
+    return nadcgam;
+}
+
+// prepare data in dimensionless form
+void PRadIslandKernel::dataHyc(int &nw)
+{
+    nw = 0;
+    for(int i = 1; i <= ncol; ++i)
+    {
+        for(int j = 1; j <= nrow; ++j)
+        {
+            int ie = ech[i - 1][j - 1];
+            if(ie > 0) {
+                ++nw;
+                ia[nw] = 100*i + j;
+                id[nw] = ie;
+            }
+        }
+    }
+}
+
+// cluster search, the hits are grouped in the contiguous subclusters in
+// increasing address order and then the subclusters are glued
+void PRadIslandKernel::clusHyc(const int &nw, int &ncl)
+{
+    ncl = 0;
+    if(nw < 1)
+        return;
+    ncl = 1;
+    lencl[1] = 1;
+    if(nw < 2)
+        return;
+
+    orderHyc(nw, &ia[0], &id[0]);
+
+    int iwork[ISLAND_MAX_HITS];
+    int next = 1, iak = 0;
+    ncl = 0;
+    for(int k = 2; k <= nw + 1; ++k)
+    {
+        if(k <= nw)
+            iak = ia[k];
+
+        if(k <= nw && iak - ia[k - 1] <= 1)
+            continue;
+
+        int ib = next;   // first word of the (sub)cluster
+        int ie = k - 1;  // last word of the (sub)cluster
+        next = k;        // first word of the next (sub)cluster
+        if(ncl >= ISLAND_MAX_CLUSTERS)
+            return;
+        ++ncl;
+        lencl[ncl] = next - ib;
+
+        if(ncl == 1)
+            continue;
+
+        // glue the subclusters
+        int ias = ia[ib], iaf = ia[ie];
+        int last = ib - 1, lastcl = ncl - 1;
+        for(int icl = lastcl; icl >= 1; --icl)
+        {
+            int leng = lencl[icl];
+            // no subclusters to be glued
+            if(ias - ia[last] > 100)
+                break;
+
+            for(int i = last; i >= last - leng + 1; --i)
+            {
+                if(ias - ia[i] > 100)
+                    break;
+
+                if(iaf - ia[i] >= 100) {
+                    // move the subcluster next to the current one
+                    if(icl < ncl - 1) {
+                        int nmove = ib - 1 - last;
+                        copy(&ia[last + 1 - leng], &ia[last + 1], iwork);
+                        memmove(&ia[last + 1 - leng], &ia[last + 1], nmove*sizeof(int));
+                        copy(iwork, iwork + leng, &ia[ib - leng]);
+                        copy(&id[last + 1 - leng], &id[last + 1], iwork);
+                        memmove(&id[last + 1 - leng], &id[last + 1], nmove*sizeof(int));
+                        copy(iwork, iwork + leng, &id[ib - leng]);
+                        for(int j = icl; j <= ncl - 2; ++j)
+                            lencl[j] = lencl[j + 1];
+                    }
+                    ib -= leng;
+                    lencl[ncl - 1] = lencl[ncl] + leng;
+                    --ncl;
+                    break;
+                }
+            }
+            last -= leng;
+        }
+    }
+}
+
+// the addresses in increasing order
+void PRadIslandKernel::orderHyc(const int &nw, int *ia, int *id)
+{
+    for(int k = 2; k <= nw; ++k)
+    {
+        if(ia[k] > ia[k - 1])
+            continue;
+
+        int iat = ia[k], idt = id[k];
+        int i = k - 1;
+        for(; i >= 1 && iat < ia[i]; --i)
+        {
+            ia[i + 1] = ia[i];
+            id[i + 1] = id[i];
+        }
+        ia[i + 1] = iat;
+        id[i + 1] = idt;
+    }
+}
+
+// cluster processing, the cluster is separated to gammas by the peaks
+void PRadIslandKernel::gamsHyc(const int &nadc, int *ia, int *id)
+{
+    const int niter = 6;
+    const float chisq1 = 90.;
+    const float chisq2 = 50.;
+
+    int ipnpk[11], igmpk[3][11];
+    float epk[11], xpk[11], ypk[11], fw[11];
+    float chisq, e1, x1, y1;
+
+    orderHyc(nadc, ia, id);
+
+    int ngam0 = nadcgam;
+
+    // peaks search
+    int idsum = 0;
+    for(int ic = 1; ic <= nadc; ++ic)
+        idsum += id[ic];
+
+    int minpk;
+    if(nadc < 3)
+        minpk = 1;
+    else if(isect != 0)
+        minpk = max(1, nint(20.f*log(1.f + 0.0001f*idsum)));
+    else
+        minpk = max(1, nint(7.f*log(1.f + 0.0001f*idsum)));
+    minpk *= 100;
+
+    int npk = 0;
+    for(int ic = 1; ic <= nadc; ++ic)
+    {
+        int iac = id[ic];
+        if(iac < minpk)
+            continue;
+
+        int ixy = ia[ic];
+        int ixymax = ixy + 100 + 1;
+        int ixymin = ixy - 100 - 1;
+        int iyc = ixy - ixy/100*100;
+
+        bool is_peak = true;
+        for(int in = ic + 1; is_peak && in <= nadc && ia[in] <= ixymax; ++in)
+        {
+            int iy = ia[in] - ia[in]/100*100;
+            if(abs(iy - iyc) <= 1 && id[in] >= iac)
+                is_peak = false;
+        }
+        for(int in = ic - 1; is_peak && in >= 1 && ia[in] >= ixymin; --in)
+        {
+            int iy = ia[in] - ia[in]/100*100;
+            if(abs(iy - iyc) <= 1 && id[in] > iac)
+                is_peak = false;
+        }
+        if(!is_peak)
+            continue;
+
+        ipnpk[++npk] = ic;
+        if(npk == 10 || npk >= 10000/nadc - 3)
+            break;
+    }
+
+    if(npk == 0)
+        return;
+
+    // gamma search for one peak
+    if(npk == 1) {
+        if(nadcgam >= ISLAND_MAX_GAMMAS - 1)
+            return;
+
+        Gamma &gam = gammas[nadcgam++];
+        chisq = chisq2;
+
+        int ic = ipnpk[1];
+        int ix = ia[ic]/100;
+        int iy = ia[ic] - ix*100;
+
+        int itype = peakType(ix, iy);
+
+        gammaHyc(nadc, ia, id, chisq, e1, x1, y1);
+        gam.chi2 = chisq;
+        gam.type = itype;
+        gam.energy = e1;
+        gam.x = x1;
+        gam.y = y1;
+        gam.z = 0.;
+        gam.xc = 0.;
+        gam.yc = 0.;
+        gam.dime = nadc;
+        gam.id = 0;
+        gam.status = itype;
+
+        for(int j = 1; j <= nadc && j <= ISLAND_MAX_CC; ++j)
+        {
+            gam.icl_index[j - 1] = ia[j];
+            gam.icl_iener[j - 1] = id[j];
+        }
+        return;
+    }
+
+    // gamma search for several peaks, first step (1 gamma in each peak)
+    // preliminary estimation of (E,x,y) of peaks by an iterative procedure,
+    // the integer arrays of island.F are not used in this step
+    if(nadcgam >= ISLAND_MAX_GAMMAS - 1)
+        return;
+
+    float ratio = 1.;
+    for(int iter = 1; iter <= niter; ++iter)
+    {
+        for(int i = 1; i <= nadc; ++i)
+            fwrk(0)[i] = 0.;
+
+        for(int ipk = 1; ipk <= npk; ++ipk)
+        {
+            int ic = ipnpk[ipk];
+            if(iter != 1)
+                ratio = fwrk(ipk)[ic]/fwrk(npk + 1)[ic];
+            float eg = id[ic]*ratio;
+            int ixypk = ia[ic];
+            int ixpk = ixypk/100;
+            int iypk = ixypk - ixpk*100;
+            epk[ipk] = eg;
+            xpk[ipk] = eg*ixpk;
+            ypk[ipk] = eg*iypk;
+
+            for(int in = ic + 1; in <= nadc; ++in)
+            {
+                int ixy = ia[in];
+                int ix = ixy/100;
+                int iy = ixy - ix*100;
+                if(ixy - ixypk > 100 + 1)
+                    break;
+                if(abs(iy - iypk) <= 1) {
+                    if(iter != 1)
+                        ratio = fwrk(ipk)[in]/fwrk(npk + 1)[in];
+                    eg = id[in]*ratio;
+                    epk[ipk] += eg;
+                    xpk[ipk] += eg*ix;
+                    ypk[ipk] += eg*iy;
+                }
+            }
+
+            for(int in = ic - 1; in >= 1; --in)
+            {
+                int ixy = ia[in];
+                int ix = ixy/100;
+                int iy = ixy - ix*100;
+                if(ixypk - ixy > 100 + 1)
+                    break;
+                if(abs(iy - iypk) <= 1) {
+                    if(iter != 1)
+                        ratio = fwrk(ipk)[in]/fwrk(npk + 1)[in];
+                    eg = id[in]*ratio;
+                    epk[ipk] += eg;
+                    xpk[ipk] += eg*ix;
+                    ypk[ipk] += eg*iy;
+                }
+            }
+
+            if(epk[ipk] > 0.) {
+                xpk[ipk] /= epk[ipk];
+                ypk[ipk] /= epk[ipk];
+            } else {
+                printf("WRN: lost maximum with peak energy %6.2f at ITER = %2d\n",
+                       id[ic]*1.e-4f, iter);
+            }
+
+            for(int i = 1; i <= nadc; ++i)
+            {
+                int ixy = ia[i];
+                int ix = ixy/100;
+                int iy = ixy - ix*100;
+                float dx = fabs(ix - xpk[ipk]);
+                float dy = fabs(iy - ypk[ipk]);
+
+                float a = epk[ipk]*cellHyc(dx, dy);
+                fwrk(ipk)[i] = a;
+                fwrk(0)[i] += a;
+            }
+        }
+
+        for(int i = 1; i <= nadc; ++i)
+            fwrk(npk + 1)[i] = (fwrk(0)[i] > 1.e-2f) ? fwrk(0)[i] : 1.e-2f;
+    }
+
+    for(int ipk = 1; ipk <= npk; ++ipk)
+    {
+        int leng = 0;
+        for(int i = 1; i <= nadc; ++i)
+        {
+            if(fwrk(0)[i] > 1.e-2f) {
+                // part of cell energy #i belonging to peak #ipk
+                float fe = id[i]*fwrk(ipk)[i]/fwrk(0)[i];
+                if(fe > 0.) {
+                    ++leng;
+                    iwrk(npk + 1)[leng] = ia[i];
+                    iwrk(npk + 2)[leng] = nint(fe);
+                }
+            }
+        }
+
+        if(nadcgam >= ISLAND_MAX_GAMMAS - 1)
+            return;
+
+        igmpk[2][ipk] = 0;
+        if(leng == 0)
+            continue;
+
+        Gamma &gam = gammas[nadcgam++];
+        chisq = chisq1;
+
+        int ic = ipnpk[ipk];
+        int ix = ia[ic]/100;
+        int iy = ia[ic] - ix*100;
+
+        int itype = peakType(ix, iy);
+
+        gammaHyc(leng, iwrk(npk + 1), iwrk(npk + 2), chisq, e1, x1, y1);
+        gam.chi2 = chisq;
+        gam.type = itype;
+        gam.energy = e1;
+        gam.x = x1;
+        gam.y = y1;
+        gam.z = 0.;
+        gam.xc = 0.;
+        gam.yc = 0.;
+        gam.id = 90;
+        gam.dime = leng;
+        gam.status = itype;
+        igmpk[1][ipk] = nadcgam;
+        igmpk[2][ipk] = nadcgam;
+    }
+
+    // second step, (e,x,y) of gammas were preliminary estimated in the first
+    // step, the sum of the integer parts from the peaks is the same as idp in
+    // island.F
+    for(int i = 1; i <= nadc; ++i)
+    {
+        iwrk(0)[i] = 0;
+        fwrk(0)[i] = 0.;
+    }
+
+    for(int ipk = 1; ipk <= npk; ++ipk)
+    {
+        for(int i = 1; i <= nadc; ++i)
+        {
+            iwrk(ipk)[i] = 0;
+            fwrk(ipk)[i] = 0.;
+            if(igmpk[2][ipk] == 0)
+                continue;
+
+            for(int ig = igmpk[1][ipk]; ig <= igmpk[2][ipk]; ++ig)
+            {
+                int ixy = ia[i];
+                int ix = ixy/100;
+                int iy = ixy - ix*100;
+                float dx = ix - gammas[ig - 1].x;
+                float dy = iy - gammas[ig - 1].y;
+
+                // part of gamma #ig energy belonging to cell #i from peak #ipk
+                float fia = gammas[ig - 1].energy*cellHyc(dx, dy);
+                int iia = nint(fia);
+
+                iwrk(ipk)[i] += iia;
+                fwrk(ipk)[i] += fia;
+                iwrk(0)[i] += iia;
+                fwrk(0)[i] += fia;
+            }
+        }
+    }
+
+    // renormalize the total sum to the original cell energy
+    for(int i = 1; i <= nadc; ++i)
+    {
+        int ide = id[i] - iwrk(0)[i];
+        if(ide == 0 || fwrk(0)[i] == 0.)
+            continue;
+
+        for(int ipk = 1; ipk <= npk; ++ipk)
+            fw[ipk] = fwrk(ipk)[i]/fwrk(0)[i];
+
+        for(int ipk = 1; ipk <= npk; ++ipk)
+        {
+            float fia = ide*fw[ipk];
+            if(fwrk(ipk)[i] + fia > 0.) {
+                fwrk(ipk)[i] += fia;
+                fwrk(0)[i] += fia;
+            }
+            int iia = nint(fia);
+            if(iwrk(ipk)[i] + iia > 0) {
+                iwrk(ipk)[i] += iia;
+                iwrk(0)[i] += iia;
+            } else if(iwrk(ipk)[i] + iia < 0) {
+                printf("WARNING NEGATIVE CORR = %d %d\n", ia[i], id[i]);
+            }
+        }
+    }
+
+    // reanalyze the gammas
+    nadcgam = ngam0;
+    for(int ipk = 1; ipk <= npk; ++ipk)
+    {
+        int leng = 0;
+        for(int i = 1; i <= nadc; ++i)
+        {
+            if(iwrk(0)[i] > 0) {
+                float fe = id[i]*fwrk(ipk)[i]/fwrk(0)[i];
+                if(fe > 0.) {
+                    ++leng;
+                    iwrk(npk + 1)[leng] = ia[i];
+                    iwrk(npk + 2)[leng] = nint(fe);
+                }
+            }
+        }
+
+        if(nadcgam >= ISLAND_MAX_GAMMAS - 1) {
+            printf("gams_pht debug printout, goto line 500 has met\n");
+            return;
+        }
+
+        if(leng == 0)
+            continue;
+
+        Gamma &gam = gammas[nadcgam++];
+        chisq = chisq2;
+
+        int ic = ipnpk[ipk];
+        int ix = ia[ic]/100;
+        int iy = ia[ic] - ix*100;
+
+        int itype = peakType(ix, iy);
+
+        gammaHyc(leng, iwrk(npk + 1), iwrk(npk + 2), chisq, e1, x1, y1);
+        gam.chi2 = chisq;
+        gam.type = itype;
+        gam.energy = e1;
+        gam.x = x1;
+        gam.y = y1;
+        gam.z = 0.;
+        gam.xc = 0.;
+        gam.yc = 0.;
+        gam.dime = leng;
+        gam.id = 10;
+        gam.status = itype;
+
+        for(int j = 1; j <= leng && j <= ISLAND_MAX_CC; ++j)
+        {
+            gam.icl_index[j - 1] = iwrk(npk + 1)[j];
+            gam.icl_iener[j - 1] = iwrk(npk + 2)[j];
+        }
+    }
+}
+
+// type of the peak, 1 for hole or outer boundary, 2 for transition region
+int PRadIslandKernel::peakType(const int &ix, const int &iy) const
+{
+    int itype = 0;
+
+    switch(isect)
+    {
+    case 0:
+        if((ix == ncol/2 - 1 || ix == ncol/2 + 2) && iy >= nrow/2 - 1 && iy <= nrow/2 + 2)
+            itype = 1;
+        if((iy == nrow/2 - 1 || iy == nrow/2 + 2) && ix >= ncol/2 - 1 && ix <= ncol/2 + 2)
+            itype = 1;
+        if(ix == 1 || ix == ncol || iy == 1 || iy == nrow)
+            itype = 2;
+        break;
+    case 1:
+        if(ix == 1 || iy == 1) itype = 1;
+        if(ix == ncol || iy == nrow) itype = 2;
+        break;
+    case 2:
+        if(ix == ncol || iy == 1) itype = 1;
+        if(ix == 1 || iy == nrow) itype = 2;
+        break;
+    case 3:
+        if(ix == ncol || iy == nrow) itype = 1;
+        if(ix == 1 || iy == 1) itype = 2;
+        break;
+    case 4:
+        if(ix == 1 || iy == nrow) itype = 1;
+        if(ix == ncol || iy == 1) itype = 2;
+        break;
+    default:
+        break;
+    }
+
+    return itype;
+}
+
+// one gamma fit of the peak, chisq is the reference value as input and the
+// improved value as output
+void PRadIslandKernel::gammaHyc(const int &nadc, const int *ia, const int *id,
+                                float &chisq, float &e1, float &x1, float &y1)
+{
+    const float dxy = .05;      // initial step in cell size
+    const float stepmin = .002; // minimum step
+
+    int nzero;
+    fillZeros(nadc, ia, nzero);
+
+    mom1Pht(nadc, ia, id, nzero, e1, x1, y1);
+    if(nadc <= 0)
+        return;
+
+    float chi0 = chisq1Hyc(nadc, ia, id, nzero, e1, x1, y1);
+    float chisq0 = chi0;
+    int dof = nzero + nadc - 2;
+    if(dof < 1)
+        dof = 1;
+    chisq = chi0/dof;
+    float x0 = x1, y0 = y1;
+
+    while(true)
+    {
+        float chir = chisq1Hyc(nadc, ia, id, nzero, e1, x0 + dxy, y0);
+        float chil = chisq1Hyc(nadc, ia, id, nzero, e1, x0 - dxy, y0);
+        float chiu = chisq1Hyc(nadc, ia, id, nzero, e1, x0, y0 + dxy);
+        float chid = chisq1Hyc(nadc, ia, id, nzero, e1, x0, y0 - dxy);
+
+        float stepx, stepy;
+        if(chi0 > chir || chi0 > chil) {
+            stepx = dxy;
+            if(chir > chil)
+                stepx = -stepx;
+        } else {
+            stepx = 0.;
+            float parx = chir + chil - 2.f*chi0;
+            if(parx > 0.)
+                stepx = -dxy*(chir - chil)/(2.f*parx);
+        }
+
+        if(chi0 > chiu || chi0 > chid) {
+            stepy = dxy;
+            if(chiu > chid)
+                stepy = -stepy;
+        } else {
+            stepy = 0.;
+            float pary = chiu + chid - 2.f*chi0;
+            if(pary > 0.)
+                stepy = -dxy*(chiu - chid)/(2.f*pary);
+        }
+
+        // steps at minimum
+        if(fabs(stepx) < stepmin && fabs(stepy) < stepmin)
+            break;
+
+        float chi00 = chisq1Hyc(nadc, ia, id, nzero, e1, x0 + stepx, y0 + stepy);
+
+        // chi2 at minimum
+        if(chi00 >= chi0)
+            break;
+
+        chi0 = chi00;
+        x0 += stepx;
+        y0 += stepy;
+    }
+
+    if(chi0 < chisq0) {
+        x1 = x0;
+        y1 = y0;
+        chisq = chi0/dof;
+    }
+}
+
+// neighbors of the cluster that are supposed to have 0 energy
+void PRadIslandKernel::fillZeros(const int &nadc, const int *ia, int &nneib)
+{
+    nneib = 0;
+    for(int i = 1; i <= nadc; ++i)
+    {
+        int ix = ia[i]/100;
+        int iy = ia[i] - ix*100;
+        if(ix > 1) {
+            iaz[++nneib] = iy + (ix - 1)*100;
+            if(iy > 1)
+                iaz[++nneib] = iy - 1 + (ix - 1)*100;
+            if(iy < nrow)
+                iaz[++nneib] = iy + 1 + (ix - 1)*100;
+        }
+        if(ix < ncol) {
+            iaz[++nneib] = iy + (ix + 1)*100;
+            if(iy > 1)
+                iaz[++nneib] = iy - 1 + (ix + 1)*100;
+            if(iy < nrow)
+                iaz[++nneib] = iy + 1 + (ix + 1)*100;
+        }
+        if(iy > 1)
+            iaz[++nneib] = iy - 1 + ix*100;
+        if(iy < nrow)
+            iaz[++nneib] = iy + 1 + ix*100;
+    }
+
+    // remove the cluster members and the duplicates
+    for(int i = 1; i <= nneib; ++i)
+    {
+        for(int j = 1; j <= nadc; ++j)
+        {
+            if(ia[j] == iaz[i])
+                iaz[i] = -1;
+        }
+    }
+
+    for(int i = 1; i <= nneib; ++i)
+    {
+        if(iaz[i] == -1)
+            continue;
+        for(int j = i + 1; j <= nneib; ++j)
+        {
+            if(iaz[j] == iaz[i])
+                iaz[j] = -1;
+        }
+    }
+
+    // only the working modules
+    int nneibnew = 0;
+    for(int i = 1; i <= nneib; ++i)
+    {
+        if(iaz[i] == -1)
+            continue;
+        int ix = iaz[i]/100;
+        int iy = iaz[i] - ix*100;
+        if(stat_ch[ix - 1][iy - 1] == 0)
+            iaz[++nneibnew] = iaz[i];
+    }
+    nneib = nneibnew;
+}
+
+// first momenta, the energy is corrected by the profile
+void PRadIslandKernel::mom1Pht(const int &nadc, const int *ia, const int *id, const int &nzero,
+                               float &a0, float &x0, float &y0) const
+{
+    a0 = 0.;
+    x0 = 0.;
+    y0 = 0.;
+    if(nadc <= 0)
+        return;
+
+    for(int i = 1; i <= nadc; ++i)
+    {
+        float a = id[i];
+        int ix = ia[i]/100;
+        int iy = ia[i] - ix*100;
+        a0 += a;
+        x0 += a*ix;
+        y0 += a*iy;
+    }
+    if(a0 <= 0.)
+        return;
+    x0 /= a0;
+    y0 /= a0;
+
+    // correction for delta
+    float corr = 0.;
+    for(int i = 1; i <= nadc; ++i)
+    {
+        int ix = ia[i]/100;
+        int iy = ia[i] - ix*100;
+        corr += cellHyc(float(ix) - x0, float(iy) - y0);
+    }
+    for(int i = 1; i <= nzero; ++i)
+    {
+        int ix = iaz[i]/100;
+        int iy = iaz[i] - ix*100;
+        corr += cellHyc(float(ix) - x0, float(iy) - y0);
+    }
+    corr /= 1.006f;
+
+    if(corr < .8f)
+        corr = .8f;
+    else if(corr > 1.f)
+        corr = 1.f;
+
+    a0 /= corr;
+}
+
+// chi2 of one gamma with energy e1 at (x1, y1)
+float PRadIslandKernel::chisq1Hyc(const int &nadc, const int *ia, const int *id, const int &nneib,
+                                  const float &e1, const float &x1, const float &y1)
+{
+    float chisq = 0., fcell, d2;
+    if(e1 != 0.)
+        sigma2Terms(e1);
+
+    for(int i = 1; i <= nadc; ++i)
+    {
+        int ix = ia[i]/100;
+        int iy = ia[i] - ix*100;
+        if(e1 != 0.) {
+            if(fabs(x1 - ix) > 6.f || fabs(y1 - iy) > 6.f)
+                continue;
+            profileHyc(x1 - ix, y1 - iy, fcell, d2);
+            float diff = fcell - id[i]/e1;
+            chisq = chisq + e1*(diff*diff)/sigma2(x1 - ix, y1 - iy, fcell, d2);
+        } else {
+            chisq = chisq + float(id[i]*id[i])/9.f;
+        }
+    }
+
+    // island.F reads the energy of the cluster cells for the neighbors when
+    // e1 is 0, they are skipped here
+    if(e1 == 0.)
+        return chisq;
+
+    for(int i = 1; i <= nneib; ++i)
+    {
+        int ix = iaz[i]/100;
+        int iy = iaz[i] - ix*100;
+        if(fabs(x1 - ix) > 6.f || fabs(y1 - iy) > 6.f)
+            continue;
+        profileHyc(x1 - ix, y1 - iy, fcell, d2);
+        chisq = chisq + e1*(fcell*fcell)/sigma2(x1 - ix, y1 - iy, fcell, d2);
+    }
+
+    return chisq;
+}
+
+// the terms of sigma2 that only depend on the gamma energy e
+void PRadIslandKernel::sigma2Terms(const float &e)
+{
+    const float bet1 = 32.1, bet2 = 1.72;
+
+    sig2_d2c = bet1 + bet2*sqrt(e/100.f);
+    // 0.2 for ped-sigma and 10/sqrt(12)
+    sig2_ped = 0.2f/(e/100.f);
+    sig2_scale = pow(0.0001f*e, 0.166f);
+}
+
+// sigma_e^2/e = sigma_f^2*e, units are 10 MeV, fc and d2 are the profile
+// values at (dx, dy), the energy terms are from sigma2Terms
+float PRadIslandKernel::sigma2(const float &dx, const float &dy, const float &fc, const float &d2) const
+{
+    const float alp = 0.816;
+
+    if(dx*dx + dy*dy > 25.f)
+        return 100.;
+
+    float sig2 = alp*fc + sig2_d2c*d2 + sig2_ped;
+    sig2 = sig2/sig2_scale;
+    return 100.f*sig2;
+}
+
+// the table point at the lower corner of (x, y) and the weights of the
+// bilinear interpolation, nullptr if it is out of the table
+inline const PRadIslandKernel::ProfilePoint *
+PRadIslandKernel::profilePoint(const float &x, const float &y, float &wx, float &wy) const
+{
+    float ax = fabs(x*100.f);
+    float ay = fabs(y*100.f);
+    if(!(ax < 500.f && ay < 500.f))
+        return nullptr;
+
+    int i = int(ax);
+    int j = int(ay);
+    wx = ax - i;
+    wy = ay - j;
+    return &sect_profile[i][j];
+}
+
+// energy fraction in the cell and (df/dx)^2 + (df/dy)^2 from one lookup
+void PRadIslandKernel::profileHyc(const float &x, const float &y, float &fc, float &d2) const
+{
+    float wx, wy;
+    const ProfilePoint *p = profilePoint(x, y, wx, wy);
+    if(p == nullptr) {
+        fc = 0.;
+        d2 = 1.;
+        return;
+    }
+
+    const ProfilePoint &p00 = p[0], &p01 = p[1];
+    const ProfilePoint &p10 = p[ISLAND_PROFILE_SIZE], &p11 = p[ISLAND_PROFILE_SIZE + 1];
+
+    fc = p00.cell*(1.f - wx)*(1.f - wy) +
+         p10.cell*wx*(1.f - wy) +
+         p01.cell*(1.f - wx)*wy +
+         p11.cell*wx*wy;
+
+    d2 = p00.d2c*(1.f - wx)*(1.f - wy) +
+         p10.d2c*wx*(1.f - wy) +
+         p01.d2c*(1.f - wx)*wy +
+         p11.d2c*wx*wy;
+}
+
+// energy fraction in the cell, bilinear interpolation of the table
+float PRadIslandKernel::cellHyc(const float &x, const float &y) const
+{
+    float wx, wy;
+    const ProfilePoint *p = profilePoint(x, y, wx, wy);
+    if(p == nullptr)
+        return 0.;
+
+    return p[0].cell*(1.f - wx)*(1.f - wy) +
+           p[ISLAND_PROFILE_SIZE].cell*wx*(1.f - wy) +
+           p[1].cell*(1.f - wx)*wy +
+           p[ISLAND_PROFILE_SIZE + 1].cell*wx*wy;
+}
+
+// convert the units to GeV and cm, and sort the gammas by energy
+void PRadIslandKernel::outHyc()
+{
+    for(int i = 0; i < nadcgam; ++i)
+    {
+        Gamma &gam = gammas[i];
+        gam.energy = gam.energy/10000.f;
+        gam.x = (ncol + 1 - 2.f*gam.x)*xsize/2.f;
+        gam.y = (nrow + 1 - 2.f*gam.y)*ysize/2.f;
+        gam.xc = -gam.xc*xsize;
+        gam.yc = -gam.yc*ysize;
+        gam.type = gam.id;
+    }
+
+    for(int i = 0; i < nadcgam; ++i)
+    {
+        for(int j = i + 1; j < nadcgam; ++j)
+        {
+            if(gammas[i].energy < gammas[j].energy)
+                swap(gammas[i], gammas[j]);
+        }
+    }
+}
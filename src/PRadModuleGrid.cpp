@@ -0,0 +1,177 @@
+//============================================================================//
+// A uniform grid over the module areas, it is built once from the geometry   //
+// of the channels. The cell size is the smallest module size, and a module   //
+// is registered in every cell its area overlaps. So locating the module at a //
+// point checks one cell, and the modules around a point are found from the   //
+// cells in the range instead of the whole channel list                       //
+//                                                                            //
+// agent                                                                      //
+// 10/17/2026                                                                 //
+//============================================================================//
+
+#include "PRadModuleGrid.h"
+#include <cmath>
+#include <algorithm>
+
+using namespace std;
+
+PRadModuleGrid::PRadModuleGrid()
+: x_min(0), y_min(0), cell_size(0), nx(0), ny(0)
+{
+}
+
+inline int PRadModuleGrid::cellX(const double &x) const
+{
+    return (int) floor((x - x_min)/cell_size);
+}
+
+inline int PRadModuleGrid::cellY(const double &y) const
+{
+    return (int) floor((y - y_min)/cell_size);
+}
+
+void PRadModuleGrid::Clear()
+{
+    modules.clear();
+    cell_begin.clear();
+    cell_ids.clear();
+    x_min = y_min = cell_size = 0.;
+    nx = ny = 0;
+}
+
+// the modules are indexed by their positions in the geometry list, the ones
+// without an area are not registered
+void PRadModuleGrid::Build(const vector<PRadDAQUnit::Geometry> &geometry)
+{
+    Clear();
+    modules = geometry;
+
+    double x_max = 0., y_max = 0.;
+    bool empty = true;
+    for(auto &geo : modules)
+    {
+        if(geo.size_x <= 0. || geo.size_y <= 0.)
+            continue;
+
+        if(empty) {
+            x_min = geo.x - geo.size_x/2.;
+            x_max = geo.x + geo.size_x/2.;
+            y_min = geo.y - geo.size_y/2.;
+            y_max = geo.y + geo.size_y/2.;
+            cell_size = min(geo.size_x, geo.size_y);
+            empty = false;
+            continue;
+        }
+
+        x_min = min(x_min, geo.x - geo.size_x/2.);
+        x_max = max(x_max, geo.x + geo.size_x/2.);
+        y_min = min(y_min, geo.y - geo.size_y/2.);
+        y_max = max(y_max, geo.y + geo.size_y/2.);
+        cell_size = min(cell_size, min(geo.size_x, geo.size_y));
+    }
+
+    if(empty)
+        return;
+
+    nx = cellX(x_max) + 1;
+    ny = cellY(y_max) + 1;
+
+    // cells overlapped by the module area
+    auto cell_range = [this] (const PRadDAQUnit::Geometry &geo,
+                              int &ix_lo, int &ix_hi, int &iy_lo, int &iy_hi)
+                      {
+                          ix_lo = max(0, cellX(geo.x - geo.size_x/2.));
+                          ix_hi = min(nx - 1, cellX(geo.x + geo.size_x/2.));
+                          iy_lo = max(0, cellY(geo.y - geo.size_y/2.));
+                          iy_hi = min(ny - 1, cellY(geo.y + geo.size_y/2.));
+                          return (geo.size_x > 0.) && (geo.size_y > 0.);
+                      };
+
+    // count the modules in every cell first, then fill the ids in order, so
+    // the modules in a cell are sorted by their indices
+    int ix_lo, ix_hi, iy_lo, iy_hi;
+    cell_begin.assign(nx*ny + 1, 0);
+    for(auto &geo : modules)
+    {
+        if(!cell_range(geo, ix_lo, ix_hi, iy_lo, iy_hi))
+            continue;
+
+        for(int ix = ix_lo; ix <= ix_hi; ++ix)
+            for(int iy = iy_lo; iy <= iy_hi; ++iy)
+                ++cell_begin[ix*ny + iy + 1];
+    }
+
+    for(int i = 0; i < nx*ny; ++i)
+        cell_begin[i + 1] += cell_begin[i];
+
+    cell_ids.resize(cell_begin.back());
+    vector<unsigned int> filled(cell_begin.begin(), cell_begin.end() - 1);
+    for(size_t id = 0; id < modules.size(); ++id)
+    {
+        if(!cell_range(modules[id], ix_lo, ix_hi, iy_lo, iy_hi))
+            continue;
+
+        for(int ix = ix_lo; ix <= ix_hi; ++ix)
+            for(int iy = iy_lo; iy <= iy_hi; ++iy)
+                cell_ids[filled[ix*ny + iy]++] = id;
+    }
+}
+
+// index of the module that contains the point, -1 if there is none
+// it returns the first module in the list if they overlap
+int PRadModuleGrid::Locate(const double &x, const double &y) const
+{
+    if(nx == 0 || ny == 0)
+        return -1;
+
+    int ix = cellX(x), iy = cellY(y);
+    if(ix < 0 || ix >= nx || iy < 0 || iy >= ny)
+        return -1;
+
+    int cell = ix*ny + iy;
+    for(unsigned int i = cell_begin[cell]; i < cell_begin[cell + 1]; ++i)
+    {
+        const PRadDAQUnit::Geometry &geo = modules[cell_ids[i]];
+        if(fabs(x - geo.x) < geo.size_x/2. && fabs(y - geo.y) < geo.size_y/2.)
+            return cell_ids[i];
+    }
+
+    return -1;
+}
+
+// indices of the modules whose centers are within the radius, sorted
+void PRadModuleGrid::FindNeighbors(const double &x, const double &y,
+                                   const double &radius,
+                                   vector<unsigned short> &ids) const
+{
+    ids.clear();
+    if(nx == 0 || ny == 0)
+        return;
+
+    int ix_lo = max(0, cellX(x - radius));
+    int ix_hi = min(nx - 1, cellX(x + radius));
+    int iy_lo = max(0, cellY(y - radius));
+    int iy_hi = min(ny - 1, cellY(y + radius));
+
+    for(int ix = ix_lo; ix <= ix_hi; ++ix)
+    {
+        for(int iy = iy_lo; iy <= iy_hi; ++iy)
+        {
+            int cell = ix*ny + iy;
+            for(unsigned int i = cell_begin[cell]; i < cell_begin[cell + 1]; ++i)
+            {
+                const PRadDAQUnit::Geometry &geo = modules[cell_ids[i]];
+                // a module is in several cells, only count it in the cell of
+                // its center
+                if(cellX(geo.x) != ix || cellY(geo.y) != iy)
+                    continue;
+
+                double dx = geo.x - x, dy = geo.y - y;
+                if(sqrt(dx*dx + dy*dy) <= radius)
+                    ids.push_back(cell_ids[i]);
+            }
+        }
+    }
+
+    sort(ids.begin(), ids.end());
+}
@@ -9,6 +9,7 @@
 #include <cmath>
 #include <iostream>
 #include <iomanip>
+#include <algorithm>
 #include "PRadSquareCluster.h"
 
 using namespace std;
@@ -22,6 +23,11 @@ PRadSquareCluster::~PRadSquareCluster()
 {
 }
 
+PRadHyCalCluster *PRadSquareCluster::Clone()
+{
+    return new PRadSquareCluster(*this);
+}
+
 void PRadSquareCluster::Configure(const string &c_path)
 {
     ReadConfigFile(c_path);
@@ -36,28 +42,66 @@ void PRadSquareCluster::Configure(const string &c_path)
 
     // default value is 3.6, suggested by the study with GEM by Weizhi
     fLogWeightThres = GetConfigValue("LOG_WEIGHT_THRESHOLD", "3.6").Double();
+
+    // the neighbor lists depend on the radius
+    if(fHandler)
+        UpdateModuleTable();
+}
+
+// build the neighbor lists from the module grid, the distances are the same
+// as the ones in getMaxEChannel() and findCluster()
+void PRadSquareCluster::UpdateModuleTable()
+{
+    PRadHyCalCluster::UpdateModuleTable();
+
+    size_t nch = fModuleTable.size();
+    fClusterNeighbors.assign(nch, vector<unsigned short>());
+    fMergeNeighbors.assign(nch, vector<unsigned short>());
+    fHitIndex.assign(nch, -1);
+    fMerged.assign(nch, 0);
+
+    double max_radius = max(fBaseR, fBaseR*fMoliereRatio);
+    vector<unsigned short> candidates;
+
+    for (size_t i = 0; i < nch; ++i)
+    {
+        if (!fModuleTable[i].hycal)
+            continue;
+
+        const PRadDAQUnit::Geometry &center = fModuleTable[i].geometry;
+        fModuleGrid.FindNeighbors(center.x, center.y, 2.*max_radius, candidates);
+
+        for (auto &j : candidates)
+        {
+            if (!fModuleTable[j].hycal)
+                continue;
+
+            const PRadDAQUnit::Geometry &thisModule = fModuleTable[j].geometry;
+            double distance = Distance(thisModule.x, thisModule.y, center.x, center.y);
+            double clusterRadius = (thisModule.type == PRadDAQUnit::LeadGlass) ?
+                                   fBaseR*fMoliereRatio : fBaseR;
+
+            if (distance <= clusterRadius)
+                fClusterNeighbors[i].push_back(j);
+            if (distance < 2*clusterRadius)
+                fMergeNeighbors[i].push_back(j);
+        }
+    }
 }
 
 void PRadSquareCluster::Clear()
 {
     fNHyCalClusters = 0;
     fClusterCenterID.clear();
+    fBlockPool.clear();
 }
 
-void PRadSquareCluster::Reconstruct(EventData &event)
+void PRadSquareCluster::ReconstructModules()
 {
-    Clear(); // clear all the saved buffer before analyzing the next event
-
-    // do no reconstruction for non-physics event
-    // otherwise there will be some mess from LMS events
-    if(!event.is_physics_event())
-        return;
-
-    fHandler->ChooseEvent(event);
+    for (size_t i = 0; i < fModuleHits.size(); ++i)
+        fHitIndex[fModuleHits[i].id] = i;
 
     // Start reconstruction
-    auto fModuleList = fHandler->GetChannelList();
-
     while(fNHyCalClusters < MAX_HCLUSTERS)
     {
         unsigned short theMaxModuleID = getMaxEChannel();
@@ -65,29 +109,27 @@ void PRadSquareCluster::Reconstruct(EventData &event)
             break;//this happens if no module has large enough energy
 
         double clusterEnergy = 0.;
-        PRadDAQUnit::ChannelType thisType = fModuleList.at(theMaxModuleID)->GetType();
-        vector<unsigned short> collection = findCluster(theMaxModuleID, clusterEnergy);
+        const ModuleInfo &centerModule = fModuleTable.at(theMaxModuleID);
+        PRadDAQUnit::ChannelType thisType = centerModule.geometry.type;
+        vector<const ModuleHit*> collection = findCluster(theMaxModuleID, clusterEnergy);
 
         if ((clusterEnergy <= fMinClusterE) ||
             (thisType == PRadDAQUnit::LeadTungstate && collection.size() <= 3) ||
             (thisType == PRadDAQUnit::LeadGlass && collection.size() <= 1))
             continue;
 
-        vector<unsigned short> clusterTime = GetTimeForCluster(fModuleList.at(theMaxModuleID));
+        const vector<unsigned short> &clusterTime = GetTimeForCluster(theMaxModuleID);
         double weightX = 0., weightY = 0., totalWeight = 0.;
         double weightX_log = 0, weightY_log = 0., totalWeight_log = 0.;
 
         for (size_t j = 0; j < collection.size(); ++j)
         {
-            unsigned short thisID = collection.at(j);
-            PRadDAQUnit* thisModule = fModuleList.at(thisID);
-            if (!thisModule->IsHyCalModule())
-                continue;
+            const ModuleHit *thisHit = collection.at(j);
 
-            double thisX = thisModule->GetX();
-            double thisY = thisModule->GetY();
+            double thisX = thisHit->x;
+            double thisY = thisHit->y;
 
-            double weight = thisModule->GetEnergy()/clusterEnergy;
+            double weight = thisHit->energy/clusterEnergy;
             weightX += weight*thisX;
             weightY += weight*thisY;
             totalWeight += weight;
@@ -104,11 +146,26 @@ void PRadSquareCluster::Reconstruct(EventData &event)
         fHyCalCluster[fNHyCalClusters].x_log = weightX_log/totalWeight_log;
         fHyCalCluster[fNHyCalClusters].y_log = weightY_log/totalWeight_log;
         fHyCalCluster[fNHyCalClusters].E = clusterEnergy;
-        fHyCalCluster[fNHyCalClusters].cid = fModuleList[theMaxModuleID]->GetPrimexID();
+        fHyCalCluster[fNHyCalClusters].cid = centerModule.primex_id;
         fHyCalCluster[fNHyCalClusters].set_time(clusterTime);
 
+        // modules of the cluster
+        fHyCalCluster[fNHyCalClusters].nblocks = collection.size();
+        fHyCalCluster[fNHyCalClusters].block_offset = fBlockPool.size();
+        fHyCalCluster[fNHyCalClusters].block_size = collection.size();
+        for (auto &thisHit : collection)
+            fBlockPool.emplace_back(thisHit->primex_id, thisHit->energy);
+
         ++fNHyCalClusters;
     }
+
+    // reset the tables for the next event
+    for (auto &hit : fModuleHits)
+        fHitIndex[hit.id] = -1;
+
+    for (auto &center : fClusterCenterID)
+        for (auto &id : fMergeNeighbors[center])
+            fMerged[id] = 0;
 }
 
 unsigned short PRadSquareCluster::getMaxEChannel()
@@ -116,75 +173,48 @@ unsigned short PRadSquareCluster::getMaxEChannel()
     double theMaxValue = 0;
     bool foundNewCenter = false;
     unsigned short theMaxChannelID = 0xffff;
-    auto fModuleList = fHandler->GetChannelList();
 
-    for (unsigned int i = 0; i < fModuleList.size(); ++i)
+    // only the fired modules are checked, they are in the order of channel id
+    for (auto &thisHit : fModuleHits)
     {
         // if have not found the module with maxmimum energy then find it
         // otherwise check if the next maximum is too close to the existing center
-        PRadDAQUnit* thisModule = fModuleList.at(i);
-        if (!thisModule->IsHyCalModule())
-            continue;
-
-        if (thisModule->GetEnergy() < fMinClusterCenterE)
+        if (thisHit.energy < fMinClusterCenterE)
             continue;
 
-        double theClusterRadius = fBaseR;
-        if (thisModule->GetType() == PRadDAQUnit::LeadGlass)
-            theClusterRadius = fMoliereRatio*fBaseR;
-
-        double distance = 1e4;
-        bool merged = false;
-        for (unsigned int j = 0; j < fClusterCenterID.size(); ++j){
-            PRadDAQUnit* lastCenterModule = fModuleList.at( fClusterCenterID.at(j) );
-            distance = Distance( thisModule, lastCenterModule ) ;
-            if (distance < 2*theClusterRadius) {
-                merged = true;
-                continue;
-            }
-        }
-
-        if (merged)
+        // the modules around the found centers are marked
+        if (fMerged[thisHit.id])
             continue;
 
-        if (thisModule->GetEnergy() > theMaxValue) {
+        if (thisHit.energy > theMaxValue) {
             foundNewCenter = true;
-            theMaxValue = thisModule->GetEnergy();
-            theMaxChannelID = i;
+            theMaxValue = thisHit.energy;
+            theMaxChannelID = thisHit.id;
         }
     }
 
-    if (foundNewCenter)
-    fClusterCenterID.push_back(theMaxChannelID);
+    if (foundNewCenter) {
+        fClusterCenterID.push_back(theMaxChannelID);
+        for (auto &id : fMergeNeighbors[theMaxChannelID])
+            fMerged[id] = 1;
+    }
 
     return theMaxChannelID;
 }
 
-vector<unsigned short> PRadSquareCluster::findCluster(unsigned short centerID, double &clusterEnergy)
+vector<const PRadHyCalCluster::ModuleHit*> PRadSquareCluster::findCluster(unsigned short centerID, double &clusterEnergy)
 {
-    auto fModuleList = fHandler->GetChannelList();
-    double clusterRadius = 0.;
-    double centerX = fModuleList.at(centerID)->GetX();
-    double centerY = fModuleList.at(centerID)->GetY();
-    vector<unsigned short> collection;
+    vector<const ModuleHit*> collection;
 
-    for (unsigned int i = 0; i < fModuleList.size(); ++i)
+    // the neighbors are sorted by channel id, only the fired ones are added
+    for (auto &id : fClusterNeighbors.at(centerID))
     {
-        PRadDAQUnit* thisModule = fModuleList.at(i);
-        if (!thisModule->IsHyCalModule())
+        if (fHitIndex[id] < 0)
             continue;
-        if (thisModule->GetType() == 1) {
-            clusterRadius = fBaseR;
-        } else {
-            clusterRadius = fBaseR*fMoliereRatio;
-        }
 
-        if ( thisModule->GetEnergy() > 0. &&
-             Distance( thisModule->GetX(), thisModule->GetY(), centerX, centerY ) <= clusterRadius )
-        {
-            clusterEnergy += thisModule->GetEnergy();
-            collection.push_back(i);
-        }
+        const ModuleHit &thisHit = fModuleHits[fHitIndex[id]];
+        clusterEnergy += thisHit.energy;
+        collection.push_back(&thisHit);
     }
 
     return collection;
@@ -225,26 +255,20 @@ double PRadSquareCluster::Distance(const vector<double> &p1, const vector<double
     return sqrt(quadratic_sum);
 }
 
-vector<unsigned short> &PRadSquareCluster::GetTimeForCluster(PRadDAQUnit *module)
+// time measures of the center module in current event
+const vector<unsigned short> &PRadSquareCluster::GetTimeForCluster(const unsigned short &centerID)
 {
-    PRadTDCGroup* thisGroup = module->GetTDCGroup();
-    return thisGroup->GetTimeMeasure();
+    return GetTimeMeasure(fModuleTable.at(centerID).tdc_id);
 }
 
 PRadDAQUnit *PRadSquareCluster::LocateModule(const double &x, const double &y)
 {
-    auto fModuleList = fHandler->GetChannelList();
+    checkModuleTable();
 
-    for(auto &module : fModuleList)
-    {
-        PRadDAQUnit::Geometry thisGeometry = module->GetGeometry();
-        if ( fabs(x - thisGeometry.x) < thisGeometry.size_x/2. &&
-             fabs(y - thisGeometry.y) < thisGeometry.size_y/2. )
-        {
-            return module;
-        }
-    }
+    int id = fModuleGrid.Locate(x, y);
+    if (id < 0)
+        return nullptr;
 
-    return nullptr;
+    return fHandler->GetChannelList().at(id);
 }
 
@@ -0,0 +1,428 @@
+//============================================================================//
+// A work-stealing thread pool shared by the decoder, GEM and clustering      //
+// Jobs are submitted through task groups, every worker keeps its own queue   //
+// and steals from the others when it runs out of jobs. A thread waiting for  //
+// a group runs the queued jobs of the group, so nested groups are allowed.   //
+// The jobs are timed by their group names, and the queue depth is recorded   //
+//                                                                            //
+// agent                                                                      //
+// 10/17/2026                                                                 //
+//============================================================================//
+
+#include "PRadThreadPool.h"
+#include <iostream>
+#include <iomanip>
+#include <exception>
+#include <chrono>
+#include <cstdlib>
+
+using namespace std;
+
+#ifdef MULTI_THREAD
+// the pool and queue index of the worker thread
+static thread_local PRadThreadPool *current_pool = nullptr;
+static thread_local size_t current_index = 0;
+#endif
+
+// update the maximum with compare and swap
+template<typename T>
+inline void update_max(atomic<T> &max_val, const T &val)
+{
+    T prev = max_val;
+    while(prev < val && !max_val.compare_exchange_weak(prev, val)) {;}
+}
+
+
+
+//============================================================================//
+// Task group                                                                 //
+//============================================================================//
+
+PRadThreadPool::TaskGroup::TaskGroup(PRadThreadPool *p, const string &n)
+: pool(p), name(n), pending(0), count(0), total_ns(0), max_ns(0)
+{
+}
+
+PRadThreadPool::TaskGroup::~TaskGroup()
+{
+    Wait();
+}
+
+// run the job in the pool, it runs in the calling thread if the pool does
+// not have any threads
+void PRadThreadPool::TaskGroup::Run(const Job &job)
+{
+    ++pending;
+
+#ifdef MULTI_THREAD
+    if(pool && !pool->threads.empty()) {
+        pool->push(new Item(job, this));
+        return;
+    }
+#endif
+
+    execute(job);
+}
+
+// wait for all the jobs in this group, the waiting thread helps the pool
+void PRadThreadPool::TaskGroup::Wait()
+{
+#ifdef MULTI_THREAD
+    while(pending > 0)
+    {
+        if(pool && pool->runGroup(this))
+            continue;
+
+        // the rest jobs are running, check the queue again in a while since
+        // they may add new jobs
+        unique_lock<mutex> lock(done_lock);
+        done_cond.wait_for(lock, chrono::milliseconds(1), [this] {return pending == 0;});
+    }
+
+    // the last job may still hold the lock
+    { lock_guard<mutex> lock(done_lock); }
+#endif
+
+    if(pool)
+        pool->collect(this);
+}
+
+void PRadThreadPool::TaskGroup::execute(const Job &job)
+{
+    auto begin = chrono::steady_clock::now();
+
+    try {
+        job();
+    } catch(exception &e) {
+        cerr << "Thread Pool: Exception from job in group "
+             << "\"" << name << "\": " << e.what()
+             << endl;
+    }
+
+    uint64_t ns = chrono::duration_cast<chrono::nanoseconds>
+                  (chrono::steady_clock::now() - begin).count();
+    ++count;
+    total_ns += ns;
+    update_max(max_ns, ns);
+
+#ifdef MULTI_THREAD
+    lock_guard<mutex> lock(done_lock);
+    if(--pending == 0)
+        done_cond.notify_all();
+#else
+    --pending;
+#endif
+}
+
+
+
+//============================================================================//
+// Thread pool                                                                //
+//============================================================================//
+
+PRadThreadPool::PRadThreadPool(const size_t &n)
+:
+#ifdef MULTI_THREAD
+  stopped(false),
+#endif
+  depth(0), max_depth(0), steals(0)
+{
+    Resize(n);
+}
+
+PRadThreadPool::~PRadThreadPool()
+{
+#ifdef MULTI_THREAD
+    stop();
+#endif
+}
+
+// change the number of threads, it should not be called while there are
+// jobs running in the pool, 0 means the jobs run in the calling thread
+void PRadThreadPool::Resize(const size_t &n)
+{
+#ifdef MULTI_THREAD
+    stop();
+    start(n);
+#else
+    (void) n;
+#endif
+}
+
+size_t PRadThreadPool::GetThreadNumber() const
+{
+#ifdef MULTI_THREAD
+    return threads.size();
+#else
+    return 0;
+#endif
+}
+
+// run task(i) for i in [0, n), it returns when all of them are finished
+void PRadThreadPool::ParallelFor(const size_t &n, const Task &task, const string &name)
+{
+    TaskGroup group(this, name);
+
+    for(size_t i = 0; i < n; ++i)
+        group.Run([&task, i] () {task(i);});
+
+    group.Wait();
+}
+
+// timing of the finished groups by names
+map<string, PRadThreadPool::TaskStat> PRadThreadPool::GetTaskStats()
+{
+    lock_guard<mutex> lock(stat_lock);
+    return stats;
+}
+
+void PRadThreadPool::ResetStatistics()
+{
+    lock_guard<mutex> lock(stat_lock);
+    stats.clear();
+    max_depth = (size_t) depth;
+    steals = 0;
+}
+
+void PRadThreadPool::PrintStatistics(ostream &os)
+{
+    os << "Thread Pool: " << GetThreadNumber() << " threads, "
+       << "queue depth " << depth << ", "
+       << "max queue depth " << max_depth << ", "
+       << steals << " jobs stolen."
+       << endl;
+
+    for(auto &it : GetTaskStats())
+    {
+        const TaskStat &stat = it.second;
+        os << setw(24) << it.first << ": "
+           << setw(10) << stat.count << " jobs, "
+           << "average " << setw(10) << stat.total_ns/1e3/max(stat.count, (uint64_t)1) << " us, "
+           << "max " << setw(10) << stat.max_ns/1e3 << " us, "
+           << "total " << setw(10) << stat.total_ns/1e6 << " ms"
+           << endl;
+    }
+}
+
+// number of threads from the environment variable, -1 if it is not set
+int PRadThreadPool::GetEnvironmentSize()
+{
+    const char *env = getenv(THREAD_POOL_ENV);
+    if(env == nullptr || *env == '\0')
+        return -1;
+
+    char *end;
+    long n = strtol(env, &end, 10);
+    if(*end != '\0' || n < 0) {
+        cerr << "Thread Pool: Invalid " << THREAD_POOL_ENV
+             << " = \"" << env << "\", it is ignored."
+             << endl;
+        return -1;
+    }
+
+    return (int) n;
+}
+
+// number of threads from the environment variable or the hardware
+size_t PRadThreadPool::GetDefaultSize()
+{
+    int n = GetEnvironmentSize();
+    if(n >= 0)
+        return n;
+
+#ifdef MULTI_THREAD
+    return thread::hardware_concurrency();
+#else
+    return 0;
+#endif
+}
+
+// move the timing of the finished jobs in group to the statistics
+void PRadThreadPool::collect(TaskGroup *group)
+{
+    uint64_t count = group->count.exchange(0);
+    if(count == 0)
+        return;
+
+    lock_guard<mutex> lock(stat_lock);
+    TaskStat &stat = stats[group->name];
+    stat.count += count;
+    stat.total_ns += group->total_ns.exchange(0);
+    stat.max_ns = max(stat.max_ns, group->max_ns.exchange(0));
+}
+
+#ifdef MULTI_THREAD
+
+// the jobs from a worker go to its own queue
+void PRadThreadPool::push(Item *item)
+{
+    Queue *queue = (current_pool == this) ? queues[current_index] : &shared;
+
+    // count the job first, so the depth never goes below the queued jobs
+    update_max(max_depth, ++depth);
+    {
+        lock_guard<mutex> lock(queue->lock);
+        queue->items.push_back(item);
+    }
+
+    // the workers check the depth with the lock held before sleeping
+    { lock_guard<mutex> lock(sleep_lock); }
+    sleep_cond.notify_one();
+}
+
+PRadThreadPool::Item *PRadThreadPool::popBack(Queue *queue)
+{
+    lock_guard<mutex> lock(queue->lock);
+    if(queue->items.empty())
+        return nullptr;
+
+    Item *item = queue->items.back();
+    queue->items.pop_back();
+    --depth;
+    return item;
+}
+
+PRadThreadPool::Item *PRadThreadPool::popFront(Queue *queue)
+{
+    lock_guard<mutex> lock(queue->lock);
+    if(queue->items.empty())
+        return nullptr;
+
+    Item *item = queue->items.front();
+    queue->items.pop_front();
+    --depth;
+    return item;
+}
+
+// the newest job of the group, it is usually at the end of the queue
+PRadThreadPool::Item *PRadThreadPool::popGroup(Queue *queue, TaskGroup *group)
+{
+    lock_guard<mutex> lock(queue->lock);
+    for(auto it = queue->items.rbegin(); it != queue->items.rend(); ++it)
+    {
+        if((*it)->group == group) {
+            Item *item = *it;
+            queue->items.erase(next(it).base());
+            --depth;
+            return item;
+        }
+    }
+    return nullptr;
+}
+
+// own queue first, then the shared queue, then steal from the others
+PRadThreadPool::Item *PRadThreadPool::take()
+{
+    if(depth == 0)
+        return nullptr;
+
+    Item *item;
+    bool is_worker = (current_pool == this);
+    if(is_worker && (item = popBack(queues[current_index])))
+        return item;
+
+    if((item = popFront(&shared)))
+        return item;
+
+    size_t n = queues.size();
+    size_t first = is_worker ? current_index + 1 : 0;
+    for(size_t i = 0; i < n; ++i)
+    {
+        size_t idx = (first + i)%n;
+        if(is_worker && idx == current_index)
+            continue;
+
+        if((item = popFront(queues[idx]))) {
+            ++steals;
+            return item;
+        }
+    }
+
+    return nullptr;
+}
+
+// run one job from the queues, return false if there is no job
+bool PRadThreadPool::runOne()
+{
+    Item *item = take();
+    if(item == nullptr)
+        return false;
+
+    item->group->execute(item->job);
+    delete item;
+    return true;
+}
+
+// run one queued job of the group in the waiting thread, the other jobs are
+// not taken, so a waiting thread does not start unrelated long jobs
+bool PRadThreadPool::runGroup(TaskGroup *group)
+{
+    if(depth == 0)
+        return false;
+
+    // the jobs are in the queue of the thread that runs the group
+    Queue *queue = (current_pool == this) ? queues[current_index] : &shared;
+    Item *item = popGroup(queue, group);
+
+    if(item == nullptr)
+        return false;
+
+    item->group->execute(item->job);
+    delete item;
+    return true;
+}
+
+void PRadThreadPool::workerLoop(const size_t &index)
+{
+    current_pool = this;
+    current_index = index;
+
+    while(true)
+    {
+        if(runOne())
+            continue;
+
+        unique_lock<mutex> lock(sleep_lock);
+        sleep_cond.wait(lock, [this] {return stopped || depth > 0;});
+
+        if(stopped)
+            return;
+    }
+}
+
+void PRadThreadPool::start(const size_t &n)
+{
+    stopped = false;
+
+    // queues are created before the threads since a worker steals from all
+    for(size_t i = 0; i < n; ++i)
+        queues.push_back(new Queue());
+
+    for(size_t i = 0; i < n; ++i)
+        threads.emplace_back(&PRadThreadPool::workerLoop, this, i);
+}
+
+void PRadThreadPool::stop()
+{
+    {
+        lock_guard<mutex> lock(sleep_lock);
+        stopped = true;
+    }
+    sleep_cond.notify_all();
+
+    for(auto &thread : threads)
+    {
+        if(thread.joinable())
+            thread.join();
+    }
+    threads.clear();
+
+    // finish the jobs left in the queues, so no group waits forever
+    while(runOne()) {;}
+
+    for(auto &queue : queues)
+        delete queue, queue = nullptr;
+    queues.clear();
+}
+
+#endif